@@ -1,5 +1,7 @@
 import argparse
 
+from uint8_input import add_uint8_input
+
 
 def expected_onnx_filename(model_type: str) -> str:
     return f"rfdetr-{model_type}.onnx"
@@ -23,6 +25,8 @@ def main():
                         help='Model type (default: medium)')
     parser.add_argument('--device', default=None, type=str,
                         help='Device for export, e.g. cpu or cuda (default: auto)')
+    parser.add_argument('--uint8_input', action='store_true',
+                        help='Rewrite the model to take uint8 NHWC input with normalization in the graph')
     args = parser.parse_args()
 
     print("="*60)
@@ -79,6 +83,8 @@ def main():
     model.export(**export_kwargs)
 
     output_dir = args.output_dir or "output"
+    if args.uint8_input:
+        add_uint8_input(f"{output_dir}/{expected_onnx_filename(args.model_type)}")
     print(f"\nExpected ONNX file: {output_dir}/{expected_onnx_filename(args.model_type)}")
 
     print("\n" + "="*60)
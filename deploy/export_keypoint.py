@@ -19,6 +19,8 @@ import argparse
 import shutil
 from pathlib import Path
 
+from uint8_input import add_uint8_input
+
 DEFAULT_KEYPOINT_RESOLUTION = 576
 KEYPOINT_SHAPE_BLOCK_SIZE = 24
 
@@ -64,6 +66,8 @@ def main():
     parser.add_argument('--device', default=None, type=str,
                         help='Device for export, e.g. cpu or cuda (default: auto)')
 
+    parser.add_argument('--uint8_input', action='store_true',
+                        help='Rewrite the model to take uint8 NHWC input with normalization in the graph')
     args = parser.parse_args()
 
     if args.input_size is not None and args.input_size % KEYPOINT_SHAPE_BLOCK_SIZE != 0:
@@ -105,6 +109,8 @@ def main():
     print(f"  - ONNX opset: {args.opset_version}")
 
     exported_path = resolve_exported_path(model.export(**export_kwargs), output_dir)
+    if args.uint8_input:
+        add_uint8_input(exported_path)
 
     compat_path = output_dir / compat_onnx_filename()
     if exported_path.name != compat_onnx_filename() and exported_path != compat_path:
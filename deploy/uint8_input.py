@@ -0,0 +1,80 @@
+"""
+Fold input normalization into an exported RF-DETR ONNX graph
+
+The stock export takes a normalized float32 NCHW tensor, so the C++ side spends a pass per frame
+on the divide/subtract and ships 4 bytes per channel to the device. After this rewrite the model
+input "input" is raw RGB uint8 NHWC ([batch, height, width, 3]) and the graph itself does:
+
+    Cast(float) -> Transpose(NCHW) -> Mul(1 / (255 * std)) -> Add(-mean / std)
+
+The C++ backends detect the uint8 input type at load and switch to the uint8 preprocessing path.
+"""
+
+from pathlib import Path
+
+import numpy as np
+
+IMAGENET_MEANS = (0.485, 0.456, 0.406)
+IMAGENET_STDS = (0.229, 0.224, 0.225)
+
+INPUT_NAME = "input"
+
+
+def add_uint8_input(onnx_path, means=IMAGENET_MEANS, stds=IMAGENET_STDS) -> Path:
+    """Rewrite `onnx_path` in place to take uint8 NHWC input; returns the path."""
+    import onnx
+    from onnx import TensorProto, helper, numpy_helper
+
+    onnx_path = Path(onnx_path)
+    model = onnx.load(str(onnx_path))
+    graph = model.graph
+
+    original = next((i for i in graph.input if i.name == INPUT_NAME), None)
+    if original is None:
+        raise ValueError(f"{onnx_path} has no graph input named '{INPUT_NAME}'")
+    if original.type.tensor_type.elem_type == TensorProto.UINT8:
+        print(f"  - {onnx_path.name} already takes uint8 input, leaving it unchanged")
+        return onnx_path
+
+    dims = original.type.tensor_type.shape.dim
+    if len(dims) != 4:
+        raise ValueError(f"Expected a 4-D NCHW input, got rank {len(dims)}")
+
+    def dim_value(d):
+        return d.dim_param if d.HasField("dim_param") else d.dim_value
+
+    batch, channels, height, width = (dim_value(d) for d in dims)
+    if channels != 3:
+        raise ValueError(f"Expected 3 input channels, got {channels}")
+
+    # Everything that consumed the float input now consumes the normalized tensor instead.
+    normalized = "input_normalized"
+    for node in graph.node:
+        node.input[:] = [normalized if name == INPUT_NAME else name for name in node.input]
+
+    scale = np.array([1.0 / (255.0 * s) for s in stds], dtype=np.float32).reshape(1, 3, 1, 1)
+    bias = np.array([-m / s for m, s in zip(means, stds)], dtype=np.float32).reshape(1, 3, 1, 1)
+    graph.initializer.extend([
+        numpy_helper.from_array(scale, "input_scale"),
+        numpy_helper.from_array(bias, "input_bias"),
+    ])
+
+    prologue = [
+        helper.make_node("Cast", [INPUT_NAME], ["input_float"], to=TensorProto.FLOAT),
+        helper.make_node("Transpose", ["input_float"], ["input_nchw"], perm=[0, 3, 1, 2]),
+        helper.make_node("Mul", ["input_nchw", "input_scale"], ["input_scaled"]),
+        helper.make_node("Add", ["input_scaled", "input_bias"], [normalized]),
+    ]
+    nodes = prologue + list(graph.node)
+    del graph.node[:]
+    graph.node.extend(nodes)
+
+    uint8_input = helper.make_tensor_value_info(INPUT_NAME, TensorProto.UINT8, [batch, height, width, 3])
+    inputs = [uint8_input if i.name == INPUT_NAME else i for i in graph.input]
+    del graph.input[:]
+    graph.input.extend(inputs)
+
+    onnx.checker.check_model(model)
+    onnx.save(model, str(onnx_path))
+    print(f"  - Input rewritten to uint8 NHWC [{batch}, {height}, {width}, 3] (normalization in graph)")
+    return onnx_path
@@ -97,6 +97,15 @@ std::vector<int64_t> ExecuTorchBackend::initialize(const std::filesystem::path &
                                  ". Is this a valid .pte program?");
     }
 
+    if (meta->num_inputs() > 0) {
+        const auto input_meta = meta->input_tensor_meta(0);
+        if (input_meta.ok() && input_meta->scalar_type() == ScalarType::Byte) {
+            input_format_ = InputFormat::UINT8_NHWC;
+            std::cout << "[ExecuTorch] Program takes uint8 NHWC input (normalization in graph)" << std::endl;
+        }
+    }
+    const bool nhwc = input_format_ == InputFormat::UINT8_NHWC;
+
     // Auto-detect input resolution when the caller passed 0 (mirrors OnnxRuntimeBackend).
     std::vector<int64_t> detected_shape = input_shape;
     if (input_shape.size() == 4 && (input_shape[2] == 0 || input_shape[3] == 0)) {
@@ -108,13 +117,17 @@ std::vector<int64_t> ExecuTorchBackend::initialize(const std::filesystem::path &
             throw std::runtime_error("ExecuTorch input metadata unavailable; cannot auto-detect resolution.");
         }
         const auto shape = to_int64_dims(input_meta->sizes());
-        if (shape.size() == 4 && shape[2] == shape[3] && shape[2] > 0) {
+        const size_t h_axis = nhwc ? 1 : 2;
+        if (shape.size() == 4 && shape[h_axis] == shape[h_axis + 1] && shape[h_axis] > 0) {
             detected_shape = shape;
-            std::cout << "[ExecuTorch] Auto-detected input resolution: " << shape[2] << "x" << shape[3] << std::endl;
+            std::cout << "[ExecuTorch] Auto-detected input resolution: " << shape[h_axis] << "x" << shape[h_axis + 1]
+                      << std::endl;
         } else {
             throw std::runtime_error("Could not auto-detect valid input resolution from model. Input shape: " +
                                      shape_to_string(shape));
         }
+    } else if (nhwc && input_shape.size() == 4) {
+        detected_shape = {input_shape[0], input_shape[2], input_shape[3], input_shape[1]};
     }
 
     output_count_ = meta->num_outputs();
@@ -128,8 +141,17 @@ std::vector<int64_t> ExecuTorchBackend::initialize(const std::filesystem::path &
     return detected_shape;
 }
 
-std::vector<void *> ExecuTorchBackend::run_inference(std::span<const float> input_data,
-                                                     const std::vector<int64_t> &input_shape) {
+void ExecuTorchBackend::run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) {
+    // const_cast is safe because ExecuTorch only reads program inputs.
+    run_forward(const_cast<float *>(input_data.data()), input_data.size(), ScalarType::Float, input_shape);
+}
+
+void ExecuTorchBackend::run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) {
+    run_forward(const_cast<uint8_t *>(input_data.data()), input_data.size(), ScalarType::Byte, input_shape);
+}
+
+void ExecuTorchBackend::run_forward(void *data, size_t numel, ScalarType type,
+                                    const std::vector<int64_t> &input_shape) {
     if (!module_) {
         throw std::runtime_error("ExecuTorch backend used before initialize()");
     }
@@ -141,16 +163,14 @@ std::vector<void *> ExecuTorchBackend::run_inference(std::span<const float> inpu
 
     const size_t expected = std::accumulate(input_shape.begin(), input_shape.end(), size_t{1},
                                             [](size_t acc, int64_t dim) { return acc * static_cast<size_t>(dim); });
-    if (input_data.size() != expected) {
+    if (numel != expected) {
         throw std::runtime_error("Input tensor size mismatch. Expected: " + std::to_string(expected) +
-                                 ", Got: " + std::to_string(input_data.size()));
+                                 ", Got: " + std::to_string(numel));
     }
 
-    // Non-owning view (no deleter): input_data outlives the forward() call below, so the per-frame
-    // copy a value-owning tensor would cost is avoidable. const_cast is safe because ExecuTorch
-    // only reads program inputs.
-    auto input_tensor = executorch::extension::make_tensor_ptr(std::move(sizes), const_cast<float *>(input_data.data()),
-                                                               ScalarType::Float);
+    // Non-owning view (no deleter): the caller's buffer outlives the forward() call below, so the
+    // per-frame copy a value-owning tensor would cost is avoidable.
+    auto input_tensor = executorch::extension::make_tensor_ptr(std::move(sizes), data, type);
 
     std::vector<executorch::runtime::EValue> inputs;
     inputs.emplace_back(*input_tensor);
@@ -162,12 +182,17 @@ std::vector<void *> ExecuTorchBackend::run_inference(std::span<const float> inpu
     }
     output_values_ = std::move(*result);
 
-    std::vector<void *> output_ptrs;
-    output_ptrs.reserve(output_values_.size());
-    std::transform(output_values_.begin(), output_values_.end(), std::back_inserter(output_ptrs),
-                   [](auto &value) { return static_cast<void *>(&value); });
-
-    return output_ptrs;
+    output_shapes_.resize(output_values_.size());
+    for (size_t i = 0; i < output_values_.size(); ++i) {
+        auto &shape = output_shapes_[i];
+        shape.clear();
+        if (output_values_[i].isTensor()) {
+            const auto tensor = output_values_[i].toTensor();
+            for (ssize_t d = 0; d < tensor.dim(); ++d) {
+                shape.push_back(static_cast<int64_t>(tensor.size(d)));
+            }
+        }
+    }
 }
 
 size_t ExecuTorchBackend::get_output_count() const { return output_count_; }
@@ -183,6 +208,16 @@ executorch::aten::Tensor ExecuTorchBackend::output_tensor(size_t output_index) c
 }
 
 void ExecuTorchBackend::get_output_data(size_t output_index, float *data, size_t size) {
+    const auto view = get_output_view(output_index);
+    if (view.size() != size) {
+        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
+                                 ", Got: " + std::to_string(view.size()));
+    }
+
+    std::copy(view.begin(), view.end(), data);
+}
+
+std::span<const float> ExecuTorchBackend::get_output_view(size_t output_index) const {
     const auto tensor = output_tensor(output_index);
 
     if (tensor.scalar_type() != ScalarType::Float) {
@@ -190,14 +225,13 @@ void ExecuTorchBackend::get_output_data(size_t output_index, float *data, size_t
                                  " is not float32; RF-DETR postprocessing requires float outputs.");
     }
 
-    const auto tensor_size = static_cast<size_t>(tensor.numel());
-    if (tensor_size != size) {
-        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
-                                 ", Got: " + std::to_string(tensor_size));
-    }
+    // The tensor header is a copy, but its data lives in output_values_ until the next forward().
+    return {tensor.const_data_ptr<float>(), static_cast<size_t>(tensor.numel())};
+}
 
-    const float *tensor_data = tensor.const_data_ptr<float>();
-    std::copy(tensor_data, tensor_data + size, data);
+std::span<const int64_t> ExecuTorchBackend::get_output_shape_view(size_t output_index) const {
+    (void)output_tensor(output_index); // same index/type checks as get_output_shape()
+    return output_shapes_[output_index];
 }
 
 std::vector<int64_t> ExecuTorchBackend::get_output_shape(size_t output_index) const {
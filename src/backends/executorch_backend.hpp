@@ -30,18 +30,29 @@ class ExecuTorchBackend : public InferenceBackend {
     std::vector<int64_t> initialize(const std::filesystem::path &model_path,
                                     const std::vector<int64_t> &input_shape) override;
 
-    std::vector<void *> run_inference(std::span<const float> input_data,
-                                      const std::vector<int64_t> &input_shape) override;
+    void run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) override;
+
+    void run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) override;
+
+    [[nodiscard]] InputFormat get_input_format() const override { return input_format_; }
 
     [[nodiscard]] size_t get_output_count() const override;
 
     void get_output_data(size_t output_index, float *data, size_t size) override;
 
+    [[nodiscard]] std::span<const float> get_output_view(size_t output_index) const override;
+
+    [[nodiscard]] std::span<const int64_t> get_output_shape_view(size_t output_index) const override;
+
     [[nodiscard]] std::vector<int64_t> get_output_shape(size_t output_index) const override;
 
     [[nodiscard]] std::string get_backend_name() const override { return "ExecuTorch"; }
 
   private:
+    /// Wrap `data` (numel elements of `type`) in a non-owning input tensor and run forward().
+    void run_forward(void *data, size_t numel, executorch::aten::ScalarType type,
+                     const std::vector<int64_t> &input_shape);
+
     /// Fetch output `output_index` from the last run, checking it exists and is a tensor.
     [[nodiscard]] executorch::aten::Tensor output_tensor(size_t output_index) const;
 
@@ -54,8 +65,14 @@ class ExecuTorchBackend : public InferenceBackend {
     /// (RFDETRInference's constructor validates the output count immediately after initialize()).
     size_t output_count_ = 0;
 
+    /// Byte (uint8) program inputs mean the exporter folded normalization into the graph.
+    InputFormat input_format_ = InputFormat::FLOAT32_NCHW;
+
     /// Results of the most recent forward(); mirrors OnnxRuntimeBackend's ort_output_tensors_.
     std::vector<executorch::runtime::EValue> output_values_;
+
+    /// Shapes of output_values_, refreshed in place after each forward().
+    std::vector<std::vector<int64_t>> output_shapes_;
 };
 
 } // namespace rfdetr::backend
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <span>
@@ -7,6 +8,14 @@
 
 namespace rfdetr::backend {
 
+/**
+ * @brief Element type and layout of the model's image input
+ */
+enum class InputFormat {
+    FLOAT32_NCHW, ///< Normalized float32 [B, 3, H, W] (the default rfdetr export)
+    UINT8_NHWC,   ///< Raw RGB uint8 [B, H, W, 3]; normalization is part of the model graph
+};
+
 /**
  * @brief Abstract base class for inference backends (Strategy Pattern)
  *
@@ -29,19 +38,31 @@ class InferenceBackend {
      * @brief Initialize the backend with a model file
      * @param model_path Path to the model file
      * @param input_shape Expected input shape [batch, channels, height, width]
-     * @return Actual input shape detected from the model (for auto-detection)
+     * @return Actual input shape detected from the model (for auto-detection); [batch, height,
+     *         width, 3] when the model takes UINT8_NHWC input
      */
     virtual std::vector<int64_t> initialize(const std::filesystem::path &model_path,
                                             const std::vector<int64_t> &input_shape) = 0;
 
     /**
-     * @brief Run inference on input data
+     * @brief Run inference on input data; read the results with get_output_view()
      * @param input_data Preprocessed input data (flattened)
      * @param input_shape Shape of the input tensor
-     * @return Vector of output tensors (backend-specific type)
      */
-    virtual std::vector<void *> run_inference(std::span<const float> input_data,
-                                              const std::vector<int64_t> &input_shape) = 0;
+    virtual void run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) = 0;
+
+    /**
+     * @brief Run inference on a uint8 input (models exported with normalization in the graph)
+     * @param input_data Resized RGB pixels, NHWC (flattened)
+     * @param input_shape Shape of the input tensor [batch, height, width, 3]
+     */
+    virtual void run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) = 0;
+
+    /**
+     * @brief Input format the loaded model expects (valid after initialize())
+     * @return FLOAT32_NCHW or UINT8_NHWC
+     */
+    [[nodiscard]] virtual InputFormat get_input_format() const = 0;
 
     /**
      * @brief Get the number of output tensors
@@ -57,6 +78,13 @@ class InferenceBackend {
      */
     virtual void get_output_data(size_t output_index, float *data, size_t size) = 0;
 
+    /**
+     * @brief View an output tensor in backend-owned memory, without copying
+     * @param output_index Index of the output tensor
+     * @return Flattened float32 data; valid until the next run_inference() call
+     */
+    [[nodiscard]] virtual std::span<const float> get_output_view(size_t output_index) const = 0;
+
     /**
      * @brief Get output tensor shape
      * @param output_index Index of the output tensor
@@ -64,6 +92,13 @@ class InferenceBackend {
      */
     [[nodiscard]] virtual std::vector<int64_t> get_output_shape(size_t output_index) const = 0;
 
+    /**
+     * @brief Non-allocating variant of get_output_shape()
+     * @param output_index Index of the output tensor
+     * @return Shape of the output tensor; valid until the next run_inference() call
+     */
+    [[nodiscard]] virtual std::span<const int64_t> get_output_shape_view(size_t output_index) const = 0;
+
     /**
      * @brief Get the backend name (for logging/debugging)
      * @return String identifying the backend type
@@ -27,19 +27,29 @@ std::vector<int64_t> OnnxRuntimeBackend::initialize(const std::filesystem::path
 
     session_ = std::make_unique<Ort::Session>(*env_, model_path.c_str(), session_options);
 
+    Ort::TypeInfo input_type_info = session_->GetInputTypeInfo(0);
+    auto tensor_info = input_type_info.GetTensorTypeAndShapeInfo();
+    auto shape = tensor_info.GetShape();
+    input_format_ = tensor_info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 ? InputFormat::UINT8_NHWC
+                                                                                          : InputFormat::FLOAT32_NCHW;
+    const bool nhwc = input_format_ == InputFormat::UINT8_NHWC;
+    if (nhwc) {
+        std::cout << "[ONNX Runtime] Model takes uint8 NHWC input (normalization in graph)" << std::endl;
+    }
+
     // Auto-detect input shape from model if resolution is 0
     std::vector<int64_t> detected_shape = input_shape;
     if (input_shape[2] == 0 || input_shape[3] == 0) {
-        Ort::TypeInfo input_type_info = session_->GetInputTypeInfo(0);
-        auto tensor_info = input_type_info.GetTensorTypeAndShapeInfo();
-        auto shape = tensor_info.GetShape();
-
-        if (shape.size() == 4 && shape[2] == shape[3] && shape[2] > 0) {
+        const size_t h_axis = nhwc ? 1 : 2;
+        if (shape.size() == 4 && shape[h_axis] == shape[h_axis + 1] && shape[h_axis] > 0) {
             detected_shape = shape;
-            std::cout << "[ONNX Runtime] Auto-detected input resolution: " << shape[2] << "x" << shape[3] << std::endl;
+            std::cout << "[ONNX Runtime] Auto-detected input resolution: " << shape[h_axis] << "x"
+                      << shape[h_axis + 1] << std::endl;
         } else {
             throw std::runtime_error("Could not auto-detect valid input resolution from model.");
         }
+    } else if (nhwc) {
+        detected_shape = {input_shape[0], input_shape[2], input_shape[3], input_shape[1]};
     }
 
     // Get output names from model
@@ -61,45 +71,61 @@ std::vector<int64_t> OnnxRuntimeBackend::initialize(const std::filesystem::path
     return detected_shape;
 }
 
-std::vector<void *> OnnxRuntimeBackend::run_inference(std::span<const float> input_data,
-                                                      const std::vector<int64_t> &input_shape) {
+void OnnxRuntimeBackend::run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) {
     // Create input tensor
     Ort::Value input_tensor =
         Ort::Value::CreateTensor<float>(memory_info_, const_cast<float *>(input_data.data()), input_data.size(),
                                         input_shape.data(), input_shape.size());
 
-    // Run inference
-    ort_output_tensors_ = session_->Run(Ort::RunOptions{nullptr}, &input_name_, &input_tensor, 1, output_names_.data(),
-                                        output_names_.size());
+    run_session(input_tensor, input_shape);
+}
 
-    // Return void pointers (for interface compatibility)
-    std::vector<void *> output_ptrs;
-    output_ptrs.reserve(ort_output_tensors_.size());
-    std::transform(ort_output_tensors_.begin(), ort_output_tensors_.end(), std::back_inserter(output_ptrs),
-                   [](auto &tensor) { return static_cast<void *>(&tensor); });
+void OnnxRuntimeBackend::run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) {
+    Ort::Value input_tensor =
+        Ort::Value::CreateTensor<uint8_t>(memory_info_, const_cast<uint8_t *>(input_data.data()), input_data.size(),
+                                          input_shape.data(), input_shape.size());
+    run_session(input_tensor, input_shape);
+}
+
+void OnnxRuntimeBackend::run_session(const Ort::Value &input_tensor, const std::vector<int64_t> &input_shape) {
+    // RF-DETR output shapes depend only on the input shape, so once a run has produced outputs for
+    // this shape they are handed back to ORT as preallocated outputs and overwritten in place.
+    if (!ort_output_tensors_.empty() && input_shape == output_input_shape_) {
+        session_->Run(Ort::RunOptions{nullptr}, &input_name_, &input_tensor, 1, output_names_.data(),
+                      ort_output_tensors_.data(), output_names_.size());
+        return;
+    }
 
-    return output_ptrs;
+    ort_output_tensors_ = session_->Run(Ort::RunOptions{nullptr}, &input_name_, &input_tensor, 1, output_names_.data(),
+                                        output_names_.size());
+    output_input_shape_ = input_shape;
+    output_shapes_.resize(ort_output_tensors_.size());
+    for (size_t i = 0; i < ort_output_tensors_.size(); ++i) {
+        output_shapes_[i] = ort_output_tensors_[i].GetTensorTypeAndShapeInfo().GetShape();
+    }
 }
 
 size_t OnnxRuntimeBackend::get_output_count() const { return output_name_strings_.size(); }
 
 void OnnxRuntimeBackend::get_output_data(size_t output_index, float *data, size_t size) {
-    if (output_index >= ort_output_tensors_.size()) {
-        throw std::out_of_range("Output index out of range");
+    const auto view = get_output_view(output_index);
+    if (view.size() != size) {
+        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
+                                 ", Got: " + std::to_string(view.size()));
     }
 
-    const float *tensor_data = ort_output_tensors_[output_index].GetTensorData<float>();
-    auto shape = ort_output_tensors_[output_index].GetTensorTypeAndShapeInfo().GetShape();
-
-    const size_t tensor_size = std::accumulate(shape.begin(), shape.end(), size_t{1},
-                                               [](size_t acc, int64_t dim) { return acc * static_cast<size_t>(dim); });
+    std::copy(view.begin(), view.end(), data);
+}
 
-    if (tensor_size != size) {
-        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
-                                 ", Got: " + std::to_string(tensor_size));
+std::span<const float> OnnxRuntimeBackend::get_output_view(size_t output_index) const {
+    if (output_index >= ort_output_tensors_.size()) {
+        throw std::out_of_range("Output index out of range");
     }
 
-    std::copy(tensor_data, tensor_data + size, data);
+    const auto &shape = output_shapes_[output_index];
+    const size_t size = std::accumulate(shape.begin(), shape.end(), size_t{1},
+                                        [](size_t acc, int64_t dim) { return acc * static_cast<size_t>(dim); });
+    return {ort_output_tensors_[output_index].GetTensorData<float>(), size};
 }
 
 std::vector<int64_t> OnnxRuntimeBackend::get_output_shape(size_t output_index) const {
@@ -107,7 +133,15 @@ std::vector<int64_t> OnnxRuntimeBackend::get_output_shape(size_t output_index) c
         throw std::out_of_range("Output index out of range");
     }
 
-    return ort_output_tensors_[output_index].GetTensorTypeAndShapeInfo().GetShape();
+    return output_shapes_[output_index];
+}
+
+std::span<const int64_t> OnnxRuntimeBackend::get_output_shape_view(size_t output_index) const {
+    if (output_index >= output_shapes_.size()) {
+        throw std::out_of_range("Output index out of range");
+    }
+
+    return output_shapes_[output_index];
 }
 
 } // namespace rfdetr::backend
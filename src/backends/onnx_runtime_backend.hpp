@@ -27,29 +27,42 @@ class OnnxRuntimeBackend : public InferenceBackend {
     std::vector<int64_t> initialize(const std::filesystem::path &model_path,
                                     const std::vector<int64_t> &input_shape) override;
 
-    std::vector<void *> run_inference(std::span<const float> input_data,
-                                      const std::vector<int64_t> &input_shape) override;
+    void run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) override;
+
+    void run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) override;
+
+    [[nodiscard]] InputFormat get_input_format() const override { return input_format_; }
 
     [[nodiscard]] size_t get_output_count() const override;
 
     void get_output_data(size_t output_index, float *data, size_t size) override;
 
+    [[nodiscard]] std::span<const float> get_output_view(size_t output_index) const override;
+
+    [[nodiscard]] std::span<const int64_t> get_output_shape_view(size_t output_index) const override;
+
     [[nodiscard]] std::vector<int64_t> get_output_shape(size_t output_index) const override;
 
     [[nodiscard]] std::string get_backend_name() const override { return "ONNX Runtime"; }
 
   private:
+    // Run the session on a prepared input tensor and cache the outputs
+    void run_session(const Ort::Value &input_tensor, const std::vector<int64_t> &input_shape);
+
     std::unique_ptr<Ort::Env> env_;
     std::unique_ptr<Ort::Session> session_;
     Ort::AllocatorWithDefaultOptions allocator_;
     Ort::MemoryInfo memory_info_;
 
     const char *input_name_ = "input";
+    InputFormat input_format_ = InputFormat::FLOAT32_NCHW;
     std::vector<std::string> output_name_strings_;
     std::vector<const char *> output_names_;
 
-    // Cache for output tensors
+    // Cache for output tensors, reused as preallocated outputs while the input shape is unchanged
     std::vector<Ort::Value> ort_output_tensors_;
+    std::vector<std::vector<int64_t>> output_shapes_;
+    std::vector<int64_t> output_input_shape_; // input shape ort_output_tensors_ were produced for
 };
 
 } // namespace rfdetr::backend
@@ -115,8 +115,19 @@ std::vector<int64_t> TensorRTBackend::initialize(const std::filesystem::path &mo
         }
         std::cout << "]" << std::endl;
 
+#if NV_TENSORRT_MAJOR >= 10
+        const auto data_type = engine_->getTensorDataType(name);
+#else
+        const auto data_type = engine_->getBindingDataType(i);
+#endif
+        const size_t element_size = data_type == nvinfer1::DataType::kUINT8 ? sizeof(uint8_t) : sizeof(float);
+
         if (is_input) {
             input_binding_index_ = i;
+            if (data_type == nvinfer1::DataType::kUINT8) {
+                input_format_ = InputFormat::UINT8_NHWC;
+                std::cout << "[TensorRT] Engine takes uint8 NHWC input (normalization in graph)" << std::endl;
+            }
             // Auto-detect input shape
             if (dims.nbDims == 4) {
                 detected_shape = {dims.d[0], dims.d[1], dims.d[2], dims.d[3]};
@@ -137,7 +148,10 @@ std::vector<int64_t> TensorRTBackend::initialize(const std::filesystem::path &mo
         for (int j = 0; j < dims.nbDims; ++j) {
             binding_size *= dims.d[j];
         }
-        binding_size *= sizeof(float); // Assuming float32
+        binding_size *= element_size;
+        if (is_input) {
+            input_binding_bytes_ = binding_size;
+        }
 
         void *device_buffer;
         cudaMalloc(&device_buffer, binding_size);
@@ -278,12 +292,30 @@ bool TensorRTBackend::deserialize_engine(const std::filesystem::path &engine_pat
     return true;
 }
 
-std::vector<void *> TensorRTBackend::run_inference(std::span<const float> input_data,
-                                                   const std::vector<int64_t> &input_shape) {
+void TensorRTBackend::run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) {
     // Copy input data to device
-    size_t input_size = input_data.size() * sizeof(float);
-    cudaMemcpy(device_buffers_[input_binding_index_], input_data.data(), input_size, cudaMemcpyHostToDevice);
+    upload_input(input_data.data(), input_data.size_bytes(), input_shape);
+    execute();
+}
 
+void TensorRTBackend::run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) {
+    // 4x fewer bytes over PCIe than the float path; the engine casts and normalizes on the GPU
+    upload_input(input_data.data(), input_data.size_bytes(), input_shape);
+    execute();
+}
+
+void TensorRTBackend::upload_input(const void *data, size_t bytes, const std::vector<int64_t> &input_shape) {
+    // Engines have static shapes, so the batch size is fixed when the engine is built
+    if (bytes != input_binding_bytes_) {
+        const int64_t batch = input_shape.empty() ? 0 : input_shape[0];
+        throw std::runtime_error("TensorRT input size mismatch for batch size " + std::to_string(batch) +
+                                 ": engine expects " + std::to_string(input_binding_bytes_) + " bytes, got " +
+                                 std::to_string(bytes) + ". Rebuild the engine for this batch size.");
+    }
+    cudaMemcpy(device_buffers_[input_binding_index_], data, bytes, cudaMemcpyHostToDevice);
+}
+
+void TensorRTBackend::execute() {
 // Execute inference
 // Note: executeV2() was deprecated in TensorRT 8.5 and removed in 10.0
 #if NV_TENSORRT_MAJOR >= 10
@@ -311,33 +343,37 @@ std::vector<void *> TensorRTBackend::run_inference(std::span<const float> input_
         size_t output_size = host_output_buffers_[i].size() * sizeof(float);
         cudaMemcpy(host_output_buffers_[i].data(), device_buffers_[binding_idx], output_size, cudaMemcpyDeviceToHost);
     }
-
-    // Return pointers to host buffers
-    std::vector<void *> output_ptrs;
-    for (auto &buffer : host_output_buffers_) {
-        output_ptrs.push_back(buffer.data());
-    }
-
-    return output_ptrs;
 }
 
 size_t TensorRTBackend::get_output_count() const { return output_binding_indices_.size(); }
 
 void TensorRTBackend::get_output_data(size_t output_index, float *data, size_t size) {
+    const auto view = get_output_view(output_index);
+    if (view.size() != size) {
+        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
+                                 ", Got: " + std::to_string(view.size()));
+    }
+
+    std::copy(view.begin(), view.end(), data);
+}
+
+std::span<const float> TensorRTBackend::get_output_view(size_t output_index) const {
     if (output_index >= host_output_buffers_.size()) {
         throw std::out_of_range("Output index out of range");
     }
 
-    const auto &buffer = host_output_buffers_[output_index];
-    if (buffer.size() != size) {
-        throw std::runtime_error("Output tensor size mismatch. Expected: " + std::to_string(size) +
-                                 ", Got: " + std::to_string(buffer.size()));
+    return host_output_buffers_[output_index];
+}
+
+std::vector<int64_t> TensorRTBackend::get_output_shape(size_t output_index) const {
+    if (output_index >= output_shapes_.size()) {
+        throw std::out_of_range("Output index out of range");
     }
 
-    std::copy(buffer.begin(), buffer.end(), data);
+    return output_shapes_[output_index];
 }
 
-std::vector<int64_t> TensorRTBackend::get_output_shape(size_t output_index) const {
+std::span<const int64_t> TensorRTBackend::get_output_shape_view(size_t output_index) const {
     if (output_index >= output_shapes_.size()) {
         throw std::out_of_range("Output index out of range");
     }
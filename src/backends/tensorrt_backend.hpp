@@ -50,13 +50,20 @@ class TensorRTBackend : public InferenceBackend {
     std::vector<int64_t> initialize(const std::filesystem::path &model_path,
                                     const std::vector<int64_t> &input_shape) override;
 
-    std::vector<void *> run_inference(std::span<const float> input_data,
-                                      const std::vector<int64_t> &input_shape) override;
+    void run_inference(std::span<const float> input_data, const std::vector<int64_t> &input_shape) override;
+
+    void run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) override;
+
+    [[nodiscard]] InputFormat get_input_format() const override { return input_format_; }
 
     [[nodiscard]] size_t get_output_count() const override;
 
     void get_output_data(size_t output_index, float *data, size_t size) override;
 
+    [[nodiscard]] std::span<const float> get_output_view(size_t output_index) const override;
+
+    [[nodiscard]] std::span<const int64_t> get_output_shape_view(size_t output_index) const override;
+
     [[nodiscard]] std::vector<int64_t> get_output_shape(size_t output_index) const override;
 
     [[nodiscard]] std::string get_backend_name() const override { return "TensorRT"; }
@@ -77,6 +84,12 @@ class TensorRTBackend : public InferenceBackend {
     // Deserialize engine from file
     bool deserialize_engine(const std::filesystem::path &engine_path);
 
+    // Copy the host input to the input binding, checking it matches the engine's static size
+    void upload_input(const void *data, size_t bytes, const std::vector<int64_t> &input_shape);
+
+    // Execute the engine on the uploaded input and copy outputs back to host
+    void execute();
+
     Logger logger_;
     std::unique_ptr<nvinfer1::IRuntime, TensorRTDeleter> runtime_;
     std::unique_ptr<nvinfer1::ICudaEngine, TensorRTDeleter> engine_;
@@ -89,6 +102,8 @@ class TensorRTBackend : public InferenceBackend {
     // Tensor metadata
     std::vector<std::vector<int64_t>> output_shapes_;
     int input_binding_index_ = -1;
+    size_t input_binding_bytes_ = 0;
+    InputFormat input_format_ = InputFormat::FLOAT32_NCHW;
     std::vector<int> output_binding_indices_;
 };
 
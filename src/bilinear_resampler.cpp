@@ -0,0 +1,92 @@
+#include "bilinear_resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace rfdetr::media {
+
+namespace {
+
+SourceWindow full_window(int src_width, int src_height) noexcept {
+    return {0.0f, 0.0f, static_cast<float>(src_width), static_cast<float>(src_height)};
+}
+
+void build_axis(BilinearAxis &axis, int src_size, float window_start, float window_size, int dst_size, int stride) {
+    const auto n = static_cast<size_t>(dst_size);
+    axis.i0.resize(n);
+    axis.i1.resize(n);
+    axis.w.resize(n);
+    const float scale = window_size / static_cast<float>(dst_size);
+    for (int d = 0; d < dst_size; ++d) {
+        const float src = (static_cast<float>(d) + 0.5f) * scale - 0.5f + window_start;
+        const int i0 = std::clamp(static_cast<int>(std::floor(src)), 0, src_size - 1);
+        const int i1 = std::min(i0 + 1, src_size - 1);
+        const auto idx = static_cast<size_t>(d);
+        axis.i0[idx] = i0 * stride;
+        axis.i1[idx] = i1 * stride;
+        axis.w[idx] = src - static_cast<float>(i0);
+    }
+}
+
+} // anonymous namespace
+
+BilinearResampler::BilinearResampler(int src_width, int src_height, int dst_width, int dst_height, int channels) {
+    configure(src_width, src_height, dst_width, dst_height, channels);
+}
+
+bool BilinearResampler::configure(int src_width, int src_height, int dst_width, int dst_height, int channels) {
+    return configure(src_width, src_height, full_window(src_width, src_height), dst_width, dst_height, channels);
+}
+
+bool BilinearResampler::configure(int src_width, int src_height, const SourceWindow &window, int dst_width,
+                                  int dst_height, int channels) {
+    if (matches(src_width, src_height, window, dst_width, dst_height, channels)) {
+        return false;
+    }
+    if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0 || channels <= 0) {
+        throw std::runtime_error("BilinearResampler: invalid geometry " + std::to_string(src_width) + "x" +
+                                 std::to_string(src_height) + " -> " + std::to_string(dst_width) + "x" +
+                                 std::to_string(dst_height) + " (" + std::to_string(channels) + " channels)");
+    }
+    if (!(window.width > 0.0f && window.height > 0.0f)) {
+        throw std::runtime_error("BilinearResampler: empty source window");
+    }
+
+    build_axis(x_axis_, src_width, window.x, window.width, dst_width, channels);
+    build_axis(y_axis_, src_height, window.y, window.height, dst_height, 1);
+
+    const int row_bytes = src_width * channels;
+    const auto safe_end = std::partition_point(x_axis_.i1.begin(), x_axis_.i1.end(),
+                                               [row_bytes](int32_t offset) { return offset + 4 <= row_bytes; });
+    dword_safe_columns_ = static_cast<int>(safe_end - x_axis_.i1.begin());
+
+    src_width_ = src_width;
+    src_height_ = src_height;
+    dst_width_ = dst_width;
+    dst_height_ = dst_height;
+    channels_ = channels;
+    window_ = window;
+    return true;
+}
+
+bool BilinearResampler::matches(int src_width, int src_height, int dst_width, int dst_height,
+                                int channels) const noexcept {
+    return matches(src_width, src_height, full_window(src_width, src_height), dst_width, dst_height, channels);
+}
+
+bool BilinearResampler::matches(int src_width, int src_height, const SourceWindow &window, int dst_width,
+                                int dst_height, int channels) const noexcept {
+    return src_width_ == src_width && src_height_ == src_height && dst_width_ == dst_width &&
+           dst_height_ == dst_height && channels_ == channels && window_ == window;
+}
+
+std::span<float> BilinearResampler::scratch(size_t floats) {
+    if (scratch_.size() < floats) {
+        scratch_.resize(floats);
+    }
+    return {scratch_.data(), floats};
+}
+
+} // namespace rfdetr::media
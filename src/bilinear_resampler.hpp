@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace rfdetr::media {
+
+/// Bilinear sampling positions along one axis: output index d blends source elements `i0[d]` and
+/// `i1[d]`, with weight `w[d]` on the second. Indices are pre-multiplied by the element stride
+/// (channels per pixel along x, 1 along y) so inner loops can address a row directly.
+struct BilinearAxis {
+    std::vector<int32_t> i0;
+    std::vector<int32_t> i1;
+    std::vector<float> w;
+};
+
+/// Sub-rectangle of the source, in (fractional) source pixels, that is stretched over the whole
+/// output.
+struct SourceWindow {
+    float x{0.0f};
+    float y{0.0f};
+    float width{0.0f};
+    float height{0.0f};
+
+    [[nodiscard]] bool operator==(const SourceWindow &) const noexcept = default;
+};
+
+/// Precomputed bilinear coordinate/weight tables for one (src_w, src_h) -> (dst_w, dst_h) mapping
+/// with half-pixel centers and no antialiasing (cv2.INTER_LINEAR semantics).
+///
+/// Video frames and per-instance mask upsampling repeat the same geometry for the lifetime of a
+/// stream, so the floor/clamp/weight work is done once in configure() and the inner loops only
+/// read the tables. The resampler also owns the row scratch used by single-threaded callers, so
+/// keep one instance per thread.
+class BilinearResampler {
+  public:
+    BilinearResampler() = default;
+    BilinearResampler(int src_width, int src_height, int dst_width, int dst_height, int channels = 1);
+
+    /// Rebuild the tables for a new geometry. A no-op (no allocation) when it already matches, so
+    /// it is cheap to call on every frame. Returns true if the tables were rebuilt.
+    bool configure(int src_width, int src_height, int dst_width, int dst_height, int channels = 1);
+
+    /// As above, resampling only `window` of the source (e.g. the unpadded part of a letterboxed
+    /// mask). Samples that fall outside the window still read the neighbouring source pixels.
+    bool configure(int src_width, int src_height, const SourceWindow &window, int dst_width, int dst_height,
+                   int channels = 1);
+
+    [[nodiscard]] bool matches(int src_width, int src_height, int dst_width, int dst_height,
+                               int channels = 1) const noexcept;
+    [[nodiscard]] bool matches(int src_width, int src_height, const SourceWindow &window, int dst_width,
+                               int dst_height, int channels = 1) const noexcept;
+
+    [[nodiscard]] int src_width() const noexcept { return src_width_; }
+    [[nodiscard]] int src_height() const noexcept { return src_height_; }
+    [[nodiscard]] int dst_width() const noexcept { return dst_width_; }
+    [[nodiscard]] int dst_height() const noexcept { return dst_height_; }
+    [[nodiscard]] int channels() const noexcept { return channels_; }
+
+    [[nodiscard]] const BilinearAxis &x_axis() const noexcept { return x_axis_; }
+    [[nodiscard]] const BilinearAxis &y_axis() const noexcept { return y_axis_; }
+
+    /// Leading output columns whose right-hand sample is followed by at least one more byte in a
+    /// uint8 source row, so a 4-byte load starting at the sample stays inside the row.
+    [[nodiscard]] int dword_safe_columns() const noexcept { return dword_safe_columns_; }
+
+    /// Scratch of at least `floats` elements, grown on demand and then reused.
+    [[nodiscard]] std::span<float> scratch(size_t floats);
+
+  private:
+    int src_width_{0};
+    int src_height_{0};
+    int dst_width_{0};
+    int dst_height_{0};
+    int channels_{0};
+    SourceWindow window_;
+    int dword_safe_columns_{0};
+    BilinearAxis x_axis_;
+    BilinearAxis y_axis_;
+    std::vector<float> scratch_;
+};
+
+/// Drive a separable bilinear resize over output rows [row_begin, row_end).
+///
+/// `resample_row(src_row, float *buffer)` fills `buffer` (`row_floats` elements) with one
+/// horizontally resampled source row; `emit_row(dst_row, const float *top, const float *bottom,
+/// float wy)` blends the two source rows an output row needs. Each source row is resampled once
+/// and kept while consecutive output rows still reference it. `scratch` must hold 2 * row_floats.
+template <typename ResampleRow, typename EmitRow>
+void for_each_bilinear_row(const BilinearAxis &y_axis, int row_begin, int row_end, std::span<float> scratch,
+                           size_t row_floats, ResampleRow &&resample_row, EmitRow &&emit_row) {
+    std::array<float *, 2> rows{scratch.data(), scratch.data() + row_floats};
+    std::array<int, 2> cached{-1, -1};
+    for (int y = row_begin; y < row_end; ++y) {
+        const auto idx = static_cast<size_t>(y);
+        const int y0 = y_axis.i0[idx];
+        const int y1 = y_axis.i1[idx];
+        if (cached[0] != y0) {
+            if (cached[1] == y0) {
+                std::swap(rows[0], rows[1]);
+                std::swap(cached[0], cached[1]);
+            } else {
+                resample_row(y0, rows[0]);
+                cached[0] = y0;
+            }
+        }
+        const float *bottom = rows[0];
+        if (y1 != y0) {
+            if (cached[1] != y1) {
+                resample_row(y1, rows[1]);
+                cached[1] = y1;
+            }
+            bottom = rows[1];
+        }
+        emit_row(y, rows[0], bottom, y_axis.w[idx]);
+    }
+}
+
+} // namespace rfdetr::media
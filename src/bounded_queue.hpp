@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace rfdetr::video {
+
+// A fixed line size rather than std::hardware_destructive_interference_size, whose value may change
+// with compiler tuning flags (GCC warns about that in headers)
+inline constexpr size_t kCacheLine = 64;
+
+/// Bounded multi-producer / multi-consumer queue. push() blocks when full; pop() blocks when empty.
+///
+/// The hand-off itself is lock-free: a ring of sequence-numbered cells (Vyukov's bounded MPMC
+/// queue) where producers and consumers each claim a position with one CAS, so an uncontended
+/// push/pop touches two cache lines and no kernel object. It is equally valid with a single
+/// producer and consumer. A thread that finds the queue full/empty spins briefly, then yields,
+/// and only then parks on a condition variable; the other side takes the mutex to wake it only
+/// when someone is actually parked, so a steady stream of handoffs makes no futex calls.
+template <typename T> class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity, T closed_value = T{})
+        : capacity_(std::max<size_t>(capacity, 1)), cells_(std::make_unique<Cell[]>(capacity_)),
+          closed_value_(std::move(closed_value)) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(2 * i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    /// Enqueue `value`, waiting for room; dropped if the queue is (or gets) closed.
+    void push(T value) {
+        wait_for(not_full_, [&] { return closed() || try_enqueue(value); },
+                 std::chrono::steady_clock::time_point::max());
+    }
+
+    /// Non-blocking push: drops `value` and returns false if the queue is full.
+    /// Used for shutdown poison-pills where blocking would deadlock once all
+    /// consumer threads have exited.
+    bool try_push(T value) { return !closed() && try_enqueue(value); }
+
+    T pop() {
+        std::optional<T> value;
+        wait_for(not_empty_, [&] { return dequeue_or_closed(value); }, std::chrono::steady_clock::time_point::max());
+        return std::move(*value);
+    }
+
+    /// pop() that gives up at `deadline`: std::nullopt if nothing arrived by then, `closed_value`
+    /// once the queue is closed and drained.
+    template <typename Clock, typename Duration>
+    std::optional<T> pop_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        std::optional<T> value;
+        const auto steady_deadline =
+            std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(
+                                                   std::max(deadline - Clock::now(), Duration::zero()));
+        wait_for(not_empty_, [&] { return dequeue_or_closed(value); }, steady_deadline);
+        return value;
+    }
+
+    /// Items currently queued. Only a snapshot under concurrent use (for monitoring, not control).
+    [[nodiscard]] size_t size() const noexcept {
+        // Dequeue first: the enqueue position read after it can only be further along
+        const size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+        const size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+        return std::min(enqueued - dequeued, capacity_);
+    }
+
+    void close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        wake(not_full_, true);
+        wake(not_empty_, true);
+    }
+
+  private:
+    struct alignas(kCacheLine) Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    static constexpr int kSpinIterations = 64;
+    static constexpr int kYieldIterations = 8;
+
+    [[nodiscard]] bool closed() const noexcept { return closed_.load(std::memory_order_seq_cst); }
+
+    static void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    /// Cell at position `pos` is free for producers when its sequence equals 2 * pos and holds an item
+    /// for consumers at 2 * pos + 1; a consumer hands it to the next lap with 2 * (pos + capacity).
+    /// (Vyukov's pos / pos + 1 cannot tell a full one-cell ring from an empty one.)
+    bool try_enqueue(T &value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell = nullptr;
+        while (true) {
+            cell = &cells_[pos % capacity_];
+            const size_t sequence = cell->sequence.load(std::memory_order_seq_cst);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - 2 * pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(2 * pos + 1, std::memory_order_seq_cst);
+        wake(not_empty_);
+        return true;
+    }
+
+    bool try_dequeue(std::optional<T> &value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *cell = nullptr;
+        while (true) {
+            cell = &cells_[pos % capacity_];
+            const size_t sequence = cell->sequence.load(std::memory_order_seq_cst);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - (2 * pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value.emplace(std::move(cell->value));
+        cell->sequence.store(2 * (pos + capacity_), std::memory_order_seq_cst);
+        wake(not_full_);
+        return true;
+    }
+
+    /// Items still queued are delivered after close(); only a closed, drained queue yields closed_value_.
+    bool dequeue_or_closed(std::optional<T> &value) {
+        if (try_dequeue(value)) {
+            return true;
+        }
+        if (closed()) {
+            // An item may have landed between the failed dequeue and the closed check
+            if (!try_dequeue(value)) {
+                value.emplace(closed_value_);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /// One side's parking spot: threads waiting for room (producers) or for items (consumers)
+    struct Waiters {
+        std::atomic<size_t> parked{0};
+        uint64_t epoch{0}; // bumped under park_mutex_ by every wake
+        std::condition_variable cv;
+    };
+
+    /// Retry `attempt` until it succeeds or `deadline` passes: spin, then yield, then park.
+    /// Returns false on timeout.
+    template <typename Attempt>
+    bool wait_for(Waiters &waiters, Attempt &&attempt, std::chrono::steady_clock::time_point deadline) {
+        for (int i = 0; i < kSpinIterations + kYieldIterations; ++i) {
+            if (attempt()) {
+                return true;
+            }
+            if (i < kSpinIterations) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        while (true) {
+            // Announce, then re-check. Cell sequences, closed_ and `parked` are all seq_cst, so a
+            // waker that misses the announcement made its change before it looked, and the re-check
+            // observes it
+            waiters.parked.fetch_add(1, std::memory_order_seq_cst);
+            uint64_t epoch = 0;
+            {
+                std::lock_guard lock(park_mutex_);
+                epoch = waiters.epoch;
+            }
+            if (attempt()) {
+                waiters.parked.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            bool woken = true;
+            {
+                std::unique_lock lock(park_mutex_);
+                const auto changed = [&] { return waiters.epoch != epoch; };
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    waiters.cv.wait(lock, changed);
+                } else {
+                    woken = waiters.cv.wait_until(lock, deadline, changed);
+                }
+            }
+            waiters.parked.fetch_sub(1, std::memory_order_relaxed);
+            if (!woken) {
+                return attempt();
+            }
+        }
+    }
+
+    /// Wake one parked waiter (all on close) after a change it may be waiting for
+    void wake(Waiters &waiters, bool all = false) {
+        if (waiters.parked.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        {
+            std::lock_guard lock(park_mutex_);
+            ++waiters.epoch;
+        }
+        if (all) {
+            waiters.cv.notify_all();
+        } else {
+            waiters.cv.notify_one();
+        }
+    }
+
+    const size_t capacity_;
+    std::unique_ptr<Cell[]> cells_;
+    T closed_value_;
+
+    alignas(kCacheLine) std::atomic<size_t> enqueue_pos_{0};
+    alignas(kCacheLine) std::atomic<size_t> dequeue_pos_{0};
+    alignas(kCacheLine) std::atomic<bool> closed_{false};
+
+    std::mutex park_mutex_;
+    Waiters not_full_;  // producers waiting for room
+    Waiters not_empty_; // consumers waiting for items
+};
+
+} // namespace rfdetr::video
@@ -0,0 +1,193 @@
+#include "chunked_pipeline.hpp"
+
+#include "thread_pool.hpp"
+#include "video_reader.hpp"
+#include "video_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace rfdetr::video {
+
+namespace {
+
+constexpr std::string_view kFramePrefix = "{\"frame\": ";
+
+void remove_parts(std::span<const std::filesystem::path> parts) {
+    for (const auto &part : parts) {
+        std::error_code ignored;
+        std::filesystem::remove(part, ignored);
+    }
+}
+
+// The part files of one run; deleted when it ends, however it ends, unless they are to be kept
+class PartFiles {
+  public:
+    explicit PartFiles(bool keep) : keep_(keep) {}
+    ~PartFiles() {
+        if (!keep_) {
+            remove_parts(videos);
+            remove_parts(logs);
+        }
+    }
+
+    PartFiles(const PartFiles &) = delete;
+    PartFiles &operator=(const PartFiles &) = delete;
+
+    std::vector<std::filesystem::path> videos;
+    std::vector<std::filesystem::path> logs;
+
+  private:
+    bool keep_;
+};
+
+void check_config(const ChunkedPipelineConfig &config) {
+    if (config.parallel == 0) {
+        throw std::runtime_error("ChunkedPipelineConfig::parallel must be at least 1");
+    }
+    if (config.pipeline.display || !config.pipeline.prometheus_path.empty()) {
+        throw std::runtime_error("ChunkedVideoPipeline supports neither the preview nor a Prometheus file");
+    }
+}
+
+} // anonymous namespace
+
+std::filesystem::path part_path(const std::filesystem::path &path, size_t index) {
+    std::ostringstream name;
+    name << path.stem().string() << ".part" << std::setw(3) << std::setfill('0') << index
+         << path.extension().string();
+    return path.parent_path() / name.str();
+}
+
+void merge_detection_logs(std::span<const std::filesystem::path> parts, const std::filesystem::path &output) {
+    std::ofstream out(output);
+    if (!out) {
+        throw std::runtime_error("Could not write detections to " + output.string());
+    }
+    size_t offset = 0;
+    for (const auto &part : parts) {
+        std::ifstream in(part);
+        if (!in) {
+            throw std::runtime_error("Could not read detections from " + part.string());
+        }
+        // Every frame has one line and a part numbers its frames from 0
+        size_t lines = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.starts_with(kFramePrefix)) {
+                throw std::runtime_error("Unexpected detections line in " + part.string());
+            }
+            size_t digits = 0;
+            const size_t frame = std::stoull(line.substr(kFramePrefix.size()), &digits);
+            out << kFramePrefix << offset + frame << std::string_view(line).substr(kFramePrefix.size() + digits)
+                << "\n";
+            ++lines;
+        }
+        offset += lines;
+    }
+}
+
+ChunkedVideoPipeline::ChunkedVideoPipeline(const ChunkedPipelineConfig &config) : config_(config) {
+    check_config(config_);
+    const size_t count = config_.chunks == 0 ? config_.parallel : config_.chunks;
+
+    // Only headers and one frame per cut are decoded, so the probe needs no decoder threads.
+    rfdetr::media::VideoReaderOptions probe_options;
+    probe_options.threads = 1;
+    rfdetr::media::VideoReader probe(config_.pipeline.video_path, probe_options);
+    const double begin = config_.pipeline.start_time.value_or(probe.start_timestamp());
+    const double end = config_.pipeline.end_time.value_or(probe.start_timestamp() + probe.duration());
+
+    // Cut at the keyframe at or before each evenly spaced time. With long GOPs (or an unknown
+    // duration) several cuts can fall on one keyframe; those chunks merge.
+    std::vector<double> cuts;
+    for (size_t i = 1; i < count && end > begin; ++i) {
+        const double cut =
+            probe.seek_keyframe(begin + (end - begin) * static_cast<double>(i) / static_cast<double>(count));
+        if (cut > begin && (cuts.empty() || cut > cuts.back())) {
+            cuts.push_back(cut);
+        }
+    }
+
+    chunks_.resize(cuts.size() + 1);
+    chunks_.front().start_time = config_.pipeline.start_time;
+    chunks_.back().end_time = config_.pipeline.end_time;
+    for (size_t i = 0; i < cuts.size(); ++i) {
+        chunks_[i].end_time = cuts[i];
+        chunks_[i + 1].start_time = cuts[i];
+    }
+}
+
+ChunkedVideoPipeline::ChunkedVideoPipeline(const ChunkedPipelineConfig &config, std::vector<ChunkRange> chunks)
+    : config_(config), chunks_(std::move(chunks)) {
+    check_config(config_);
+    if (chunks_.empty()) {
+        throw std::runtime_error("ChunkedVideoPipeline needs at least one chunk");
+    }
+}
+
+size_t ChunkedVideoPipeline::run() {
+    return run([](const VideoPipelineConfig &config) {
+        VideoPipeline pipeline(config);
+        return pipeline.run();
+    });
+}
+
+size_t ChunkedVideoPipeline::run(const ChunkRunner &run_chunk) {
+    const VideoPipelineConfig &base = config_.pipeline;
+    std::vector<VideoPipelineConfig> configs(chunks_.size(), base);
+    PartFiles parts(config_.keep_parts);
+    for (size_t i = 0; i < configs.size(); ++i) {
+        VideoPipelineConfig &chunk = configs[i];
+        chunk.start_time = chunks_[i].start_time;
+        chunk.end_time = chunks_[i].end_time;
+        if (!base.output_path.empty()) {
+            chunk.output_path = part_path(base.output_path, i);
+            parts.videos.push_back(chunk.output_path);
+        }
+        if (!base.detections_path.empty()) {
+            chunk.detections_path = part_path(base.detections_path, i);
+            parts.logs.push_back(chunk.detections_path);
+        }
+        if (!base.stats_json_path.empty()) {
+            chunk.stats_json_path = part_path(base.stats_json_path, i);
+        }
+        if (!base.trace_path.empty()) {
+            chunk.trace_path = part_path(base.trace_path, i);
+        }
+    }
+
+    // Each participant takes the next chunk when it finishes one, so a slow chunk does not hold
+    // back the ones queued behind it
+    std::vector<size_t> frames(configs.size(), 0);
+    std::atomic<size_t> next{0};
+    rfdetr::concurrency::ThreadPool pool(std::min(config_.parallel, configs.size()));
+    pool.run(pool.size(), [&](size_t /*participant*/) {
+        for (size_t i = next.fetch_add(1); i < configs.size(); i = next.fetch_add(1)) {
+            try {
+                frames[i] = run_chunk(configs[i]);
+            } catch (...) {
+                next.store(configs.size()); // start no further chunks
+                throw;
+            }
+        }
+    });
+
+    if (!parts.videos.empty()) {
+        rfdetr::media::concat_videos(parts.videos, base.output_path);
+    }
+    if (!parts.logs.empty()) {
+        merge_detection_logs(parts.logs, base.detections_path);
+    }
+    return std::accumulate(frames.begin(), frames.end(), size_t{0});
+}
+
+} // namespace rfdetr::video
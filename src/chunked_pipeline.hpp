@@ -0,0 +1,78 @@
+#pragma once
+
+#include "video_pipeline.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace rfdetr::video {
+
+/// Configuration for ChunkedVideoPipeline.
+struct ChunkedPipelineConfig {
+    /// Settings of every chunk's pipeline; output_path / detections_path name the merged results.
+    /// start_time / end_time limit the whole run. Each chunk writes its stats_json_path and
+    /// trace_path with a ".partNNN" suffix; the Prometheus file and the preview are not supported
+    /// and must be left off.
+    VideoPipelineConfig pipeline;
+    /// Chunks to cut the input into (0 = one per concurrent pipeline). More chunks than pipelines
+    /// evens out chunks that take longer than others.
+    size_t chunks{0};
+    /// VideoPipeline instances running at once. Each holds its own reader, ring, writer and model
+    /// session(s) per inference worker, so memory grows with it.
+    size_t parallel{1};
+    /// Keep the per-chunk videos and detection logs after merging them (for debugging)
+    bool keep_parts{false};
+};
+
+/// Time range of one chunk, in VideoReader::timestamp() seconds (nullopt = open end).
+struct ChunkRange {
+    std::optional<double> start_time;
+    std::optional<double> end_time;
+};
+
+/// Processes one long video with several independent VideoPipelines at once.
+///
+/// The input is cut at keyframes (VideoReader::seek_keyframe()) into chunks that together hold
+/// every frame exactly once, and each chunk decodes from its own keyframe, so no GOP is decoded
+/// twice. Chunks are handed to `parallel` pipelines in order, each with its own reader, model
+/// sessions and writer. Afterwards the chunk videos are joined without re-encoding
+/// (concat_videos(); they keep the source timestamps, so they line up) and the detection logs
+/// are merged in order with frame numbers counted across the whole input. This is what fills a
+/// many-core machine when a single pipeline tops out below the cores available.
+class ChunkedVideoPipeline {
+  public:
+    /// Runs one chunk's pipeline to completion and returns the frames it processed
+    using ChunkRunner = std::function<size_t(const VideoPipelineConfig &)>;
+
+    explicit ChunkedVideoPipeline(const ChunkedPipelineConfig &config);
+
+    /// Test-friendly constructor: process the given chunks as they are (skips probing the input)
+    ChunkedVideoPipeline(const ChunkedPipelineConfig &config, std::vector<ChunkRange> chunks);
+
+    /// Run every chunk and merge the results (blocking). Returns total frames processed. The part
+    /// files are removed on every exit, including a failed chunk or merge, unless keep_parts is set.
+    size_t run();
+
+    /// As run(), with `run_chunk` in place of a VideoPipeline per chunk
+    size_t run(const ChunkRunner &run_chunk);
+
+    /// The chunks run() processes, in order.
+    [[nodiscard]] const std::vector<ChunkRange> &chunks() const noexcept { return chunks_; }
+
+  private:
+    ChunkedPipelineConfig config_;
+    std::vector<ChunkRange> chunks_;
+};
+
+/// `path` with ".partNNN" inserted before the extension ("out.mp4" -> "out.part003.mp4").
+[[nodiscard]] std::filesystem::path part_path(const std::filesystem::path &path, size_t index);
+
+/// Concatenate JSON Lines detection logs (write_detections_jsonl()) into `output`, renumbering
+/// "frame" so it counts across all parts: each part's frames follow the previous part's.
+void merge_detection_logs(std::span<const std::filesystem::path> parts, const std::filesystem::path &output);
+
+} // namespace rfdetr::video
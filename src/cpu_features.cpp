@@ -0,0 +1,86 @@
+#include "cpu_features.hpp"
+
+#include <array>
+#include <cstdlib>
+
+namespace rfdetr::cpu {
+
+namespace {
+
+SimdLevel detect_simd_level() noexcept {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SCALAR;
+#elif defined(__aarch64__)
+    // Advanced SIMD is mandatory on AArch64.
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+SimdLevel hardware_simd_level() noexcept {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+/// Apply the RFDETR_SIMD cap, if any, to the hardware level.
+SimdLevel capped_simd_level() noexcept {
+    const SimdLevel hw = hardware_simd_level();
+    const char *env = std::getenv("RFDETR_SIMD");
+    if (env == nullptr) {
+        return hw;
+    }
+    constexpr std::array kLevels{SimdLevel::SCALAR, SimdLevel::NEON, SimdLevel::AVX2, SimdLevel::AVX512};
+    const std::string_view requested(env);
+    for (const SimdLevel level : kLevels) {
+        if (requested == to_string(level)) {
+            return simd_level_supported(level) ? level : (level < hw ? SimdLevel::SCALAR : hw);
+        }
+    }
+    return hw;
+}
+
+} // anonymous namespace
+
+bool simd_level_supported(SimdLevel level) noexcept {
+    const SimdLevel hw = hardware_simd_level();
+    switch (level) {
+    case SimdLevel::SCALAR:
+        return true;
+    case SimdLevel::NEON:
+        return hw == SimdLevel::NEON;
+    case SimdLevel::AVX2:
+        return hw == SimdLevel::AVX2 || hw == SimdLevel::AVX512;
+    case SimdLevel::AVX512:
+        return hw == SimdLevel::AVX512;
+    }
+    return false;
+}
+
+SimdLevel best_simd_level() noexcept {
+    static const SimdLevel level = capped_simd_level();
+    return level;
+}
+
+std::string_view to_string(SimdLevel level) noexcept {
+    switch (level) {
+    case SimdLevel::SCALAR:
+        return "scalar";
+    case SimdLevel::NEON:
+        return "neon";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+} // namespace rfdetr::cpu
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string_view>
+
+namespace rfdetr::cpu {
+
+/// Vector instruction sets the hand-written kernels are specialized for.
+/// Ordered from least to most capable within each architecture family.
+enum class SimdLevel { SCALAR, NEON, AVX2, AVX512 };
+
+/// True if the running CPU (and this build) can execute kernels compiled for `level`.
+[[nodiscard]] bool simd_level_supported(SimdLevel level) noexcept;
+
+/// The widest SimdLevel supported by the running CPU. Detected once and cached.
+///
+/// Set RFDETR_SIMD=scalar|neon|avx2|avx512 to cap the level (useful for A/B benchmarking
+/// and for reproducing ISA-specific issues); an unsupported request falls back to the best
+/// supported level below it.
+[[nodiscard]] SimdLevel best_simd_level() noexcept;
+
+[[nodiscard]] std::string_view to_string(SimdLevel level) noexcept;
+
+} // namespace rfdetr::cpu
@@ -2,8 +2,14 @@
 
 #include "media.hpp"
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <utility>
 
 namespace rfdetr::media {
 
@@ -35,4 +41,68 @@ class Display {
     std::unique_ptr<Impl> impl_;
 };
 
+/// Single-slot "latest frame wins" hand-off from one producer to a preview thread.
+///
+/// post() copies the frame, so the caller can recycle its buffer at once, and replaces any frame
+/// the preview has not picked up yet; a slow window (e.g. a vsync'd present) therefore drops stale
+/// frames instead of stalling the producer. Three buffers rotate between producer, mailbox and
+/// consumer, so once they have grown to the frame size nothing is allocated.
+class FrameMailbox {
+  public:
+    /// Producer side (a single thread): publish a copy of `frame` tagged with `frame_number`.
+    void post(const Image &frame, int64_t frame_number) {
+        staging_.width = frame.width;
+        staging_.height = frame.height;
+        staging_.bgr.assign(frame.bgr.begin(), frame.bgr.end());
+        {
+            std::lock_guard lock(mutex_);
+            if (closed_) {
+                return;
+            }
+            if (pending_number_) {
+                ++dropped_;
+            }
+            std::swap(staging_, pending_);
+            pending_number_ = frame_number;
+        }
+        ready_.notify_one();
+    }
+
+    /// Consumer side: wait for a frame newer than the last one taken and swap it into `frame`.
+    /// Returns its frame number, or std::nullopt once the mailbox is closed and empty.
+    std::optional<int64_t> take(Image &frame) {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [this] { return closed_ || pending_number_.has_value(); });
+        if (!pending_number_) {
+            return std::nullopt;
+        }
+        std::swap(frame, pending_);
+        return std::exchange(pending_number_, std::nullopt);
+    }
+
+    /// Wake the consumer; a frame still pending is delivered first, later posts are ignored.
+    void close() {
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    /// Frames replaced before the consumer took them
+    [[nodiscard]] size_t dropped() const {
+        std::lock_guard lock(mutex_);
+        return dropped_;
+    }
+
+  private:
+    Image staging_; // producer-owned
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    Image pending_;
+    std::optional<int64_t> pending_number_;
+    size_t dropped_{0};
+    bool closed_{false};
+};
+
 } // namespace rfdetr::media
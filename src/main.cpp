@@ -1,10 +1,24 @@
+#include "chunked_pipeline.hpp"
 #include "rfdetr_inference.hpp"
+#include "tracer.hpp"
 #include "video_pipeline.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 namespace {
 
@@ -15,6 +29,71 @@ bool is_video_file(const std::filesystem::path &path) {
     return video_exts.contains(ext);
 }
 
+// Seconds from "[[hh:]mm:]ss[.fff]", e.g. "90", "1:30" or "01:01:30.5"; throws on anything else
+double parse_time(const std::string &text) {
+    double seconds = 0.0;
+    size_t begin = 0;
+    while (true) {
+        const size_t colon = text.find(':', begin);
+        const std::string field = text.substr(begin, colon - begin);
+        // stod() alone would take signs, spaces, "inf" and trailing garbage
+        size_t parsed = 0;
+        double value = 0.0;
+        if (!field.empty() && (std::isdigit(static_cast<unsigned char>(field[0])) != 0 || field[0] == '.')) {
+            try {
+                value = std::stod(field, &parsed);
+            } catch (const std::logic_error &) {
+                parsed = 0;
+            }
+        }
+        if (parsed == 0 || parsed != field.size() || !std::isfinite(value)) {
+            throw std::runtime_error("Invalid time '" + text + "', expected [[hh:]mm:]ss[.fff]");
+        }
+        seconds = seconds * 60.0 + value;
+        if (colon == std::string::npos) {
+            return seconds;
+        }
+        begin = colon + 1;
+    }
+}
+
+// Comma-separated fields of an option value ("2,1,4" -> {"2", "1", "4"})
+std::vector<std::string> split_fields(const std::string &text) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (size_t comma = text.find(','); comma != std::string::npos; comma = text.find(',', begin)) {
+        fields.push_back(text.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    fields.push_back(text.substr(begin));
+    return fields;
+}
+
+// Decimal count given to `option`, in [min, max]. Digits only: stoul() would wrap "-1" to SIZE_MAX
+// and ignore trailing garbage.
+size_t parse_count(const std::string &text, const std::string &option, size_t min = 1, size_t max = SIZE_MAX) {
+    const bool digits = !text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char c) {
+        return std::isdigit(c) != 0;
+    });
+    size_t value = 0;
+    try {
+        value = digits ? std::stoul(text) : 0;
+    } catch (const std::out_of_range &) {
+        value = SIZE_MAX;
+        if (max == SIZE_MAX) {
+            throw std::runtime_error(option + " value '" + text + "' is too large");
+        }
+    }
+    if (value > max) {
+        throw std::runtime_error(option + " value '" + text + "' is too large, at most " + std::to_string(max));
+    }
+    if (!digits || value < min) {
+        throw std::runtime_error(option + " expects a whole number of at least " + std::to_string(min) + ", got '" +
+                                 text + "'");
+    }
+    return value;
+}
+
 // Usage text is specialized to the backend compiled into this binary: only one exists at a time, so
 // showing the model container it actually accepts is more useful than listing all three.
 #if defined(USE_TENSORRT)
@@ -37,7 +116,11 @@ int main(int argc, const char *argv[]) {
     if (argc < 4) {
         std::cerr << "Usage: " << argv[0]
                   << " <path_to_model> <path_to_image_or_video> <path_to_coco_labels> [--segmentation|--keypoint] "
-                     "[--threshold <val>] [--display]"
+                     "[--threshold <val>] [--display] [--letterbox] [--preprocess-threads <n>] [--mask-threads <n>] "
+                     "[--workers <preprocess>,<infer>,<postprocess>,<draw>] [--batch <max_size>[,<max_wait_us>]] "
+                     "[--decode-threads <n>] [--scan <all|reference|keyframes>[,<every_n>]] [--detections <path>] "
+                     "[--start <[hh:]mm:ss>] [--end <[hh:]mm:ss>] [--chunks <n>[,<parallel>]] [--stats-json <path>] "
+                     "[--prometheus <path>] [--trace <path>]"
                   << std::endl;
         std::cerr << "Examples:" << std::endl;
         std::cerr << "  Detection:    " << argv[0] << " " << kExampleModel << " ./image.jpg ./coco_labels.txt"
@@ -50,6 +133,8 @@ int main(int argc, const char *argv[]) {
                   << std::endl;
         std::cerr << "  Video+display:" << argv[0] << " " << kExampleModel << " ./video.mp4 ./coco_labels.txt --display"
                   << std::endl;
+        std::cerr << "  Archive scan: " << argv[0] << " " << kExampleModel
+                  << " ./video.mp4 ./coco_labels.txt --scan keyframes --detections ./detections.jsonl" << std::endl;
         std::cerr << std::endl;
         std::cerr << "Note: exactly one backend is selected at compile time; this binary was built with" << std::endl;
         std::cerr << "      " << kBackendDescription << std::endl;
@@ -65,21 +150,99 @@ int main(int argc, const char *argv[]) {
     bool use_segmentation = false;
     bool use_keypoint = false;
     bool display = false;
+    bool letterbox = false;
     float threshold = -1.0f; // -1 = use Config default
+    size_t preprocess_threads = 1;
+    size_t mask_threads = 1;
+    int decode_threads = 0;
+    rfdetr::media::DecodeScan scan = rfdetr::media::DecodeScan::ALL_FRAMES;
+    int keep_every = 1;
+    std::filesystem::path detections_path;
+    std::optional<double> start_time;
+    std::optional<double> end_time;
+    size_t chunks = 0; // 0 = one pipeline over the whole input
+    size_t parallel_chunks = 1;
+    std::array<size_t, 4> workers{1, 1, 1, 1}; // preprocess, infer, postprocess, draw
+    size_t max_batch_size = 1;
+    std::chrono::microseconds::rep max_batch_wait_us = 0;
+    std::filesystem::path stats_json_path;
+    std::filesystem::path prometheus_path;
+    std::filesystem::path trace_path;
 
-    for (int i = 4; i < argc; ++i) {
-        if (std::strcmp(argv[i], "--segmentation") == 0) {
-            use_segmentation = true;
-        } else if (std::strcmp(argv[i], "--keypoint") == 0) {
-            use_keypoint = true;
-        } else if (std::strcmp(argv[i], "--display") == 0) {
-            display = true;
-        } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
-            threshold = std::stof(argv[++i]);
+    try {
+        for (int i = 4; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--segmentation") == 0) {
+                use_segmentation = true;
+            } else if (std::strcmp(argv[i], "--keypoint") == 0) {
+                use_keypoint = true;
+            } else if (std::strcmp(argv[i], "--display") == 0) {
+                display = true;
+            } else if (std::strcmp(argv[i], "--letterbox") == 0) {
+                letterbox = true;
+            } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+                threshold = std::stof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--preprocess-threads") == 0 && i + 1 < argc) {
+                preprocess_threads = std::stoul(argv[++i]);
+            } else if (std::strcmp(argv[i], "--mask-threads") == 0 && i + 1 < argc) {
+                mask_threads = std::stoul(argv[++i]);
+            } else if (std::strcmp(argv[i], "--decode-threads") == 0 && i + 1 < argc) {
+                decode_threads = std::stoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--scan") == 0 && i + 1 < argc) {
+                const std::string mode = argv[++i];
+                const std::string name = mode.substr(0, mode.find(','));
+                if (name == "keyframes") {
+                    scan = rfdetr::media::DecodeScan::KEYFRAMES;
+                } else if (name == "reference") {
+                    scan = rfdetr::media::DecodeScan::REFERENCE_FRAMES;
+                } else if (name != "all") {
+                    std::cerr << "Unknown --scan mode: " << name << std::endl;
+                    return 1;
+                }
+                if (name.size() < mode.size()) {
+                    keep_every = static_cast<int>(parse_count(mode.substr(name.size() + 1), "--scan every_n", 1,
+                                                              static_cast<size_t>(std::numeric_limits<int>::max())));
+                }
+            } else if (std::strcmp(argv[i], "--detections") == 0 && i + 1 < argc) {
+                detections_path = argv[++i];
+            } else if (std::strcmp(argv[i], "--start") == 0 && i + 1 < argc) {
+                start_time = parse_time(argv[++i]);
+            } else if (std::strcmp(argv[i], "--end") == 0 && i + 1 < argc) {
+                end_time = parse_time(argv[++i]);
+            } else if (std::strcmp(argv[i], "--chunks") == 0 && i + 1 < argc) {
+                const auto fields = split_fields(argv[++i]);
+                if (fields.size() > 2) {
+                    throw std::runtime_error("--chunks expects <n>[,<parallel>]");
+                }
+                chunks = parse_count(fields[0], "--chunks n");
+                parallel_chunks = fields.size() == 2 ? parse_count(fields[1], "--chunks parallel") : chunks;
+            } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+                const auto counts = split_fields(argv[++i]);
+                if (counts.size() != workers.size()) {
+                    throw std::runtime_error("--workers expects <preprocess>,<infer>,<postprocess>,<draw>");
+                }
+                for (size_t stage = 0; stage < workers.size(); ++stage) {
+                    workers[stage] = parse_count(counts[stage], "--workers");
+                }
+            } else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+                const auto fields = split_fields(argv[++i]);
+                if (fields.size() > 2) {
+                    throw std::runtime_error("--batch expects <max_size>[,<max_wait_us>]");
+                }
+                max_batch_size = parse_count(fields[0], "--batch max_size");
+                if (fields.size() == 2) {
+                    max_batch_wait_us = static_cast<std::chrono::microseconds::rep>(
+                        parse_count(fields[1], "--batch max_wait_us", 0,
+                                    std::numeric_limits<std::chrono::microseconds::rep>::max()));
+                }
+            } else if (std::strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+                stats_json_path = argv[++i];
+            } else if (std::strcmp(argv[i], "--prometheus") == 0 && i + 1 < argc) {
+                prometheus_path = argv[++i];
+            } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+                trace_path = argv[++i];
+            }
         }
-    }
 
-    try {
         Config config;
         config.resolution = 0; // 0 = auto-detect from model
         if (use_keypoint) {
@@ -87,6 +250,7 @@ int main(int argc, const char *argv[]) {
         } else {
             config.model_type = use_segmentation ? ModelType::SEGMENTATION : ModelType::DETECTION;
         }
+        config.resize_mode = letterbox ? ResizeMode::LETTERBOX : ResizeMode::STRETCH;
         config.max_detections = 300;
         config.mask_threshold = 0.0F;
         if (threshold >= 0.0f) {
@@ -106,38 +270,109 @@ int main(int argc, const char *argv[]) {
             vconfig.output_path = "output_video.mp4";
             vconfig.inference_config = config;
             vconfig.ring_buffer_size = 8;
+            vconfig.decoder.threads = decode_threads;
+            vconfig.decoder.scan = scan;
+            vconfig.decoder.keep_every = keep_every;
+            vconfig.detections_path = detections_path;
+            vconfig.start_time = start_time;
+            vconfig.end_time = end_time;
+            const bool scanning = scan != rfdetr::media::DecodeScan::ALL_FRAMES || keep_every > 1;
+            if (scanning) {
+                // A video of sampled frames is not worth encoding; the detections are the result
+                vconfig.output_path.clear();
+                if (vconfig.detections_path.empty()) {
+                    vconfig.detections_path = "detections.jsonl";
+                }
+            }
+            vconfig.preprocess_threads = preprocess_threads;
+            vconfig.mask_threads = mask_threads;
+            vconfig.preprocess_workers = workers[0];
+            vconfig.infer_workers = workers[1];
+            vconfig.postprocess_workers = workers[2];
+            vconfig.draw_workers = workers[3];
+            vconfig.max_batch_size = max_batch_size;
+            vconfig.max_batch_wait = std::chrono::microseconds(max_batch_wait_us);
+            vconfig.input_format = probe.get_input_format();
             vconfig.display = display;
+            vconfig.stats_json_path = stats_json_path;
+            vconfig.prometheus_path = prometheus_path;
+            vconfig.trace_path = trace_path;
 
-            rfdetr::video::VideoPipeline pipeline(vconfig);
-            const size_t total = pipeline.run();
-            std::cout << "Processed " << total << " frames. Output: " << vconfig.output_path.string() << std::endl;
+            size_t total = 0;
+            if (chunks > 0) {
+                rfdetr::video::ChunkedPipelineConfig cconfig;
+                cconfig.pipeline = vconfig;
+                cconfig.chunks = chunks;
+                cconfig.parallel = parallel_chunks;
+                rfdetr::video::ChunkedVideoPipeline pipeline(cconfig);
+                std::cout << "Processing " << pipeline.chunks().size() << " chunks, " << parallel_chunks
+                          << " at a time" << std::endl;
+                total = pipeline.run();
+            } else {
+                rfdetr::video::VideoPipeline pipeline(vconfig);
+                total = pipeline.run();
+            }
+            std::cout << "Processed " << total << " frames.";
+            if (!vconfig.output_path.empty()) {
+                std::cout << " Output: " << vconfig.output_path.string();
+            }
+            if (!vconfig.detections_path.empty()) {
+                std::cout << " Detections: " << vconfig.detections_path.string();
+            }
+            std::cout << std::endl;
+            if (!stats_json_path.empty()) {
+                std::cout << "Pipeline stats: " << stats_json_path.string() << std::endl;
+            }
         } else {
             // --- Single image inference (existing logic) ---
+            std::unique_ptr<rfdetr::profiling::Tracer> tracer;
+            rfdetr::profiling::TraceBuffer *trace = nullptr;
+            if (!trace_path.empty()) {
+                tracer = std::make_unique<rfdetr::profiling::Tracer>();
+                trace = &tracer->thread_buffer("main");
+            }
+            // Close the span that started at the previous mark (or here) as `name`
+            auto mark = [trace, last = rfdetr::profiling::TraceClock::now()](const char *name) mutable {
+                const auto now = rfdetr::profiling::TraceClock::now();
+                if (trace != nullptr) {
+                    trace->complete(name, last, now, 0);
+                }
+                last = now;
+            };
+
             RFDETRInference inference(model_path, label_file_path, config);
+            mark("load_model");
 
             int orig_h = 0;
             int orig_w = 0;
-            std::vector<float> input_data = inference.preprocess_image(input_path, orig_h, orig_w);
-
-            inference.run_inference(input_data);
+            if (inference.get_input_format() == InputFormat::UINT8_NHWC) {
+                const std::vector<uint8_t> input_data =
+                    inference.preprocess_image_u8(rfdetr::media::load_image(input_path), orig_h, orig_w);
+                mark("preprocess");
+                inference.run_inference(input_data);
+            } else {
+                const std::vector<float> input_data = inference.preprocess_image(input_path, orig_h, orig_w);
+                mark("preprocess");
+                inference.run_inference(input_data);
+            }
+            mark("infer");
 
             std::vector<float> scores;
             std::vector<int> class_ids;
             std::vector<BoundingBox> boxes;
             std::vector<rfdetr::media::Mask> masks;
             std::vector<std::vector<KeypointResult>> keypoints;
-            const float scale_w = static_cast<float>(orig_w) / static_cast<float>(inference.get_resolution());
-            const float scale_h = static_cast<float>(orig_h) / static_cast<float>(inference.get_resolution());
+            const InputTransform transform = inference.make_input_transform(orig_w, orig_h);
 
             if (use_keypoint) {
-                inference.postprocess_keypoint_outputs(scale_w, scale_h, orig_h, orig_w, scores, class_ids, boxes,
-                                                       keypoints);
+                inference.postprocess_keypoint_outputs(transform, scores, class_ids, boxes, keypoints);
             } else if (use_segmentation) {
-                inference.postprocess_segmentation_outputs(scale_w, scale_h, orig_h, orig_w, scores, class_ids, boxes,
-                                                           masks);
+                rfdetr::concurrency::ThreadPool mask_pool(mask_threads);
+                inference.postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks, mask_pool);
             } else {
-                inference.postprocess_outputs(scale_w, scale_h, scores, class_ids, boxes);
+                inference.postprocess_outputs(transform, scores, class_ids, boxes);
             }
+            mark("postprocess");
 
             rfdetr::media::Image image = rfdetr::media::load_image(input_path);
             if (image.empty()) {
@@ -151,6 +386,7 @@ int main(int argc, const char *argv[]) {
             } else {
                 inference.draw_detections(image, boxes, class_ids, scores);
             }
+            mark("draw");
 
             const std::filesystem::path output_path = "output_image.jpg";
             if (const auto saved_path = inference.save_output_image(image, output_path)) {
@@ -158,6 +394,15 @@ int main(int argc, const char *argv[]) {
             } else {
                 throw std::runtime_error("Could not save output image to " + output_path.string());
             }
+            mark("encode");
+            if (tracer != nullptr) {
+                std::ofstream out(trace_path);
+                if (!out) {
+                    throw std::runtime_error("Could not write trace to " + trace_path.string());
+                }
+                tracer->write_json(out);
+                std::cout << "Trace written to: " << trace_path.string() << std::endl;
+            }
 
             const std::string result_type =
                 use_keypoint ? "Keypoint" : (use_segmentation ? "Segmentation" : "Detection");
@@ -1,5 +1,6 @@
 #include "media.hpp"
 
+#include "preprocess_kernels.hpp"
 #include "processing_utils.hpp"
 
 #include <algorithm>
@@ -187,88 +188,316 @@ size_t count_nonzero(const Mask &mask) noexcept {
         std::count_if(mask.data.begin(), mask.data.end(), [](uint8_t value) { return value != 0; }));
 }
 
+size_t count_nonzero(const RleMask &mask) noexcept {
+    size_t total = 0;
+    for (size_t i = 1; i < mask.counts.size(); i += 2) {
+        total += mask.counts[i];
+    }
+    return total;
+}
+
+RleMask encode_rle(const Mask &mask, int width, int height) {
+    RleMask out;
+    encode_rle(mask, width, height, out);
+    return out;
+}
+
+void encode_rle(const Mask &mask, int width, int height, RleMask &out) {
+    out.width = width;
+    out.height = height;
+    out.counts.clear();
+
+    // Columns and rows outside the mask region are background; only its columns need scanning
+    const int x0 = std::clamp(mask.x, 0, width);
+    const int x1 = std::clamp(mask.x + mask.width, x0, width);
+    const int y0 = std::clamp(mask.y, 0, height);
+    const int y1 = std::clamp(mask.y + mask.height, y0, height);
+
+    uint32_t run = 0;
+    bool foreground = false;
+    const auto extend = [&](bool value, uint32_t pixels) {
+        if (pixels == 0) {
+            return;
+        }
+        if (value != foreground) {
+            out.counts.push_back(run);
+            run = 0;
+            foreground = value;
+        }
+        run += pixels;
+    };
+
+    const auto column = static_cast<uint32_t>(height);
+    extend(false, static_cast<uint32_t>(x0) * column);
+    for (int x = x0; x < x1; ++x) {
+        extend(false, static_cast<uint32_t>(y0));
+        for (int y = y0; y < y1; ++y) {
+            extend(mask.at(x, y) != 0, 1);
+        }
+        extend(false, static_cast<uint32_t>(height - y1));
+    }
+    extend(false, static_cast<uint32_t>(width - x1) * column);
+    out.counts.push_back(run);
+}
+
 void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
                           std::span<const float, 3> stds) {
+    resize_normalize_bgr_to_chw(image, output, resolution, make_normalize_coefficients(means, stds),
+                                cpu::best_simd_level());
+}
+
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, BilinearResampler &resampler) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    preprocess_bgr_image(image, output, resolution, means, stds,
+                         processing::make_input_transform(ResizeMode::STRETCH, image.width, image.height, resolution),
+                         resampler);
+}
+
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, BilinearResampler &resampler,
+                          concurrency::ThreadPool &pool) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    preprocess_bgr_image(image, output, resolution, means, stds,
+                         processing::make_input_transform(ResizeMode::STRETCH, image.width, image.height, resolution),
+                         resampler, pool);
+}
+
+namespace {
+
+// Checks shared by the float CHW and uint8 HWC paths; `output_elements` is the tensor size.
+void validate_input_transform(const Image &image, size_t output_elements, int resolution, const InputTransform &t) {
     if (image.empty()) {
         throw std::runtime_error("Input image is empty");
     }
+    if (t.src_width != image.width || t.src_height != image.height) {
+        throw std::runtime_error("Input transform was computed for a " + std::to_string(t.src_width) + "x" +
+                                 std::to_string(t.src_height) + " image, got " + std::to_string(image.width) + "x" +
+                                 std::to_string(image.height));
+    }
+    if (t.content_width <= 0 || t.content_height <= 0 || t.content_x < 0 || t.content_y < 0 ||
+        t.content_x + t.content_width > resolution || t.content_y + t.content_height > resolution) {
+        throw std::runtime_error("Input transform content box does not fit the model resolution");
+    }
     const auto res = static_cast<size_t>(resolution);
-    if (output.size() < 3 * res * res) {
+    if (output_elements < 3 * res * res) {
         throw std::runtime_error("Output tensor is too small for requested resolution");
     }
+}
 
-    const float scale_x = static_cast<float>(image.width) / static_cast<float>(resolution);
-    const float scale_y = static_cast<float>(image.height) / static_cast<float>(resolution);
-    const size_t channel_size = res * res;
-    const size_t img_w = static_cast<size_t>(image.width);
-    const auto bgr_at = [&](int yy, int xx, int cc) -> float {
-        const size_t idx = (static_cast<size_t>(yy) * img_w + static_cast<size_t>(xx)) * 3U + static_cast<size_t>(cc);
-        return static_cast<float>(image.bgr[idx]);
-    };
+// Content rows of the resized image that fall inside model-input rows [row_begin, row_end).
+[[nodiscard]] std::pair<int, int> content_rows(const InputTransform &t, int row_begin, int row_end) noexcept {
+    return {std::max(row_begin, t.content_y) - t.content_y,
+            std::min(row_end, t.content_y + t.content_height) - t.content_y};
+}
 
-    for (int y = 0; y < resolution; ++y) {
-        const float src_y = (static_cast<float>(y) + 0.5f) * scale_y - 0.5f;
-        const int y0 = std::clamp(static_cast<int>(std::floor(src_y)), 0, image.height - 1);
-        const int y1 = std::min(y0 + 1, image.height - 1);
-        const float wy = src_y - static_cast<float>(y0);
-        for (int x = 0; x < resolution; ++x) {
-            const float src_x = (static_cast<float>(x) + 0.5f) * scale_x - 0.5f;
-            const int x0 = std::clamp(static_cast<int>(std::floor(src_x)), 0, image.width - 1);
-            const int x1 = std::min(x0 + 1, image.width - 1);
-            const float wx = src_x - static_cast<float>(x0);
-            const size_t dst = static_cast<size_t>(y) * res + static_cast<size_t>(x);
-
-            float bgr[3]{};
-            for (int c = 0; c < 3; ++c) {
-                const float p00 = bgr_at(y0, x0, c);
-                const float p01 = bgr_at(y0, x1, c);
-                const float p10 = bgr_at(y1, x0, c);
-                const float p11 = bgr_at(y1, x1, c);
-                bgr[c] = (p00 * (1.0f - wx) + p01 * wx) * (1.0f - wy) + (p10 * (1.0f - wx) + p11 * wx) * wy;
+// Fill the padding of model-input rows [row_begin, row_end) and resample the image rows among them.
+void preprocess_input_rows(const Image &image, std::span<float> output, int resolution, const InputTransform &t,
+                           const BilinearResampler &resampler, const NormalizeCoefficients &coeffs,
+                           cpu::SimdLevel level, std::span<float> scratch, int row_begin, int row_end) {
+    const auto res = static_cast<size_t>(resolution);
+    const size_t plane = res * res;
+    const auto left = static_cast<size_t>(t.content_x);
+    const auto right = static_cast<size_t>(t.content_x + t.content_width);
+    for (int y = row_begin; y < row_end; ++y) {
+        const bool content_row = y >= t.content_y && y < t.content_y + t.content_height;
+        for (size_t c = 0; c < 3; ++c) {
+            float *row = output.data() + c * plane + static_cast<size_t>(y) * res;
+            if (content_row) {
+                std::fill(row, row + left, 0.0f);
+                std::fill(row + right, row + res, 0.0f);
+            } else {
+                std::fill(row, row + res, 0.0f);
             }
+        }
+    }
+
+    const auto [first, last] = content_rows(t, row_begin, row_end);
+    if (first < last) {
+        resize_normalize_bgr_to_chw(image, output, OutputCanvas{resolution, resolution, t.content_x, t.content_y},
+                                    resampler, coeffs, scratch, level, first, last);
+    }
+}
 
-            output[dst] = bgr[2] / 255.0f;
-            output[channel_size + dst] = bgr[1] / 255.0f;
-            output[2 * channel_size + dst] = bgr[0] / 255.0f;
+// uint8 HWC counterpart: padding is `pad` (the mean color), content is resized RGB.
+void preprocess_input_rows_u8(const Image &image, std::span<uint8_t> output, int resolution, const InputTransform &t,
+                              const BilinearResampler &resampler, const std::array<uint8_t, 3> &pad,
+                              cpu::SimdLevel level, std::span<float> scratch, int row_begin, int row_end) {
+    const auto res = static_cast<size_t>(resolution);
+    const auto left = static_cast<size_t>(t.content_x);
+    const auto right = static_cast<size_t>(t.content_x + t.content_width);
+    const auto fill_pixels = [&pad](uint8_t *begin, uint8_t *end) {
+        for (uint8_t *px = begin; px < end; px += 3) {
+            std::copy(pad.begin(), pad.end(), px);
         }
+    };
+    for (int y = row_begin; y < row_end; ++y) {
+        uint8_t *row = output.data() + static_cast<size_t>(y) * res * 3;
+        if (y >= t.content_y && y < t.content_y + t.content_height) {
+            fill_pixels(row, row + 3 * left);
+            fill_pixels(row + 3 * right, row + 3 * res);
+        } else {
+            fill_pixels(row, row + 3 * res);
+        }
+    }
+
+    const auto [first, last] = content_rows(t, row_begin, row_end);
+    if (first < last) {
+        resize_bgr_to_rgb_hwc(image, output, OutputCanvas{resolution, resolution, t.content_x, t.content_y},
+                              resampler, scratch, level, first, last);
+    }
+}
+
+// Split model-input rows [0, resolution) into contiguous bands on `pool`. Each band gets its own
+// row scratch from `resampler`, which must already be configured.
+template <typename RowsFn>
+void for_each_row_band(concurrency::ThreadPool &pool, int resolution, BilinearResampler &resampler,
+                       RowsFn &&rows_fn) {
+    // Below this many rows per band, re-resampling the band's first source rows and the fork/join
+    // handshake cost more than the band itself.
+    constexpr size_t kMinRowsPerBand = 16;
+    const auto rows = static_cast<size_t>(resolution);
+    const size_t bands = std::clamp<size_t>(rows / kMinRowsPerBand, 1, pool.size());
+    const size_t band_scratch = 6 * static_cast<size_t>(resampler.dst_width());
+    const auto scratch = resampler.scratch(bands * band_scratch);
+
+    pool.run(bands, [&](size_t band) {
+        const auto [begin, end] = concurrency::split_range(rows, bands, band);
+        rows_fn(scratch.subspan(band * band_scratch, band_scratch), static_cast<int>(begin), static_cast<int>(end));
+    });
+}
+
+[[nodiscard]] std::array<uint8_t, 3> mean_color(std::span<const float, 3> means) noexcept {
+    std::array<uint8_t, 3> pad{};
+    for (size_t c = 0; c < 3; ++c) {
+        pad[c] = clamp_to_byte(means[c] * 255.0f + 0.5f);
     }
+    return pad;
+}
+
+} // anonymous namespace
+
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, const InputTransform &transform,
+                          BilinearResampler &resampler) {
+    validate_input_transform(image, output.size(), resolution, transform);
+    resampler.configure(image.width, image.height, transform.content_width, transform.content_height, 3);
+    preprocess_input_rows(image, output, resolution, transform, resampler, make_normalize_coefficients(means, stds),
+                          cpu::best_simd_level(), resampler.scratch(6 * static_cast<size_t>(transform.content_width)),
+                          0, resolution);
+}
+
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, const InputTransform &transform,
+                          BilinearResampler &resampler, concurrency::ThreadPool &pool) {
+    validate_input_transform(image, output.size(), resolution, transform);
+    resampler.configure(image.width, image.height, transform.content_width, transform.content_height, 3);
+    const auto coeffs = make_normalize_coefficients(means, stds);
+    const auto level = cpu::best_simd_level();
+    for_each_row_band(pool, resolution, resampler, [&](std::span<float> scratch, int begin, int end) {
+        preprocess_input_rows(image, output, resolution, transform, resampler, coeffs, level, scratch, begin, end);
+    });
+}
+
+void preprocess_bgr_image_u8(const Image &image, std::span<uint8_t> output, int resolution,
+                             std::span<const float, 3> means, const InputTransform &transform,
+                             BilinearResampler &resampler) {
+    validate_input_transform(image, output.size(), resolution, transform);
+    resampler.configure(image.width, image.height, transform.content_width, transform.content_height, 3);
+    preprocess_input_rows_u8(image, output, resolution, transform, resampler, mean_color(means),
+                             cpu::best_simd_level(),
+                             resampler.scratch(6 * static_cast<size_t>(transform.content_width)), 0, resolution);
+}
 
-    rfdetr::processing::normalize_image(output.subspan(0, 3 * channel_size), channel_size, means, stds);
+void preprocess_bgr_image_u8(const Image &image, std::span<uint8_t> output, int resolution,
+                             std::span<const float, 3> means, const InputTransform &transform,
+                             BilinearResampler &resampler, concurrency::ThreadPool &pool) {
+    validate_input_transform(image, output.size(), resolution, transform);
+    resampler.configure(image.width, image.height, transform.content_width, transform.content_height, 3);
+    const auto pad = mean_color(means);
+    const auto level = cpu::best_simd_level();
+    for_each_row_band(pool, resolution, resampler, [&](std::span<float> scratch, int begin, int end) {
+        preprocess_input_rows_u8(image, output, resolution, transform, resampler, pad, level, scratch, begin, end);
+    });
 }
 
 Mask resize_threshold_mask(std::span<const float> mask, int mask_width, int mask_height, int out_width, int out_height,
                            float threshold) {
+    const BilinearResampler resampler(mask_width, mask_height, out_width, out_height);
+    return resize_threshold_mask(mask, resampler, threshold);
+}
+
+Mask resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler, float threshold) {
     Mask out;
-    out.width = out_width;
-    out.height = out_height;
-    out.data.resize(static_cast<size_t>(out_width) * static_cast<size_t>(out_height));
-
-    const float scale_x = static_cast<float>(mask_width) / static_cast<float>(out_width);
-    const float scale_y = static_cast<float>(mask_height) / static_cast<float>(out_height);
-    const size_t mw = static_cast<size_t>(mask_width);
-    const auto m = [&](int yy, int xx) -> float {
-        return mask[static_cast<size_t>(yy) * mw + static_cast<size_t>(xx)];
-    };
-    for (int y = 0; y < out_height; ++y) {
-        const float src_y = (static_cast<float>(y) + 0.5f) * scale_y - 0.5f;
-        const int y0 = std::clamp(static_cast<int>(std::floor(src_y)), 0, mask_height - 1);
-        const int y1 = std::min(y0 + 1, mask_height - 1);
-        const float wy = src_y - static_cast<float>(y0);
-        for (int x = 0; x < out_width; ++x) {
-            const float src_x = (static_cast<float>(x) + 0.5f) * scale_x - 0.5f;
-            const int x0 = std::clamp(static_cast<int>(std::floor(src_x)), 0, mask_width - 1);
-            const int x1 = std::min(x0 + 1, mask_width - 1);
-            const float wx = src_x - static_cast<float>(x0);
-            const float p00 = m(y0, x0);
-            const float p01 = m(y0, x1);
-            const float p10 = m(y1, x0);
-            const float p11 = m(y1, x1);
-            const float value = (p00 * (1.0f - wx) + p01 * wx) * (1.0f - wy) + (p10 * (1.0f - wx) + p11 * wx) * wy;
-            out.data[static_cast<size_t>(y) * static_cast<size_t>(out_width) + static_cast<size_t>(x)] =
-                value > threshold ? 255 : 0;
+    // Local scratch, so one const resampler can serve any number of callers.
+    std::vector<float> scratch(2 * static_cast<size_t>(resampler.dst_width()));
+    resize_threshold_mask(mask, resampler, threshold, out, scratch);
+    return out;
+}
+
+void resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler, float threshold, Mask &out,
+                           std::span<float> scratch) {
+    const BoundingBox whole{0.0f, 0.0f, static_cast<float>(resampler.dst_width()),
+                            static_cast<float>(resampler.dst_height())};
+    resize_threshold_mask(mask, resampler, threshold, whole, out, scratch);
+}
+
+void resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler, float threshold,
+                           const BoundingBox &box, Mask &out, std::span<float> scratch) {
+    // Every pixel the box overlaps, clamped to the output
+    const int dst_w = resampler.dst_width();
+    const int dst_h = resampler.dst_height();
+    out.x = std::clamp(static_cast<int>(std::floor(box.x_min)), 0, dst_w);
+    out.y = std::clamp(static_cast<int>(std::floor(box.y_min)), 0, dst_h);
+    out.width = std::clamp(static_cast<int>(std::ceil(box.x_max)), out.x, dst_w) - out.x;
+    out.height = std::clamp(static_cast<int>(std::ceil(box.y_max)), out.y, dst_h) - out.y;
+    const auto out_w = static_cast<size_t>(out.width);
+    out.data.resize(out_w * static_cast<size_t>(out.height));
+    if (scratch.size() < 2 * static_cast<size_t>(dst_w)) {
+        throw std::runtime_error("Mask scratch buffer is too small");
+    }
+
+    const BilinearAxis &x_axis = resampler.x_axis();
+    const auto mask_w = static_cast<size_t>(resampler.src_width());
+    const auto first_col = static_cast<size_t>(out.x);
+    for_each_bilinear_row(
+        resampler.y_axis(), out.y, out.y + out.height, scratch, out_w,
+        [&](int src_row, float *dst) {
+            const float *src = mask.data() + static_cast<size_t>(src_row) * mask_w;
+            for (size_t x = 0; x < out_w; ++x) {
+                const float w = x_axis.w[first_col + x];
+                dst[x] = src[x_axis.i0[first_col + x]] * (1.0f - w) + src[x_axis.i1[first_col + x]] * w;
+            }
+        },
+        [&](int dst_row, const float *top, const float *bottom, float wy) {
+            uint8_t *dst = out.data.data() + static_cast<size_t>(dst_row - out.y) * out_w;
+            for (size_t x = 0; x < out_w; ++x) {
+                dst[x] = top[x] * (1.0f - wy) + bottom[x] * wy > threshold ? 255 : 0;
+            }
+        });
+}
+
+const Mask &LazyMask::get() {
+    if (!materialized_) {
+        if (!resampler_) {
+            throw std::runtime_error("LazyMask has no mask logits");
         }
+        std::vector<float> scratch(2 * static_cast<size_t>(resampler_->dst_width()));
+        resize_threshold_mask(logits_, *resampler_, threshold_, box_, mask_, scratch);
+        materialized_ = true;
+    }
+    return mask_;
+}
+
+void LazyMask::retain() {
+    if (!materialized_ && owned_logits_.empty()) {
+        owned_logits_.assign(logits_.begin(), logits_.end());
+        logits_ = owned_logits_;
     }
-    return out;
 }
 
 Color get_color_for_class(int class_id) noexcept {
@@ -318,13 +547,15 @@ void draw_segmentation_masks(Image &image, std::span<const BoundingBox> boxes, s
                              std::span<const Mask> masks) {
     for (size_t i = 0; i < boxes.size(); ++i) {
         const Color color = get_color_for_class(class_ids[i]);
-        if (masks[i].width == image.width && masks[i].height == image.height) {
-            const size_t w = static_cast<size_t>(image.width);
-            for (int y = 0; y < image.height; ++y) {
-                for (int x = 0; x < image.width; ++x) {
-                    if (masks[i].data[static_cast<size_t>(y) * w + static_cast<size_t>(x)] != 0) {
-                        blend_pixel(image, x, y, color, 0.5f);
-                    }
+        const Mask &mask = masks[i];
+        const int x0 = std::max(mask.x, 0);
+        const int x1 = std::min(mask.x + mask.width, image.width);
+        const int y1 = std::min(mask.y + mask.height, image.height);
+        for (int y = std::max(mask.y, 0); y < y1; ++y) {
+            const uint8_t *row = mask.data.data() + static_cast<size_t>(y - mask.y) * static_cast<size_t>(mask.width);
+            for (int x = x0; x < x1; ++x) {
+                if (row[x - mask.x] != 0) {
+                    blend_pixel(image, x, y, color, 0.5f);
                 }
             }
         }
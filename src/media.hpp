@@ -1,11 +1,14 @@
 #pragma once
 
+#include "bilinear_resampler.hpp"
 #include "rfdetr_types.hpp"
+#include "thread_pool.hpp"
 
 #include <array>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <span>
 #include <string_view>
 #include <utility>
@@ -38,22 +41,147 @@ struct Image {
     }
 };
 
+/// Binary mask (0 / 255) of the `width x height` region at (x, y) of an image; pixels outside the
+/// region are background. Segmentation results are cropped to the instance's box, so `data` holds
+/// `width * height` bytes rather than a whole frame.
 struct Mask {
+    int x{0};
+    int y{0};
     int width{0};
     int height{0};
     std::vector<uint8_t> data;
+
+    /// Value at image pixel (px, py); 0 outside the region
+    [[nodiscard]] uint8_t at(int px, int py) const noexcept {
+        if (px < x || py < y || px >= x + width || py >= y + height) {
+            return 0;
+        }
+        return data[static_cast<size_t>(py - y) * static_cast<size_t>(width) + static_cast<size_t>(px - x)];
+    }
+};
+
+/// Segmentation mask kept as the instance's low-resolution logits until someone asks for pixels:
+/// get() upsamples and thresholds it (cropped to `box`, like resize_threshold_mask) on first use
+/// and caches the result, so instances nobody looks at cost no upsampling.
+///
+/// The logits are a view of the inference output and stay valid only until the next inference
+/// run; call retain() first to keep an unmaterialized handle longer. The resampler (mask ->
+/// image tables) is shared with the other instances of the frame. Not safe to get() one handle
+/// from two threads at once.
+class LazyMask {
+  public:
+    LazyMask() = default;
+    LazyMask(std::span<const float> logits, std::shared_ptr<const BilinearResampler> resampler,
+             const BoundingBox &box, float threshold)
+        : logits_(logits), resampler_(std::move(resampler)), box_(box), threshold_(threshold) {}
+
+    LazyMask(const LazyMask &) = delete;
+    LazyMask &operator=(const LazyMask &) = delete;
+    LazyMask(LazyMask &&) noexcept = default;
+    LazyMask &operator=(LazyMask &&) noexcept = default;
+    ~LazyMask() = default;
+
+    /// The box-cropped binary mask, materialized on the first call
+    [[nodiscard]] const Mask &get();
+
+    [[nodiscard]] bool materialized() const noexcept { return materialized_; }
+
+    /// Copy the logits out of the inference output so get() keeps working after the next run
+    void retain();
+
+  private:
+    std::span<const float> logits_;
+    std::vector<float> owned_logits_; // backs logits_ after retain(); moves keep its buffer
+    std::shared_ptr<const BilinearResampler> resampler_;
+    BoundingBox box_{};
+    float threshold_{0.0f};
+    bool materialized_{false};
+    Mask mask_;
+};
+
+/// Uncompressed COCO run-length encoding of a mask in a `width x height` image: alternating
+/// background / foreground run lengths over the pixels in column-major order, starting with
+/// background (so `counts[0]` may be 0), i.e. pycocotools' `{"size": [height, width], "counts": counts}`.
+struct RleMask {
+    int width{0};
+    int height{0};
+    std::vector<uint32_t> counts;
 };
 
 [[nodiscard]] Image load_image(const std::filesystem::path &path);
 [[nodiscard]] bool save_image(const Image &image, const std::filesystem::path &path);
 [[nodiscard]] size_t count_nonzero(const Mask &mask) noexcept;
+[[nodiscard]] size_t count_nonzero(const RleMask &mask) noexcept;
+
+/// COCO RLE of `mask` placed in a `width x height` image (the mask region is clipped to it).
+[[nodiscard]] RleMask encode_rle(const Mask &mask, int width, int height);
+
+/// As above, reusing `out`'s buffer.
+void encode_rle(const Mask &mask, int width, int height, RleMask &out);
 
+/// Resize `image` to `resolution x resolution` (bilinear, antialias-free), swap BGR->RGB and normalize
+/// with `means`/`stds` into the CHW float tensor `output`, in a single pass. Uses the widest SIMD
+/// kernel the CPU supports (see cpu::best_simd_level()).
 void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
                           std::span<const float, 3> stds);
 
+/// As above, reusing `resampler`'s tables across calls. It is (re)configured for the image size on
+/// each call, which is free once the stream's frame size is known.
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, BilinearResampler &resampler);
+
+/// As above, splitting output rows into contiguous bands processed in parallel on `pool`. The
+/// result is bit-identical to the single-threaded call for any pool size, and steady-state calls
+/// do not allocate (per-band row scratch lives in `resampler`).
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, BilinearResampler &resampler,
+                          concurrency::ThreadPool &pool);
+
+/// Fit `image` into the `resolution x resolution` model input as described by `transform` (see
+/// processing::make_input_transform): the image is resized into the transform's content box and
+/// the border is filled with 0, i.e. the dataset mean color after normalization.
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, const InputTransform &transform,
+                          BilinearResampler &resampler);
+
+/// As above, splitting model-input rows across `pool` like the stretch overload.
+void preprocess_bgr_image(const Image &image, std::span<float> output, int resolution, std::span<const float, 3> means,
+                          std::span<const float, 3> stds, const InputTransform &transform,
+                          BilinearResampler &resampler, concurrency::ThreadPool &pool);
+
+/// uint8 counterpart for models exported with normalization in the graph: resize into the
+/// transform's content box and swap BGR->RGB into the interleaved `resolution x resolution x 3`
+/// (NHWC) tensor `output`. The border is the mean color (`means * 255`), which the model
+/// normalizes to 0 just like the float path's padding.
+void preprocess_bgr_image_u8(const Image &image, std::span<uint8_t> output, int resolution,
+                             std::span<const float, 3> means, const InputTransform &transform,
+                             BilinearResampler &resampler);
+
+/// As above, splitting model-input rows across `pool`.
+void preprocess_bgr_image_u8(const Image &image, std::span<uint8_t> output, int resolution,
+                             std::span<const float, 3> means, const InputTransform &transform,
+                             BilinearResampler &resampler, concurrency::ThreadPool &pool);
+
+/// Bilinearly upsample a `mask_width x mask_height` logit map to `out_width x out_height` and
+/// binarize it (`> threshold` -> 255).
 [[nodiscard]] Mask resize_threshold_mask(std::span<const float> mask, int mask_width, int mask_height, int out_width,
                                          int out_height, float threshold);
 
+/// As above, using precomputed single-channel tables (mask size -> output size).
+[[nodiscard]] Mask resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler,
+                                         float threshold);
+
+/// As above, writing into `out` (reusing its buffer) with caller-provided row scratch of at least
+/// `2 * resampler.dst_width()` floats, so steady-state calls do not allocate.
+void resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler, float threshold, Mask &out,
+                           std::span<float> scratch);
+
+/// As above, computing only the output pixels `box` touches (clamped to the output): `out` becomes
+/// the box-cropped mask of that region, and the upsampling cost scales with the box, not the frame.
+/// `scratch` needs `2 * resampler.dst_width()` floats.
+void resize_threshold_mask(std::span<const float> mask, const BilinearResampler &resampler, float threshold,
+                           const BoundingBox &box, Mask &out, std::span<float> scratch);
+
 [[nodiscard]] Color get_color_for_class(int class_id) noexcept;
 void draw_detections(Image &image, std::span<const BoundingBox> boxes, std::span<const int> class_ids);
 void draw_segmentation_masks(Image &image, std::span<const BoundingBox> boxes, std::span<const int> class_ids,
@@ -0,0 +1,262 @@
+#include "pipeline_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace rfdetr::video {
+
+namespace {
+
+constexpr double kNsPerMs = 1e6;
+constexpr double kMsPerSecond = 1e3;
+
+std::string format_double(double value) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << value;
+    return out.str();
+}
+
+void write_summary_json(std::ostream &out, const LatencyHistogram::Summary &summary) {
+    out << "{\"count\": " << summary.count << ", \"total\": " << format_double(summary.total_ms)
+        << ", \"mean\": " << format_double(summary.mean_ms) << ", \"p50\": " << format_double(summary.p50_ms)
+        << ", \"p90\": " << format_double(summary.p90_ms) << ", \"p99\": " << format_double(summary.p99_ms)
+        << ", \"max\": " << format_double(summary.max_ms) << "}";
+}
+
+void write_summary_prometheus(std::ostream &out, std::string_view metric, std::string_view labels,
+                              const LatencyHistogram &histogram) {
+    const auto summary = histogram.summary();
+    const std::string separator = labels.empty() ? "" : ",";
+    for (const auto &[quantile, value_ms] :
+         {std::pair{"0.5", summary.p50_ms}, std::pair{"0.9", summary.p90_ms}, std::pair{"0.99", summary.p99_ms}}) {
+        out << metric << "{" << labels << separator << "quantile=\"" << quantile << "\"} " << value_ms / kMsPerSecond
+            << "\n";
+    }
+    const std::string label_set = labels.empty() ? "" : "{" + std::string(labels) + "}";
+    out << metric << "_sum" << label_set << " " << summary.total_ms / kMsPerSecond << "\n";
+    out << metric << "_count" << label_set << " " << summary.count << "\n";
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+// ---------------------------------------------------------------------------
+
+size_t LatencyHistogram::bucket_of(uint64_t ns) noexcept {
+    if (ns < kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    // ns in [2^e, 2^(e+1)): octave e - 2, sub-bucket from the 3 bits below the leading one
+    const auto e = static_cast<size_t>(std::bit_width(ns)) - 1;
+    return (e - 2) * kSubBuckets + static_cast<size_t>(ns >> (e - 3)) - kSubBuckets;
+}
+
+uint64_t LatencyHistogram::bucket_lower(size_t bucket) noexcept {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const size_t e = bucket / kSubBuckets + 2;
+    return (kSubBuckets + bucket % kSubBuckets) << (e - 3);
+}
+
+void LatencyHistogram::record(StatsClock::duration elapsed) noexcept {
+    const auto ns = static_cast<uint64_t>(
+        std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0));
+    buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile_ns(double q) const noexcept {
+    const uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total))));
+    const uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        seen += buckets_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            const uint64_t lower = bucket_lower(bucket);
+            const uint64_t width = bucket + 1 < kBucketCount ? bucket_lower(bucket + 1) - lower : 0;
+            return std::min(lower + width / 2, max);
+        }
+    }
+    return max;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const noexcept {
+    Summary summary;
+    summary.count = count();
+    if (summary.count == 0) {
+        return summary;
+    }
+    const auto to_ms = [](uint64_t ns) { return static_cast<double>(ns) / kNsPerMs; };
+    summary.total_ms = to_ms(sum_ns_.load(std::memory_order_relaxed));
+    summary.mean_ms = summary.total_ms / static_cast<double>(summary.count);
+    summary.p50_ms = to_ms(percentile_ns(0.50));
+    summary.p90_ms = to_ms(percentile_ns(0.90));
+    summary.p99_ms = to_ms(percentile_ns(0.99));
+    summary.max_ms = to_ms(max_ns_.load(std::memory_order_relaxed));
+    return summary;
+}
+
+// ---------------------------------------------------------------------------
+// PipelineStats
+// ---------------------------------------------------------------------------
+
+std::string_view stage_name(PipelineStage stage) noexcept {
+    switch (stage) {
+    case PipelineStage::DECODE:
+        return "decode";
+    case PipelineStage::PREPROCESS:
+        return "preprocess";
+    case PipelineStage::INFER:
+        return "infer";
+    case PipelineStage::POSTPROCESS:
+        return "postprocess";
+    case PipelineStage::DRAW:
+        return "draw";
+    case PipelineStage::WRITE:
+        return "write";
+    }
+    return "unknown";
+}
+
+PipelineStats::PipelineStats(const std::array<size_t, kPipelineStageCount> &workers, size_t queue_capacity)
+    : workers_(workers), queue_capacity_(queue_capacity) {}
+
+void PipelineStats::start() noexcept {
+    start_ticks_.store(StatsClock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    stop_ticks_.store(0, std::memory_order_relaxed);
+}
+
+void PipelineStats::stop() noexcept {
+    stop_ticks_.store(StatsClock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+double PipelineStats::wall_seconds() const noexcept {
+    const StatsClock::rep start = start_ticks_.load(std::memory_order_relaxed);
+    StatsClock::rep stop = stop_ticks_.load(std::memory_order_relaxed);
+    if (stop == 0) {
+        stop = StatsClock::now().time_since_epoch().count();
+    }
+    return std::chrono::duration<double>(StatsClock::duration(stop - start)).count();
+}
+
+void PipelineStats::sample_queues(const std::array<size_t, kQueueCount> &depths) {
+    sample_times_s_.push_back(wall_seconds());
+    for (size_t q = 0; q < kQueueCount; ++q) {
+        queue_depths_[q].push_back(depths[q]);
+    }
+}
+
+void PipelineStats::write_json(std::ostream &out) const {
+    const double wall = wall_seconds();
+    const uint64_t frames = stage(PipelineStage::WRITE).frames.load(std::memory_order_relaxed);
+
+    out << "{\n";
+    out << "  \"wall_time_s\": " << format_double(wall) << ",\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"fps\": " << format_double(wall > 0.0 ? static_cast<double>(frames) / wall : 0.0) << ",\n";
+    out << "  \"end_to_end_ms\": ";
+    write_summary_json(out, end_to_end_.summary());
+    out << ",\n";
+
+    out << "  \"stages\": {\n";
+    for (size_t s = 0; s < kPipelineStageCount; ++s) {
+        const StageStats &stats = stages_[s];
+        const auto service = stats.service.summary();
+        const double busy_s = service.total_ms / kMsPerSecond;
+        const double capacity_s = wall * static_cast<double>(workers_[s]);
+        out << "    \"" << stage_name(static_cast<PipelineStage>(s)) << "\": {\"workers\": " << workers_[s]
+            << ", \"frames\": " << stats.frames.load(std::memory_order_relaxed)
+            << ", \"utilization\": " << format_double(capacity_s > 0.0 ? busy_s / capacity_s : 0.0) << ",\n";
+        out << "      \"service_ms\": ";
+        write_summary_json(out, service);
+        out << ",\n      \"pop_wait_ms\": ";
+        write_summary_json(out, stats.pop_wait.summary());
+        out << ",\n      \"push_wait_ms\": ";
+        write_summary_json(out, stats.push_wait.summary());
+        out << "}" << (s + 1 < kPipelineStageCount ? "," : "") << "\n";
+    }
+    out << "  },\n";
+
+    out << "  \"queues\": {\n";
+    out << "    \"capacity\": " << queue_capacity_ << ",\n";
+    out << "    \"sample_times_s\": [";
+    for (size_t i = 0; i < sample_times_s_.size(); ++i) {
+        out << (i > 0 ? ", " : "") << format_double(sample_times_s_[i]);
+    }
+    out << "],\n";
+    for (size_t q = 0; q < kQueueCount; ++q) {
+        const auto &depths = queue_depths_[q];
+        size_t sum = 0;
+        size_t max = 0;
+        for (const size_t depth : depths) {
+            sum += depth;
+            max = std::max(max, depth);
+        }
+        const double mean = depths.empty() ? 0.0 : static_cast<double>(sum) / static_cast<double>(depths.size());
+        out << "    \"" << kQueueNames[q] << "\": {\"mean_depth\": " << format_double(mean)
+            << ", \"max_depth\": " << max << ", \"depth\": [";
+        for (size_t i = 0; i < depths.size(); ++i) {
+            out << (i > 0 ? ", " : "") << depths[i];
+        }
+        out << "]}" << (q + 1 < kQueueCount ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+void PipelineStats::write_prometheus(std::ostream &out) const {
+    out << "# HELP rfdetr_pipeline_frames_total Frames written by the video pipeline.\n";
+    out << "# TYPE rfdetr_pipeline_frames_total counter\n";
+    out << "rfdetr_pipeline_frames_total " << stage(PipelineStage::WRITE).frames.load(std::memory_order_relaxed)
+        << "\n";
+    out << "# HELP rfdetr_pipeline_wall_seconds Time since the pipeline started.\n";
+    out << "# TYPE rfdetr_pipeline_wall_seconds gauge\n";
+    out << "rfdetr_pipeline_wall_seconds " << wall_seconds() << "\n";
+
+    out << "# HELP rfdetr_pipeline_end_to_end_seconds Decode-to-write latency per frame.\n";
+    out << "# TYPE rfdetr_pipeline_end_to_end_seconds summary\n";
+    write_summary_prometheus(out, "rfdetr_pipeline_end_to_end_seconds", "", end_to_end_);
+
+    const std::array<std::pair<std::string_view, LatencyHistogram StageStats::*>, 3> histograms = {
+        std::pair{std::string_view("service"), &StageStats::service},
+        std::pair{std::string_view("pop_wait"), &StageStats::pop_wait},
+        std::pair{std::string_view("push_wait"), &StageStats::push_wait}};
+    for (const auto &[name, histogram] : histograms) {
+        const std::string metric = "rfdetr_pipeline_stage_" + std::string(name) + "_seconds";
+        out << "# HELP " << metric << " Per-stage " << name << " time.\n";
+        out << "# TYPE " << metric << " summary\n";
+        for (size_t s = 0; s < kPipelineStageCount; ++s) {
+            const std::string labels = "stage=\"" + std::string(stage_name(static_cast<PipelineStage>(s))) + "\"";
+            write_summary_prometheus(out, metric, labels, stages_[s].*histogram);
+        }
+    }
+
+    out << "# HELP rfdetr_pipeline_queue_depth Slot indices waiting in an inter-stage queue (last sample).\n";
+    out << "# TYPE rfdetr_pipeline_queue_depth gauge\n";
+    for (size_t q = 0; q < kQueueCount; ++q) {
+        const auto &depths = queue_depths_[q];
+        out << "rfdetr_pipeline_queue_depth{queue=\"" << kQueueNames[q] << "\"} "
+            << (depths.empty() ? 0 : depths.back()) << "\n";
+    }
+    out << "# HELP rfdetr_pipeline_queue_capacity Capacity of every inter-stage queue.\n";
+    out << "# TYPE rfdetr_pipeline_queue_capacity gauge\n";
+    out << "rfdetr_pipeline_queue_capacity " << queue_capacity_ << "\n";
+}
+
+} // namespace rfdetr::video
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace rfdetr::video {
+
+using StatsClock = std::chrono::steady_clock;
+
+/// Concurrent histogram of durations with log-linear buckets (8 per power of two, so a reported
+/// percentile is within 12.5% of the true value). record() is a handful of relaxed atomic adds, so
+/// every worker of a stage can share one without locking.
+class LatencyHistogram {
+  public:
+    struct Summary {
+        uint64_t count{0};
+        double total_ms{0.0};
+        double mean_ms{0.0};
+        double p50_ms{0.0};
+        double p90_ms{0.0};
+        double p99_ms{0.0};
+        double max_ms{0.0};
+    };
+
+    void record(StatsClock::duration elapsed) noexcept;
+
+    /// Record the time since `start` and return the current time, so consecutive phases can be
+    /// timed by chaining: `t = pop_wait.record_since(t); ... t = service.record_since(t);`
+    StatsClock::time_point record_since(StatsClock::time_point start) noexcept {
+        const auto now = StatsClock::now();
+        record(now - start);
+        return now;
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+    /// Value (nanoseconds) at quantile `q` in [0, 1]: the middle of the bucket holding that rank,
+    /// clamped to the largest recorded value. 0 when empty.
+    [[nodiscard]] uint64_t percentile_ns(double q) const noexcept;
+
+    [[nodiscard]] Summary summary() const noexcept;
+
+  private:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kBucketCount = 62 * kSubBuckets;
+
+    static size_t bucket_of(uint64_t ns) noexcept;
+    static uint64_t bucket_lower(size_t bucket) noexcept;
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+enum class PipelineStage : uint8_t { DECODE, PREPROCESS, INFER, POSTPROCESS, DRAW, WRITE };
+inline constexpr size_t kPipelineStageCount = 6;
+
+/// Timings of one pipeline stage, shared by its workers. A stage loop is: wait for a slot index
+/// (pop_wait), work on it (service), hand it on (push_wait); inference records one service time per
+/// (micro-)batch, so `frames` can exceed service.count().
+struct StageStats {
+    LatencyHistogram service;
+    LatencyHistogram pop_wait;
+    LatencyHistogram push_wait;
+    std::atomic<uint64_t> frames{0};
+};
+
+/// Everything VideoPipeline measures while it runs: per-stage service and blocking times,
+/// decode-to-write latency per frame, and inter-stage queue depths sampled at a fixed interval.
+/// Exported as one JSON document (after the run) or as Prometheus text exposition (any time).
+class PipelineStats {
+  public:
+    static constexpr size_t kQueueCount = 6;
+    /// Queue order for sample_queues(): the five inter-stage queues in pipeline order, then the
+    /// free-slot queue (how many ring slots are idle)
+    static constexpr std::array<std::string_view, kQueueCount> kQueueNames = {
+        "decode_to_preprocess", "preprocess_to_infer", "infer_to_postprocess",
+        "postprocess_to_draw",  "draw_to_write",       "free_slots"};
+
+    PipelineStats(const std::array<size_t, kPipelineStageCount> &workers, size_t queue_capacity);
+
+    PipelineStats(const PipelineStats &) = delete;
+    PipelineStats &operator=(const PipelineStats &) = delete;
+
+    StageStats &stage(PipelineStage stage) noexcept { return stages_[static_cast<size_t>(stage)]; }
+    [[nodiscard]] const StageStats &stage(PipelineStage stage) const noexcept {
+        return stages_[static_cast<size_t>(stage)];
+    }
+
+    /// Decode start to written frame
+    LatencyHistogram &end_to_end() noexcept { return end_to_end_; }
+    [[nodiscard]] const LatencyHistogram &end_to_end() const noexcept { return end_to_end_; }
+
+    /// Mark the start / end of the run; wall time (and so utilization and fps) is measured between
+    /// them, or up to now while running.
+    void start() noexcept;
+    void stop() noexcept;
+
+    /// Append one depth sample per queue (kQueueNames order). Called by a single sampling thread;
+    /// the samples must not be read (write_*) concurrently from another thread.
+    void sample_queues(const std::array<size_t, kQueueCount> &depths);
+
+    /// {"wall_time_s", "frames", "fps", "end_to_end_ms", "stages": {...}, "queues": {...}}; stage
+    /// times are in milliseconds, `utilization` is service time / (wall time * workers).
+    void write_json(std::ostream &out) const;
+
+    /// Prometheus text exposition format (summaries in seconds, queue depth gauges), suitable for
+    /// the node_exporter textfile collector.
+    void write_prometheus(std::ostream &out) const;
+
+  private:
+    [[nodiscard]] double wall_seconds() const noexcept;
+
+    std::array<StageStats, kPipelineStageCount> stages_;
+    std::array<size_t, kPipelineStageCount> workers_;
+    LatencyHistogram end_to_end_;
+
+    size_t queue_capacity_;
+    std::vector<double> sample_times_s_;
+    std::array<std::vector<size_t>, kQueueCount> queue_depths_;
+
+    std::atomic<StatsClock::rep> start_ticks_{0};
+    std::atomic<StatsClock::rep> stop_ticks_{0}; // 0 while running
+};
+
+[[nodiscard]] std::string_view stage_name(PipelineStage stage) noexcept;
+
+} // namespace rfdetr::video
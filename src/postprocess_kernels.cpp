@@ -0,0 +1,261 @@
+#include "postprocess_kernels.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RFDETR_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define RFDETR_HAVE_NEON_KERNELS 1
+#include <arm_neon.h>
+#endif
+
+namespace rfdetr::processing {
+
+namespace {
+
+using ArgmaxRowsFn = void (*)(const float *logits, size_t rows, size_t cols, float *max_values,
+                              int32_t *max_indices);
+
+/// Continue a row's running argmax over columns [begin, cols). Columns are visited in order and
+/// only a strictly larger value replaces the best, so the first maximum wins.
+inline void argmax_tail(const float *row, size_t begin, size_t cols, float &best, int32_t &best_index) {
+    for (size_t c = begin; c < cols; ++c) {
+        if (row[c] > best) {
+            best = row[c];
+            best_index = static_cast<int32_t>(c);
+        }
+    }
+}
+
+/// Fold per-lane maxima (each lane holding the first maximum of its column subset) into the row's
+/// first maximum: the largest value, and the smallest column among lanes that hold it.
+inline void reduce_lanes(const float *lane_max, const int32_t *lane_index, size_t lanes, float &best,
+                         int32_t &best_index) {
+    best = lane_max[0];
+    best_index = lane_index[0];
+    for (size_t l = 1; l < lanes; ++l) {
+        if (lane_max[l] > best || (lane_max[l] == best && lane_index[l] < best_index)) {
+            best = lane_max[l];
+            best_index = lane_index[l];
+        }
+    }
+}
+
+void argmax_rows_scalar(const float *logits, size_t rows, size_t cols, float *max_values, int32_t *max_indices) {
+    for (size_t r = 0; r < rows; ++r) {
+        const float *row = logits + r * cols;
+        float best = row[0];
+        int32_t best_index = 0;
+        argmax_tail(row, 1, cols, best, best_index);
+        max_values[r] = best;
+        max_indices[r] = best_index;
+    }
+}
+
+#ifdef RFDETR_HAVE_X86_KERNELS
+
+__attribute__((target("avx2"))) void argmax_rows_avx2(const float *logits, size_t rows, size_t cols,
+                                                      float *max_values, int32_t *max_indices) {
+    const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    alignas(32) float lane_max[8];
+    alignas(32) int32_t lane_index[8];
+    for (size_t r = 0; r < rows; ++r) {
+        const float *row = logits + r * cols;
+        float best = row[0];
+        int32_t best_index = 0;
+        size_t c = 1;
+        if (cols >= 8) {
+            __m256 vmax = _mm256_loadu_ps(row);
+            __m256i vindex = lane_offsets;
+            __m256i current = lane_offsets;
+            for (c = 8; c + 8 <= cols; c += 8) {
+                current = _mm256_add_epi32(current, step);
+                const __m256 v = _mm256_loadu_ps(row + c);
+                const __m256 greater = _mm256_cmp_ps(v, vmax, _CMP_GT_OQ);
+                vmax = _mm256_blendv_ps(vmax, v, greater);
+                vindex = _mm256_blendv_epi8(vindex, current, _mm256_castps_si256(greater));
+            }
+            _mm256_store_ps(lane_max, vmax);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lane_index), vindex);
+            reduce_lanes(lane_max, lane_index, 8, best, best_index);
+        }
+        argmax_tail(row, c, cols, best, best_index);
+        max_values[r] = best;
+        max_indices[r] = best_index;
+    }
+}
+
+__attribute__((target("avx512f"))) void argmax_rows_avx512(const float *logits, size_t rows, size_t cols,
+                                                           float *max_values, int32_t *max_indices) {
+    const __m512i lane_offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i step = _mm512_set1_epi32(16);
+    alignas(64) float lane_max[16];
+    alignas(64) int32_t lane_index[16];
+    for (size_t r = 0; r < rows; ++r) {
+        const float *row = logits + r * cols;
+        float best = row[0];
+        int32_t best_index = 0;
+        size_t c = 1;
+        if (cols >= 16) {
+            __m512 vmax = _mm512_loadu_ps(row);
+            __m512i vindex = lane_offsets;
+            __m512i current = lane_offsets;
+            for (c = 16; c < cols; c += 16) {
+                // The last block loads only the remaining columns; masked-off lanes never compare greater
+                const __mmask16 valid =
+                    cols - c >= 16 ? __mmask16{0xffff} : static_cast<__mmask16>((1U << (cols - c)) - 1U);
+                current = _mm512_add_epi32(current, step);
+                const __m512 v = _mm512_maskz_loadu_ps(valid, row + c);
+                const __mmask16 greater = _mm512_mask_cmp_ps_mask(valid, v, vmax, _CMP_GT_OQ);
+                vmax = _mm512_mask_blend_ps(greater, vmax, v);
+                vindex = _mm512_mask_blend_epi32(greater, vindex, current);
+            }
+            c = cols;
+            _mm512_store_ps(lane_max, vmax);
+            _mm512_store_si512(lane_index, vindex);
+            reduce_lanes(lane_max, lane_index, 16, best, best_index);
+        }
+        argmax_tail(row, c, cols, best, best_index);
+        max_values[r] = best;
+        max_indices[r] = best_index;
+    }
+}
+
+#endif // RFDETR_HAVE_X86_KERNELS
+
+#ifdef RFDETR_HAVE_NEON_KERNELS
+
+void argmax_rows_neon(const float *logits, size_t rows, size_t cols, float *max_values, int32_t *max_indices) {
+    const int32_t offsets[4] = {0, 1, 2, 3};
+    const int32x4_t lane_offsets = vld1q_s32(offsets);
+    const int32x4_t step = vdupq_n_s32(4);
+    float lane_max[4];
+    int32_t lane_index[4];
+    for (size_t r = 0; r < rows; ++r) {
+        const float *row = logits + r * cols;
+        float best = row[0];
+        int32_t best_index = 0;
+        size_t c = 1;
+        if (cols >= 4) {
+            float32x4_t vmax = vld1q_f32(row);
+            int32x4_t vindex = lane_offsets;
+            int32x4_t current = lane_offsets;
+            for (c = 4; c + 4 <= cols; c += 4) {
+                current = vaddq_s32(current, step);
+                const float32x4_t v = vld1q_f32(row + c);
+                const uint32x4_t greater = vcgtq_f32(v, vmax);
+                vmax = vbslq_f32(greater, v, vmax);
+                vindex = vbslq_s32(greater, current, vindex);
+            }
+            vst1q_f32(lane_max, vmax);
+            vst1q_s32(lane_index, vindex);
+            reduce_lanes(lane_max, lane_index, 4, best, best_index);
+        }
+        argmax_tail(row, c, cols, best, best_index);
+        max_values[r] = best;
+        max_indices[r] = best_index;
+    }
+}
+
+#endif // RFDETR_HAVE_NEON_KERNELS
+
+ArgmaxRowsFn select_argmax_rows(cpu::SimdLevel level) {
+    if (!cpu::simd_level_supported(level)) {
+        throw std::runtime_error("SIMD level not supported on this CPU: " + std::string(cpu::to_string(level)));
+    }
+    switch (level) {
+#ifdef RFDETR_HAVE_X86_KERNELS
+    case cpu::SimdLevel::AVX2:
+        return argmax_rows_avx2;
+    case cpu::SimdLevel::AVX512:
+        return argmax_rows_avx512;
+#endif
+#ifdef RFDETR_HAVE_NEON_KERNELS
+    case cpu::SimdLevel::NEON:
+        return argmax_rows_neon;
+#endif
+    default:
+        return argmax_rows_scalar;
+    }
+}
+
+} // anonymous namespace
+
+void argmax_rows(std::span<const float> logits, size_t cols, std::span<float> max_values,
+                 std::span<int32_t> max_indices, cpu::SimdLevel level) {
+    const size_t rows = max_values.size();
+    if (max_indices.size() != rows || logits.size() != rows * cols) {
+        throw std::runtime_error("argmax_rows: " + std::to_string(logits.size()) + " logits do not form " +
+                                 std::to_string(rows) + " rows of " + std::to_string(cols) + " (" +
+                                 std::to_string(max_indices.size()) + " index slots)");
+    }
+    const ArgmaxRowsFn kernel = select_argmax_rows(level);
+    if (cols == 0) {
+        std::fill(max_values.begin(), max_values.end(), -std::numeric_limits<float>::infinity());
+        std::fill(max_indices.begin(), max_indices.end(), -1);
+        return;
+    }
+    kernel(logits.data(), rows, cols, max_values.data(), max_indices.data());
+}
+
+void argmax_rows(std::span<const float> logits, size_t cols, std::span<float> max_values,
+                 std::span<int32_t> max_indices) {
+    argmax_rows(logits, cols, max_values, max_indices, cpu::best_simd_level());
+}
+
+namespace {
+
+/// Heap order for TopKSelector: `a` ranks before `b`. With this as the "less" comparator the
+/// std heap keeps the worst selected entry on top.
+bool better(const TopKSelector::Entry &a, const TopKSelector::Entry &b) noexcept {
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+}
+
+} // anonymous namespace
+
+void TopKSelector::reset(size_t k, float floor) {
+    k_ = k;
+    floor_ = floor;
+    cutoff_ = floor;
+    heap_.clear();
+    heap_.reserve(k);
+}
+
+void TopKSelector::push(std::span<const float> values, uint32_t first_index) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        push(values[i], first_index + static_cast<uint32_t>(i));
+    }
+}
+
+void TopKSelector::insert(float value, uint32_t index) {
+    // push() lets values equal to the cutoff through so an earlier index can displace a tie
+    if (!(value > floor_) || k_ == 0) {
+        return;
+    }
+    const Entry entry{value, index};
+    if (heap_.size() < k_) {
+        heap_.push_back(entry);
+        std::push_heap(heap_.begin(), heap_.end(), better);
+    } else if (better(entry, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), better);
+        heap_.back() = entry;
+        std::push_heap(heap_.begin(), heap_.end(), better);
+    } else {
+        return;
+    }
+    if (heap_.size() == k_) {
+        cutoff_ = heap_.front().value;
+    }
+}
+
+std::span<const TopKSelector::Entry> TopKSelector::sorted() {
+    std::sort_heap(heap_.begin(), heap_.end(), better);
+    return heap_;
+}
+
+} // namespace rfdetr::processing
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cpu_features.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rfdetr::processing {
+
+/// Row-wise argmax of a `rows x cols` row-major matrix (the class logits of each query): for every
+/// row, the largest value and the column holding it (the first such column on ties).
+///
+/// The sigmoid is monotonic, so the argmax of the raw logits is the argmax of the class scores and
+/// `max_value > logit(threshold)` is `sigmoid(max_value) > threshold`; callers only need to apply
+/// the sigmoid to the rows that pass.
+///
+/// `logits` must hold `max_values.size() * cols` values and `max_indices` must be as long as
+/// `max_values`. Rows of a matrix with no columns report -inf / -1. `level` must satisfy
+/// `cpu::simd_level_supported(level)`.
+void argmax_rows(std::span<const float> logits, size_t cols, std::span<float> max_values,
+                 std::span<int32_t> max_indices, cpu::SimdLevel level);
+
+/// As above, using the widest kernel the CPU supports (see cpu::best_simd_level()).
+void argmax_rows(std::span<const float> logits, size_t cols, std::span<float> max_values,
+                 std::span<int32_t> max_indices);
+
+/// Streaming selection of the k best (value, index) pairs whose value is strictly above a floor,
+/// e.g. the top `max_detections` (query, class) logits above `logit(threshold)`.
+///
+/// One pass over the candidates with a fixed-capacity min-heap: once k entries are held, anything
+/// not better than the worst of them is rejected with a single compare. "Better" is the larger
+/// value, then the smaller index, so the result does not depend on the order candidates arrive
+/// in. Storage is reused across reset() calls with the same or smaller k.
+class TopKSelector {
+  public:
+    struct Entry {
+        float value;
+        uint32_t index;
+    };
+
+    /// Start a new selection keeping at most `k` entries, all strictly greater than `floor`
+    void reset(size_t k, float floor);
+
+    /// Offer one candidate
+    void push(float value, uint32_t index) {
+        if (value >= cutoff_) { // also rejects NaN
+            insert(value, index);
+        }
+    }
+
+    /// Offer `values[i]` with index `first_index + i`
+    void push(std::span<const float> values, uint32_t first_index = 0);
+
+    /// The selected entries, best first. Ends the selection: push() again only after reset().
+    [[nodiscard]] std::span<const Entry> sorted();
+
+  private:
+    void insert(float value, uint32_t index);
+
+    size_t k_{0};
+    float floor_{0.0f};
+    float cutoff_{0.0f}; // floor_ until the heap is full, then the worst held value
+    std::vector<Entry> heap_;
+};
+
+} // namespace rfdetr::processing
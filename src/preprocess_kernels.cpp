@@ -0,0 +1,411 @@
+#include "preprocess_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RFDETR_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define RFDETR_HAVE_NEON_KERNELS 1
+#include <arm_neon.h>
+#endif
+
+namespace rfdetr::media {
+
+namespace {
+
+/// Resample one BGR24 source row horizontally into planar R, G, B float rows (columns [begin, end)).
+using HorizontalFn = void (*)(const uint8_t *row, const BilinearAxis &x_table, int safe_cols, int begin, int end,
+                              float *r, float *g, float *b);
+
+/// Blend two resampled rows vertically and apply the per-plane normalization.
+using VerticalFn = void (*)(const float *top, const float *bottom, float wy, int n, float scale, float bias,
+                            float *out);
+
+/// Blend two planar R, G, B resampled rows (planes `plane` floats apart) vertically and store them
+/// as interleaved RGB bytes, rounded to nearest. Edge extrapolation can leave [0, 255] slightly,
+/// hence the clamp.
+using VerticalU8Fn = void (*)(const float *top, const float *bottom, float wy, int n, size_t plane, uint8_t *out);
+
+struct Kernels {
+    HorizontalFn horizontal;
+    VerticalFn vertical;
+    VerticalU8Fn vertical_u8;
+};
+
+void horizontal_scalar(const uint8_t *row, const BilinearAxis &x_table, int /*safe_cols*/, int begin, int end, float *r,
+                       float *g, float *b) {
+    for (int x = begin; x < end; ++x) {
+        const auto idx = static_cast<size_t>(x);
+        const uint8_t *p0 = row + x_table.i0[idx];
+        const uint8_t *p1 = row + x_table.i1[idx];
+        const float w = x_table.w[idx];
+        const float iw = 1.0f - w;
+        b[idx] = static_cast<float>(p0[0]) * iw + static_cast<float>(p1[0]) * w;
+        g[idx] = static_cast<float>(p0[1]) * iw + static_cast<float>(p1[1]) * w;
+        r[idx] = static_cast<float>(p0[2]) * iw + static_cast<float>(p1[2]) * w;
+    }
+}
+
+void vertical_scalar(const float *top, const float *bottom, float wy, int n, float scale, float bias, float *out) {
+    const float iwy = 1.0f - wy;
+    for (int i = 0; i < n; ++i) {
+        const auto idx = static_cast<size_t>(i);
+        out[idx] = (top[idx] * iwy + bottom[idx] * wy) * scale + bias;
+    }
+}
+
+void vertical_u8_scalar(const float *top, const float *bottom, float wy, int n, size_t plane, uint8_t *out) {
+    const float iwy = 1.0f - wy;
+    for (int i = 0; i < n; ++i) {
+        const auto idx = static_cast<size_t>(i);
+        for (size_t c = 0; c < 3; ++c) {
+            const float v = top[c * plane + idx] * iwy + bottom[c * plane + idx] * wy;
+            out[3 * idx + c] = static_cast<uint8_t>(std::clamp(v, 0.0f, 255.0f) + 0.5f);
+        }
+    }
+}
+
+#ifdef RFDETR_HAVE_X86_KERNELS
+
+// Each lane gathers the 4 bytes starting at its BGR triplet (B in the low byte on x86), then
+// splits them into three float channels. Columns past `safe_cols` fall back to the scalar path.
+__attribute__((target("avx2,fma"))) void horizontal_avx2(const uint8_t *row, const BilinearAxis &x_table,
+                                                         int safe_cols, int begin, int end, float *r, float *g,
+                                                         float *b) {
+    const auto *base = reinterpret_cast<const int *>(row);
+    const __m256i byte_mask = _mm256_set1_epi32(0xff);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const int vec_end = std::min(end, safe_cols);
+    int x = begin;
+    for (; x + 8 <= vec_end; x += 8) {
+        const auto idx = static_cast<size_t>(x);
+        const __m256i off0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x_table.i0.data() + idx));
+        const __m256i off1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x_table.i1.data() + idx));
+        const __m256i d0 = _mm256_i32gather_epi32(base, off0, 1);
+        const __m256i d1 = _mm256_i32gather_epi32(base, off1, 1);
+        const __m256 w = _mm256_loadu_ps(x_table.w.data() + idx);
+        const __m256 iw = _mm256_sub_ps(one, w);
+
+        const __m256 b0 = _mm256_cvtepi32_ps(_mm256_and_si256(d0, byte_mask));
+        const __m256 g0 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(d0, 8), byte_mask));
+        const __m256 r0 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(d0, 16), byte_mask));
+        const __m256 b1 = _mm256_cvtepi32_ps(_mm256_and_si256(d1, byte_mask));
+        const __m256 g1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(d1, 8), byte_mask));
+        const __m256 r1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(d1, 16), byte_mask));
+
+        _mm256_storeu_ps(b + idx, _mm256_fmadd_ps(b1, w, _mm256_mul_ps(b0, iw)));
+        _mm256_storeu_ps(g + idx, _mm256_fmadd_ps(g1, w, _mm256_mul_ps(g0, iw)));
+        _mm256_storeu_ps(r + idx, _mm256_fmadd_ps(r1, w, _mm256_mul_ps(r0, iw)));
+    }
+    horizontal_scalar(row, x_table, safe_cols, x, end, r, g, b);
+}
+
+__attribute__((target("avx2,fma"))) void vertical_avx2(const float *top, const float *bottom, float wy, int n,
+                                                       float scale, float bias, float *out) {
+    const __m256 vwy = _mm256_set1_ps(wy);
+    const __m256 viwy = _mm256_set1_ps(1.0f - wy);
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vbias = _mm256_set1_ps(bias);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const auto idx = static_cast<size_t>(i);
+        const __m256 blended =
+            _mm256_fmadd_ps(_mm256_loadu_ps(bottom + idx), vwy, _mm256_mul_ps(_mm256_loadu_ps(top + idx), viwy));
+        _mm256_storeu_ps(out + idx, _mm256_fmadd_ps(blended, vscale, vbias));
+    }
+    const auto done = static_cast<size_t>(i);
+    vertical_scalar(top + done, bottom + done, wy, n - i, scale, bias, out + done);
+}
+
+// Packs each pixel as a 0x00BBGGRR dword, then drops the zero byte within each 128-bit lane so a
+// lane holds 4 pixels in 12 bytes. The upper lane's 16-byte store spills 4 bytes into pixels
+// i + 8 and i + 9, which the next iteration (or the scalar tail) overwrites, so the loop stops
+// while both still exist.
+__attribute__((target("avx2,fma"))) void vertical_u8_avx2(const float *top, const float *bottom, float wy, int n,
+                                                          size_t plane, uint8_t *out) {
+    const __m256 vwy = _mm256_set1_ps(wy);
+    const __m256 viwy = _mm256_set1_ps(1.0f - wy);
+    const __m256 lo = _mm256_setzero_ps();
+    const __m256 hi = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i drop_high_byte = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, //
+                                                    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 10 <= n; i += 8) {
+        const auto idx = static_cast<size_t>(i);
+        __m256i packed = _mm256_setzero_si256();
+        for (size_t c = 0; c < 3; ++c) {
+            const float *t = top + c * plane + idx;
+            const float *b = bottom + c * plane + idx;
+            const __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(b), vwy, _mm256_mul_ps(_mm256_loadu_ps(t), viwy));
+            const __m256i byte = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(v, lo), hi), half));
+            packed = _mm256_or_si256(packed, _mm256_sll_epi32(byte, _mm_cvtsi64_si128(static_cast<long long>(8 * c))));
+        }
+        packed = _mm256_shuffle_epi8(packed, drop_high_byte);
+        uint8_t *dst = out + 3 * idx;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), _mm256_extracti128_si256(packed, 1));
+    }
+    const auto done = static_cast<size_t>(i);
+    vertical_u8_scalar(top + done, bottom + done, wy, n - i, plane, out + 3 * done);
+}
+
+// GCC's AVX-512 headers trip two false positives here: conversions seeded with a self-initialized
+// "undefined" register (-Wmaybe-uninitialized, once inlined), and at -O0 the gather macros'
+// `(__mmask16)-1` argument (-Wsign-conversion).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#endif
+
+__attribute__((target("avx512f"))) void horizontal_avx512(const uint8_t *row, const BilinearAxis &x_table,
+                                                          int safe_cols, int begin, int end, float *r, float *g,
+                                                          float *b) {
+    const __m512i byte_mask = _mm512_set1_epi32(0xff);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const int vec_end = std::min(end, safe_cols);
+    int x = begin;
+    for (; x + 16 <= vec_end; x += 16) {
+        const auto idx = static_cast<size_t>(x);
+        const __m512i off0 = _mm512_loadu_si512(x_table.i0.data() + idx);
+        const __m512i off1 = _mm512_loadu_si512(x_table.i1.data() + idx);
+        const __m512i d0 = _mm512_i32gather_epi32(off0, row, 1);
+        const __m512i d1 = _mm512_i32gather_epi32(off1, row, 1);
+        const __m512 w = _mm512_loadu_ps(x_table.w.data() + idx);
+        const __m512 iw = _mm512_sub_ps(one, w);
+
+        const __m512 b0 = _mm512_cvtepi32_ps(_mm512_and_si512(d0, byte_mask));
+        const __m512 g0 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(d0, 8), byte_mask));
+        const __m512 r0 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(d0, 16), byte_mask));
+        const __m512 b1 = _mm512_cvtepi32_ps(_mm512_and_si512(d1, byte_mask));
+        const __m512 g1 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(d1, 8), byte_mask));
+        const __m512 r1 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(d1, 16), byte_mask));
+
+        _mm512_storeu_ps(b + idx, _mm512_fmadd_ps(b1, w, _mm512_mul_ps(b0, iw)));
+        _mm512_storeu_ps(g + idx, _mm512_fmadd_ps(g1, w, _mm512_mul_ps(g0, iw)));
+        _mm512_storeu_ps(r + idx, _mm512_fmadd_ps(r1, w, _mm512_mul_ps(r0, iw)));
+    }
+    horizontal_scalar(row, x_table, safe_cols, x, end, r, g, b);
+}
+
+__attribute__((target("avx512f"))) void vertical_avx512(const float *top, const float *bottom, float wy, int n,
+                                                        float scale, float bias, float *out) {
+    const __m512 vwy = _mm512_set1_ps(wy);
+    const __m512 viwy = _mm512_set1_ps(1.0f - wy);
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 vbias = _mm512_set1_ps(bias);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const auto idx = static_cast<size_t>(i);
+        const __m512 blended =
+            _mm512_fmadd_ps(_mm512_loadu_ps(bottom + idx), vwy, _mm512_mul_ps(_mm512_loadu_ps(top + idx), viwy));
+        _mm512_storeu_ps(out + idx, _mm512_fmadd_ps(blended, vscale, vbias));
+    }
+    const auto done = static_cast<size_t>(i);
+    vertical_scalar(top + done, bottom + done, wy, n - i, scale, bias, out + done);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // RFDETR_HAVE_X86_KERNELS
+
+#ifdef RFDETR_HAVE_NEON_KERNELS
+
+// NEON has no gather, so the horizontal pass stays scalar; the vertical blend + normalize,
+// which touches every output element, is vectorized.
+void vertical_neon(const float *top, const float *bottom, float wy, int n, float scale, float bias, float *out) {
+    const float32x4_t vwy = vdupq_n_f32(wy);
+    const float32x4_t viwy = vdupq_n_f32(1.0f - wy);
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    const float32x4_t vbias = vdupq_n_f32(bias);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const auto idx = static_cast<size_t>(i);
+        const float32x4_t blended = vfmaq_f32(vmulq_f32(vld1q_f32(top + idx), viwy), vld1q_f32(bottom + idx), vwy);
+        vst1q_f32(out + idx, vfmaq_f32(vbias, blended, vscale));
+    }
+    const auto done = static_cast<size_t>(i);
+    vertical_scalar(top + done, bottom + done, wy, n - i, scale, bias, out + done);
+}
+
+// Rounds 8 blended floats of one plane to bytes (vcvtq_u32_f32 truncates, hence the +0.5).
+inline uint8x8_t blend_to_u8(const float *top, const float *bottom, float32x4_t vwy, float32x4_t viwy) {
+    const float32x4_t lo = vdupq_n_f32(0.0f);
+    const float32x4_t hi = vdupq_n_f32(255.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t a = vfmaq_f32(vmulq_f32(vld1q_f32(top), viwy), vld1q_f32(bottom), vwy);
+    const float32x4_t b = vfmaq_f32(vmulq_f32(vld1q_f32(top + 4), viwy), vld1q_f32(bottom + 4), vwy);
+    const uint32x4_t ua = vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(a, lo), hi), half));
+    const uint32x4_t ub = vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(b, lo), hi), half));
+    return vmovn_u16(vcombine_u16(vmovn_u32(ua), vmovn_u32(ub)));
+}
+
+void vertical_u8_neon(const float *top, const float *bottom, float wy, int n, size_t plane, uint8_t *out) {
+    const float32x4_t vwy = vdupq_n_f32(wy);
+    const float32x4_t viwy = vdupq_n_f32(1.0f - wy);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const auto idx = static_cast<size_t>(i);
+        uint8x8x3_t rgb;
+        rgb.val[0] = blend_to_u8(top + idx, bottom + idx, vwy, viwy);
+        rgb.val[1] = blend_to_u8(top + plane + idx, bottom + plane + idx, vwy, viwy);
+        rgb.val[2] = blend_to_u8(top + 2 * plane + idx, bottom + 2 * plane + idx, vwy, viwy);
+        vst3_u8(out + 3 * idx, rgb);
+    }
+    const auto done = static_cast<size_t>(i);
+    vertical_u8_scalar(top + done, bottom + done, wy, n - i, plane, out + 3 * done);
+}
+
+#endif // RFDETR_HAVE_NEON_KERNELS
+
+Kernels select_kernels(cpu::SimdLevel level) {
+    if (!cpu::simd_level_supported(level)) {
+        throw std::runtime_error("SIMD level not supported on this CPU: " + std::string(cpu::to_string(level)));
+    }
+    switch (level) {
+#ifdef RFDETR_HAVE_X86_KERNELS
+    case cpu::SimdLevel::AVX2:
+        return {horizontal_avx2, vertical_avx2, vertical_u8_avx2};
+    case cpu::SimdLevel::AVX512:
+        // The byte packing is shuffle-bound; AVX-512F alone has no wider byte shuffle to offer.
+        return {horizontal_avx512, vertical_avx512, vertical_u8_avx2};
+#endif
+#ifdef RFDETR_HAVE_NEON_KERNELS
+    case cpu::SimdLevel::NEON:
+        return {horizontal_scalar, vertical_neon, vertical_u8_neon};
+#endif
+    default:
+        return {horizontal_scalar, vertical_scalar, vertical_u8_scalar};
+    }
+}
+
+} // anonymous namespace
+
+NormalizeCoefficients make_normalize_coefficients(std::span<const float, 3> means,
+                                                  std::span<const float, 3> stds) noexcept {
+    NormalizeCoefficients coeffs;
+    for (size_t c = 0; c < 3; ++c) {
+        coeffs.scale[c] = 1.0f / (255.0f * stds[c]);
+        coeffs.bias[c] = -means[c] / stds[c];
+    }
+    return coeffs;
+}
+
+void resize_normalize_bgr_to_chw(const Image &image, std::span<float> output, const OutputCanvas &canvas,
+                                 const BilinearResampler &resampler, const NormalizeCoefficients &coeffs,
+                                 std::span<float> scratch, cpu::SimdLevel level, int row_begin, int row_end) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    if (!resampler.matches(image.width, image.height, resampler.dst_width(), resampler.dst_height(), 3)) {
+        throw std::runtime_error("BilinearResampler is not configured for a " + std::to_string(image.width) + "x" +
+                                 std::to_string(image.height) + " BGR image");
+    }
+    if (canvas.x < 0 || canvas.y < 0 || canvas.x + resampler.dst_width() > canvas.width ||
+        canvas.y + resampler.dst_height() > canvas.height) {
+        throw std::runtime_error("Resized image does not fit inside the output canvas");
+    }
+    const auto out_w = static_cast<size_t>(resampler.dst_width());
+    const auto canvas_w = static_cast<size_t>(canvas.width);
+    const size_t plane = canvas_w * static_cast<size_t>(canvas.height);
+    if (output.size() < 3 * plane) {
+        throw std::runtime_error("Output tensor is too small for requested resolution");
+    }
+    const size_t row_floats = 3 * out_w;
+    if (scratch.size() < 2 * row_floats) {
+        throw std::runtime_error("Preprocess scratch buffer is too small");
+    }
+    if (row_begin < 0 || row_end > resampler.dst_height() || row_begin > row_end) {
+        throw std::runtime_error("Preprocess row range out of bounds");
+    }
+
+    const Kernels kernels = select_kernels(level);
+    const BilinearAxis &x_axis = resampler.x_axis();
+    const int safe_cols = resampler.dword_safe_columns();
+    const int dst_w = resampler.dst_width();
+    const auto row_bytes = static_cast<size_t>(image.width) * 3;
+    float *origin = output.data() + static_cast<size_t>(canvas.y) * canvas_w + static_cast<size_t>(canvas.x);
+
+    // Row buffers hold one horizontally resampled source row as planar R, G, B.
+    for_each_bilinear_row(
+        resampler.y_axis(), row_begin, row_end, scratch, row_floats,
+        [&](int src_row, float *dst) {
+            const uint8_t *src = image.data() + static_cast<size_t>(src_row) * row_bytes;
+            kernels.horizontal(src, x_axis, safe_cols, 0, dst_w, dst, dst + out_w, dst + 2 * out_w);
+        },
+        [&](int dst_row, const float *top, const float *bottom, float wy) {
+            float *out = origin + static_cast<size_t>(dst_row) * canvas_w;
+            for (size_t c = 0; c < 3; ++c) {
+                kernels.vertical(top + c * out_w, bottom + c * out_w, wy, dst_w, coeffs.scale[c], coeffs.bias[c],
+                                 out + c * plane);
+            }
+        });
+}
+
+void resize_bgr_to_rgb_hwc(const Image &image, std::span<uint8_t> output, const OutputCanvas &canvas,
+                           const BilinearResampler &resampler, std::span<float> scratch, cpu::SimdLevel level,
+                           int row_begin, int row_end) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    if (!resampler.matches(image.width, image.height, resampler.dst_width(), resampler.dst_height(), 3)) {
+        throw std::runtime_error("BilinearResampler is not configured for a " + std::to_string(image.width) + "x" +
+                                 std::to_string(image.height) + " BGR image");
+    }
+    if (canvas.x < 0 || canvas.y < 0 || canvas.x + resampler.dst_width() > canvas.width ||
+        canvas.y + resampler.dst_height() > canvas.height) {
+        throw std::runtime_error("Resized image does not fit inside the output canvas");
+    }
+    const auto out_w = static_cast<size_t>(resampler.dst_width());
+    const size_t canvas_row = 3 * static_cast<size_t>(canvas.width);
+    if (output.size() < canvas_row * static_cast<size_t>(canvas.height)) {
+        throw std::runtime_error("Output tensor is too small for requested resolution");
+    }
+    const size_t row_floats = 3 * out_w;
+    if (scratch.size() < 2 * row_floats) {
+        throw std::runtime_error("Preprocess scratch buffer is too small");
+    }
+    if (row_begin < 0 || row_end > resampler.dst_height() || row_begin > row_end) {
+        throw std::runtime_error("Preprocess row range out of bounds");
+    }
+
+    const Kernels kernels = select_kernels(level);
+    const BilinearAxis &x_axis = resampler.x_axis();
+    const int safe_cols = resampler.dword_safe_columns();
+    const int dst_w = resampler.dst_width();
+    const auto row_bytes = static_cast<size_t>(image.width) * 3;
+    uint8_t *origin = output.data() + static_cast<size_t>(canvas.y) * canvas_row + 3 * static_cast<size_t>(canvas.x);
+
+    for_each_bilinear_row(
+        resampler.y_axis(), row_begin, row_end, scratch, row_floats,
+        [&](int src_row, float *dst) {
+            const uint8_t *src = image.data() + static_cast<size_t>(src_row) * row_bytes;
+            kernels.horizontal(src, x_axis, safe_cols, 0, dst_w, dst, dst + out_w, dst + 2 * out_w);
+        },
+        [&](int dst_row, const float *top, const float *bottom, float wy) {
+            kernels.vertical_u8(top, bottom, wy, dst_w, out_w, origin + static_cast<size_t>(dst_row) * canvas_row);
+        });
+}
+
+void resize_normalize_bgr_to_chw(const Image &image, std::span<float> output, int resolution,
+                                 const NormalizeCoefficients &coeffs, cpu::SimdLevel level) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    BilinearResampler resampler(image.width, image.height, resolution, resolution, 3);
+    resize_normalize_bgr_to_chw(image, output, OutputCanvas{resolution, resolution}, resampler, coeffs,
+                                resampler.scratch(6 * static_cast<size_t>(resolution)), level, 0, resolution);
+}
+
+} // namespace rfdetr::media
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "bilinear_resampler.hpp"
+#include "cpu_features.hpp"
+#include "media.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace rfdetr::media {
+
+/// Per-output-plane affine map that folds `/255` and `(x - mean) / std` into a single
+/// multiply-add: `out = pixel * scale + bias`. Planes are in RGB (model input) order.
+struct NormalizeCoefficients {
+    std::array<float, 3> scale{};
+    std::array<float, 3> bias{};
+};
+
+[[nodiscard]] NormalizeCoefficients make_normalize_coefficients(std::span<const float, 3> means,
+                                                                std::span<const float, 3> stds) noexcept;
+
+/// Placement of the resized image inside a larger `width x height` output tensor (CHW or HWC),
+/// with its top-left pixel at (x, y). Stretch preprocessing uses the whole tensor; letterboxing
+/// leaves a border that the caller fills.
+struct OutputCanvas {
+    int width{0};
+    int height{0};
+    int x{0};
+    int y{0};
+};
+
+/// Single-pass bilinear resize + BGR->RGB swap + normalization of a BGR24 image into a
+/// `3 x dst_height x dst_width` CHW float tensor, using `resampler`'s precomputed tables.
+///
+/// Each source row is resampled horizontally once into a planar RGB row buffer (reused by the
+/// next output row when it shares the source row), then pairs of buffered rows are blended
+/// vertically and normalized straight into the output planes. Sampling positions and weights
+/// match the reference scalar loop (half-pixel centers, antialias-free), so results differ
+/// from it only by float rounding.
+///
+/// The resized image is written at `canvas`'s offset; pixels outside it are left untouched. Only
+/// resized rows [row_begin, row_end) are written, so disjoint row ranges can run on different
+/// threads (each with its own scratch) and produce the same tensor as a single call.
+///
+/// `resampler` must be configured for the image size with 3 channels; `scratch` must hold
+/// `6 * dst_width` floats. `level` must satisfy `cpu::simd_level_supported(level)`.
+void resize_normalize_bgr_to_chw(const Image &image, std::span<float> output, const OutputCanvas &canvas,
+                                 const BilinearResampler &resampler, const NormalizeCoefficients &coeffs,
+                                 std::span<float> scratch, cpu::SimdLevel level, int row_begin, int row_end);
+
+/// Bilinear resize + BGR->RGB swap into an interleaved `height x width x 3` uint8 tensor (NHWC,
+/// for models that normalize in-graph). Same sampling, canvas and row-range contract as
+/// resize_normalize_bgr_to_chw; values are clamped to [0, 255] and rounded to nearest.
+void resize_bgr_to_rgb_hwc(const Image &image, std::span<uint8_t> output, const OutputCanvas &canvas,
+                           const BilinearResampler &resampler, std::span<float> scratch, cpu::SimdLevel level,
+                           int row_begin, int row_end);
+
+/// Convenience overload for one-off images: builds the tables for a square `resolution` output.
+void resize_normalize_bgr_to_chw(const Image &image, std::span<float> output, int resolution,
+                                 const NormalizeCoefficients &coeffs, cpu::SimdLevel level);
+
+} // namespace rfdetr::media
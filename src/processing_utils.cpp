@@ -3,11 +3,24 @@
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 namespace rfdetr::processing {
 
 float sigmoid(float x) noexcept { return 1.0f / (1.0f + std::exp(-x)); }
 
+float logit(float p) noexcept {
+    if (p <= 0.0f) {
+        return -std::numeric_limits<float>::infinity();
+    }
+    if (p >= 1.0f) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return std::log(p / (1.0f - p));
+}
+
 void normalize_image(std::span<float> data, size_t channel_size, std::span<const float, 3> means,
                      std::span<const float, 3> stds) {
     for (size_t c = 0; c < 3; ++c) {
@@ -32,4 +45,35 @@ BoundingBox clamp_box(const BoundingBox &box, float max_w, float max_h) noexcept
             std::clamp(box.y_max, 0.0f, max_h)};
 }
 
+InputTransform make_input_transform(ResizeMode mode, int src_width, int src_height, int resolution) {
+    if (src_width <= 0 || src_height <= 0 || resolution <= 0) {
+        throw std::runtime_error("Invalid input geometry " + std::to_string(src_width) + "x" +
+                                 std::to_string(src_height) + " for model resolution " + std::to_string(resolution));
+    }
+    InputTransform t;
+    t.src_width = src_width;
+    t.src_height = src_height;
+    t.content_width = resolution;
+    t.content_height = resolution;
+    if (mode == ResizeMode::LETTERBOX) {
+        const double ratio =
+            std::min(static_cast<double>(resolution) / src_width, static_cast<double>(resolution) / src_height);
+        t.content_width = std::clamp(static_cast<int>(std::lround(src_width * ratio)), 1, resolution);
+        t.content_height = std::clamp(static_cast<int>(std::lround(src_height * ratio)), 1, resolution);
+        t.content_x = (resolution - t.content_width) / 2;
+        t.content_y = (resolution - t.content_height) / 2;
+    }
+    t.scale_x = static_cast<float>(src_width) / static_cast<float>(t.content_width);
+    t.scale_y = static_cast<float>(src_height) / static_cast<float>(t.content_height);
+    return t;
+}
+
+BoundingBox unmap_box(const BoundingBox &box, const InputTransform &transform) noexcept {
+    const auto dx = static_cast<float>(transform.content_x);
+    const auto dy = static_cast<float>(transform.content_y);
+    const BoundingBox shifted{box.x_min - dx, box.y_min - dy, box.x_max - dx, box.y_max - dy};
+    return clamp_box(scale_box(shifted, transform.scale_x, transform.scale_y),
+                     static_cast<float>(transform.src_width), static_cast<float>(transform.src_height));
+}
+
 } // namespace rfdetr::processing
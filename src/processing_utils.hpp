@@ -11,6 +11,9 @@ namespace rfdetr::processing {
 /// Sigmoid activation: maps logit to probability [0, 1]
 [[nodiscard]] float sigmoid(float x) noexcept;
 
+/// Inverse of sigmoid: the logit whose probability is p; -inf for p <= 0 and +inf for p >= 1
+[[nodiscard]] float logit(float p) noexcept;
+
 /// Normalize CHW image data in-place: (pixel - mean) / std per channel
 void normalize_image(std::span<float> data, size_t channel_size, std::span<const float, 3> means,
                      std::span<const float, 3> stds);
@@ -26,4 +29,15 @@ using ::BoundingBox;
 /// Clamp a bounding box to image bounds [0, max_w] x [0, max_h]
 [[nodiscard]] BoundingBox clamp_box(const BoundingBox &box, float max_w, float max_h) noexcept;
 
+using ::InputTransform;
+using ::ResizeMode;
+
+/// Placement of a `src_width x src_height` image in a `resolution x resolution` model input.
+/// LETTERBOX rounds the uniformly scaled size to whole pixels and derives each axis' scale from the
+/// rounded size, so back-mapping is exact at the content edges.
+[[nodiscard]] InputTransform make_input_transform(ResizeMode mode, int src_width, int src_height, int resolution);
+
+/// Map a model-input xyxy box back to source pixels and clamp it to the source image.
+[[nodiscard]] BoundingBox unmap_box(const BoundingBox &box, const InputTransform &transform) noexcept;
+
 } // namespace rfdetr::processing
@@ -1,11 +1,13 @@
 #include "rfdetr_inference.hpp"
 
+#include "postprocess_kernels.hpp"
 #include "processing_utils.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <numeric>
 #include <stdexcept>
 
@@ -17,6 +19,10 @@ RFDETRInference::RFDETRInference(const std::filesystem::path &model_path, const
 
     // Initialize backend
     input_shape_ = backend_->initialize(model_path, input_shape_);
+    input_format_ = backend_->get_input_format();
+    if (input_format_ == InputFormat::UINT8_NHWC) {
+        std::cout << "Model takes uint8 NHWC input (normalization in graph)" << std::endl;
+    }
 
     // Update resolution if auto-detected
     if (config_.resolution == 0 && input_shape_.size() == 4) {
@@ -45,10 +51,26 @@ RFDETRInference::RFDETRInference(const std::filesystem::path &model_path, const
 
 RFDETRInference::RFDETRInference(std::unique_ptr<InferenceBackend> backend,
                                  const std::filesystem::path &label_file_path, const Config &config)
-    : backend_(std::move(backend)), config_(config), input_shape_({1, 3, config_.resolution, config_.resolution}) {
+    : backend_(std::move(backend)), config_(config), input_shape_({1, 3, config_.resolution, config_.resolution}),
+      input_format_(backend_->get_input_format()) {
+    if (input_format_ == InputFormat::UINT8_NHWC) {
+        input_shape_ = {1, config_.resolution, config_.resolution, 3};
+    }
     load_coco_labels(label_file_path);
 }
 
+RFDETRInference::RFDETRInference(PostprocessOnly, const std::filesystem::path &label_file_path, const Config &config)
+    : config_(config), input_shape_({1, 3, config_.resolution, config_.resolution}) {
+    if (config_.resolution <= 0) {
+        throw std::runtime_error("A postprocessor needs the model's resolution; it cannot auto-detect it");
+    }
+    load_coco_labels(label_file_path);
+}
+
+RFDETRInference RFDETRInference::postprocessor(const std::filesystem::path &label_file_path, const Config &config) {
+    return {PostprocessOnly{}, label_file_path, config};
+}
+
 void RFDETRInference::load_coco_labels(const std::filesystem::path &label_file_path) {
     if (!std::filesystem::exists(label_file_path)) {
         throw std::runtime_error("Label file does not exist: " + label_file_path.string());
@@ -86,82 +108,269 @@ std::vector<float> RFDETRInference::preprocess_image(const rfdetr::media::Image
     const auto res = static_cast<size_t>(config_.resolution);
     std::vector<float> input_tensor_values(3 * res * res);
     rfdetr::media::preprocess_bgr_image(bgr_image, input_tensor_values, config_.resolution, config_.means,
-                                        config_.stds);
+                                        config_.stds, make_input_transform(orig_w, orig_h), preprocess_resampler_);
     return input_tensor_values;
 }
 
+std::vector<uint8_t> RFDETRInference::preprocess_image_u8(const rfdetr::media::Image &bgr_image, int &orig_h,
+                                                          int &orig_w) {
+    if (bgr_image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    orig_h = bgr_image.height;
+    orig_w = bgr_image.width;
+
+    const auto res = static_cast<size_t>(config_.resolution);
+    std::vector<uint8_t> input_tensor_values(3 * res * res);
+    rfdetr::media::preprocess_bgr_image_u8(bgr_image, input_tensor_values, config_.resolution, config_.means,
+                                           make_input_transform(orig_w, orig_h), preprocess_resampler_);
+    return input_tensor_values;
+}
+
+std::vector<float> RFDETRInference::preprocess_batch(std::span<const rfdetr::media::Image> bgr_images) {
+    const auto res = static_cast<size_t>(config_.resolution);
+    const size_t image_size = 3 * res * res;
+    std::vector<float> batch(bgr_images.size() * image_size);
+    for (size_t i = 0; i < bgr_images.size(); ++i) {
+        const auto &image = bgr_images[i];
+        rfdetr::media::preprocess_bgr_image(image, std::span<float>(batch).subspan(i * image_size, image_size),
+                                            config_.resolution, config_.means, config_.stds,
+                                            make_input_transform(image.width, image.height), preprocess_resampler_);
+    }
+    return batch;
+}
+
+std::vector<uint8_t> RFDETRInference::preprocess_batch_u8(std::span<const rfdetr::media::Image> bgr_images) {
+    const auto res = static_cast<size_t>(config_.resolution);
+    const size_t image_size = 3 * res * res;
+    std::vector<uint8_t> batch(bgr_images.size() * image_size);
+    for (size_t i = 0; i < bgr_images.size(); ++i) {
+        const auto &image = bgr_images[i];
+        rfdetr::media::preprocess_bgr_image_u8(image, std::span<uint8_t>(batch).subspan(i * image_size, image_size),
+                                               config_.resolution, config_.means,
+                                               make_input_transform(image.width, image.height),
+                                               preprocess_resampler_);
+    }
+    return batch;
+}
+
+InputTransform RFDETRInference::make_input_transform(int orig_w, int orig_h) const {
+    return rfdetr::processing::make_input_transform(config_.resize_mode, orig_w, orig_h, config_.resolution);
+}
+
+namespace {
+
+// Model input covered by the image when a caller only supplies stretch scale factors.
+InputTransform stretch_transform(float scale_w, float scale_h, int orig_w, int orig_h, int resolution) noexcept {
+    InputTransform t;
+    t.src_width = orig_w;
+    t.src_height = orig_h;
+    t.content_width = resolution;
+    t.content_height = resolution;
+    t.scale_x = scale_w;
+    t.scale_y = scale_h;
+    return t;
+}
+
+} // anonymous namespace
+
 void RFDETRInference::run_inference(std::span<const float> input_data) {
-    // Run inference through backend
+    if (input_format_ != InputFormat::FLOAT32_NCHW) {
+        throw std::runtime_error("Model expects uint8 NHWC input; use preprocess_image_u8()");
+    }
+    require_backend();
+    set_batch_size(input_data.size());
+    backend_->run_inference(input_data, input_shape_);
+    cache_outputs();
+}
+
+void RFDETRInference::run_inference(std::span<const uint8_t> input_data) {
+    if (input_format_ != InputFormat::UINT8_NHWC) {
+        throw std::runtime_error("Model expects float32 NCHW input; use preprocess_image()");
+    }
+    require_backend();
+    set_batch_size(input_data.size());
     backend_->run_inference(input_data, input_shape_);
+    cache_outputs();
+}
 
-    // Cache output data and shapes for postprocessing
+void RFDETRInference::require_backend() const {
+    if (!backend_) {
+        throw std::runtime_error("This RFDETRInference is a postprocessor and has no model to run");
+    }
+}
+
+void RFDETRInference::set_batch_size(size_t elements) {
+    const auto res = static_cast<size_t>(config_.resolution);
+    const size_t image_size = 3 * res * res;
+    if (elements == 0 || elements % image_size != 0) {
+        throw std::runtime_error("Input tensor holds " + std::to_string(elements) +
+                                 " values, not a whole number of " + std::to_string(config_.resolution) + "x" +
+                                 std::to_string(config_.resolution) + " images");
+    }
+    batch_size_ = elements / image_size;
+    input_shape_[0] = static_cast<int64_t>(batch_size_);
+}
+
+std::span<const float> RFDETRInference::output_item(size_t output_index, size_t batch_index) const {
+    const auto &shape = output_shapes_[output_index];
+    const auto batch = shape.empty() ? size_t{0} : static_cast<size_t>(shape[0]);
+    if (batch_index >= batch) {
+        throw std::out_of_range("Batch index " + std::to_string(batch_index) + " out of range for output " +
+                                std::to_string(output_index) + " with batch size " + std::to_string(batch));
+    }
+    const size_t item_size = output_views_[output_index].size() / batch;
+    return output_views_[output_index].subspan(batch_index * item_size, item_size);
+}
+
+void RFDETRInference::argmax_queries(std::span<const float> labels, size_t num_queries, size_t num_classes) {
+    query_max_logits_.resize(num_queries);
+    query_max_classes_.resize(num_queries);
+    rfdetr::processing::argmax_rows(labels.first(num_queries * num_classes), num_classes, query_max_logits_,
+                                    query_max_classes_);
+}
+
+void RFDETRInference::cache_outputs() {
+    // Postprocessing reads the backend's buffers and shapes in place; nothing is copied
     const size_t num_outputs = backend_->get_output_count();
-    output_data_cache_.clear();
-    output_shapes_cache_.clear();
+    mask_queries_ = {};
+    output_views_.resize(num_outputs);
+    output_shapes_.resize(num_outputs);
 
     for (size_t i = 0; i < num_outputs; ++i) {
-        auto shape = backend_->get_output_shape(i);
+        output_shapes_[i] = backend_->get_output_shape_view(i);
+        const auto shape = output_shapes_[i];
         const size_t size = std::accumulate(shape.begin(), shape.end(), size_t{1},
                                             [](size_t acc, int64_t dim) { return acc * static_cast<size_t>(dim); });
 
-        std::vector<float> data(size);
-        backend_->get_output_data(i, data.data(), size);
+        output_views_[i] = backend_->get_output_view(i);
+        if (output_views_[i].size() != size) {
+            throw std::runtime_error("Output " + std::to_string(i) + " holds " +
+                                     std::to_string(output_views_[i].size()) + " values but its shape implies " +
+                                     std::to_string(size));
+        }
+    }
+}
+
+void RFDETRInference::capture_outputs(InferenceOutputs &outputs) const {
+    outputs.mask_queries.assign(mask_queries_.begin(), mask_queries_.end());
+    outputs.tensors.resize(output_views_.size());
+    outputs.shapes.resize(output_shapes_.size());
+    for (size_t i = 0; i < output_views_.size(); ++i) {
+        outputs.tensors[i].assign(output_views_[i].begin(), output_views_[i].end());
+        outputs.shapes[i].assign(output_shapes_[i].begin(), output_shapes_[i].end());
+    }
+    outputs.batch_size = batch_size_;
+}
+
+void RFDETRInference::capture_outputs(InferenceOutputs &outputs, size_t batch_index) {
+    outputs.tensors.resize(output_views_.size());
+    outputs.shapes.resize(output_shapes_.size());
+    outputs.mask_queries.clear();
+    const bool compact_masks = config_.model_type == ModelType::SEGMENTATION && output_views_.size() == 3;
+    for (size_t i = 0; i < output_views_.size(); ++i) {
+        outputs.shapes[i].assign(output_shapes_[i].begin(), output_shapes_[i].end());
+        outputs.shapes[i][0] = 1;
+        if (compact_masks && i == 2) {
+            continue;
+        }
+        const auto item = output_item(i, batch_index);
+        outputs.tensors[i].assign(item.begin(), item.end());
+    }
+    outputs.batch_size = 1;
+    if (!compact_masks) {
+        return;
+    }
+
+    // The mask logits dwarf everything else ([Q, H, W] per image), and decode_segmentation() only
+    // reads the planes of its top-k queries. Run the same selection on the labels and copy just those.
+    const auto labels_data = output_item(1, batch_index);
+    const auto num_queries = static_cast<size_t>(output_shapes_[1][1]);
+    const auto num_classes = static_cast<size_t>(output_shapes_[1][2]);
+    const size_t num_scores = num_queries * num_classes;
+    topk_.reset(std::min(static_cast<size_t>(std::max(config_.max_detections, 0)), num_scores),
+                rfdetr::processing::logit(config_.threshold));
+    topk_.push(labels_data.first(num_scores));
+    for (const auto &candidate : topk_.sorted()) {
+        outputs.mask_queries.push_back(candidate.index / num_classes);
+    }
+    std::sort(outputs.mask_queries.begin(), outputs.mask_queries.end());
+    outputs.mask_queries.erase(std::unique(outputs.mask_queries.begin(), outputs.mask_queries.end()),
+                               outputs.mask_queries.end());
+
+    const auto masks_data = output_item(2, batch_index);
+    const size_t plane_size = masks_data.size() / num_queries;
+    auto &masks = outputs.tensors[2];
+    masks.resize(outputs.mask_queries.size() * plane_size);
+    for (size_t k = 0; k < outputs.mask_queries.size(); ++k) {
+        const auto plane = masks_data.subspan(outputs.mask_queries[k] * plane_size, plane_size);
+        std::copy(plane.begin(), plane.end(), masks.begin() + static_cast<std::ptrdiff_t>(k * plane_size));
+    }
+    outputs.shapes[2][1] = static_cast<int64_t>(outputs.mask_queries.size());
+}
 
-        output_data_cache_.push_back(std::move(data));
-        output_shapes_cache_.push_back(std::move(shape));
+void RFDETRInference::load_outputs(const InferenceOutputs &outputs) {
+    if (outputs.tensors.size() != outputs.shapes.size()) {
+        throw std::runtime_error("InferenceOutputs holds " + std::to_string(outputs.tensors.size()) + " tensors but " +
+                                 std::to_string(outputs.shapes.size()) + " shapes");
     }
+    output_views_.assign(outputs.tensors.begin(), outputs.tensors.end());
+    output_shapes_.assign(outputs.shapes.begin(), outputs.shapes.end());
+    batch_size_ = outputs.batch_size;
+    mask_queries_ = outputs.mask_queries;
 }
 
 void RFDETRInference::postprocess_outputs(float scale_w, float scale_h, std::vector<float> &scores,
                                           std::vector<int> &class_ids, std::vector<BoundingBox> &boxes) {
-    if (output_data_cache_.size() < 2) {
+    const auto res = static_cast<float>(config_.resolution);
+    postprocess_outputs(stretch_transform(scale_w, scale_h, static_cast<int>(std::lround(scale_w * res)),
+                                          static_cast<int>(std::lround(scale_h * res)), config_.resolution),
+                        scores, class_ids, boxes);
+}
+
+void RFDETRInference::postprocess_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                          std::vector<int> &class_ids, std::vector<BoundingBox> &boxes) {
+    postprocess_outputs(0, transform, scores, class_ids, boxes);
+}
+
+void RFDETRInference::postprocess_outputs(size_t batch_index, const InputTransform &transform,
+                                          std::vector<float> &scores, std::vector<int> &class_ids,
+                                          std::vector<BoundingBox> &boxes) {
+    if (output_views_.size() < 2) {
         throw std::runtime_error("Expected at least 2 output tensors, got " +
-                                 std::to_string(output_data_cache_.size()));
+                                 std::to_string(output_views_.size()));
     }
 
-    const auto &dets_data = output_data_cache_[0];
-    const auto &dets_shape = output_shapes_cache_[0];
+    const auto dets_data = output_item(0, batch_index);
+    const auto dets_shape = output_shapes_[0];
 
-    const auto &labels_data = output_data_cache_[1];
-    const auto &labels_shape = output_shapes_cache_[1];
+    const auto labels_data = output_item(1, batch_index);
+    const auto labels_shape = output_shapes_[1];
 
     const auto num_detections = static_cast<size_t>(dets_shape[1]);
     const auto num_classes = static_cast<size_t>(labels_shape[2]);
     const auto res = static_cast<float>(config_.resolution);
-    const auto max_w = scale_w * res;
-    const auto max_h = scale_h * res;
 
-    for (size_t i = 0; i < num_detections; ++i) {
-        const size_t det_offset = i * static_cast<size_t>(dets_shape[2]);
-        const size_t label_offset = i * num_classes;
-
-        float max_score = -1.0f;
-        int max_class_idx = -1;
-        for (size_t j = 0; j < num_classes; ++j) {
-            const float logit = labels_data[label_offset + j];
-            const float score = rfdetr::processing::sigmoid(logit);
-            if (score > max_score) {
-                max_score = score;
-                max_class_idx = static_cast<int>(j);
-            }
-        }
+    // Threshold in logit space; the sigmoid (one exp) is only paid for the queries that pass
+    argmax_queries(labels_data, num_detections, num_classes);
+    const float logit_threshold = rfdetr::processing::logit(config_.threshold);
 
-        max_class_idx -= 1; // Fix the +1 offset
+    for (size_t i = 0; i < num_detections; ++i) {
+        const float max_logit = query_max_logits_[i];
+        const int max_class_idx = query_max_classes_[i] - 1; // Fix the +1 offset
 
-        if (max_score > config_.threshold && max_class_idx >= 0 &&
+        if (max_logit > logit_threshold && max_class_idx >= 0 &&
             static_cast<size_t>(max_class_idx) < coco_labels_.size()) {
+            const size_t det_offset = i * static_cast<size_t>(dets_shape[2]);
             const float cx = dets_data[det_offset + 0] * res;
             const float cy = dets_data[det_offset + 1] * res;
             const float w = dets_data[det_offset + 2] * res;
             const float h = dets_data[det_offset + 3] * res;
 
             auto xyxy = rfdetr::processing::cxcywh_to_xyxy(cx, cy, w, h);
-            auto scaled = rfdetr::processing::scale_box(xyxy, scale_w, scale_h);
-            auto clamped = rfdetr::processing::clamp_box(scaled, max_w, max_h);
-
-            BoundingBox box{clamped.x_min, clamped.y_min, clamped.x_max, clamped.y_max};
+            BoundingBox box = rfdetr::processing::unmap_box(xyxy, transform);
 
-            scores.push_back(max_score);
+            scores.push_back(rfdetr::processing::sigmoid(max_logit));
             class_ids.push_back(max_class_idx);
             boxes.push_back(std::move(box));
         }
@@ -172,61 +381,70 @@ void RFDETRInference::postprocess_segmentation_outputs(float scale_w, float scal
                                                        std::vector<float> &scores, std::vector<int> &class_ids,
                                                        std::vector<BoundingBox> &boxes,
                                                        std::vector<rfdetr::media::Mask> &masks) {
-    if (output_data_cache_.size() != 3) {
+    postprocess_segmentation_outputs(stretch_transform(scale_w, scale_h, orig_w, orig_h, config_.resolution), scores,
+                                     class_ids, boxes, masks);
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                                       std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::Mask> &masks) {
+    postprocess_segmentation_outputs(0, transform, scores, class_ids, boxes, masks);
+}
+
+template <typename EmitMask>
+void RFDETRInference::decode_segmentation(size_t batch_index, const InputTransform &transform,
+                                          std::vector<float> &scores, std::vector<int> &class_ids,
+                                          std::vector<BoundingBox> &boxes, EmitMask &&emit_mask) {
+    if (output_views_.size() != 3) {
         throw std::runtime_error("Expected 3 output tensors for segmentation, got " +
-                                 std::to_string(output_data_cache_.size()));
+                                 std::to_string(output_views_.size()));
     }
 
     // Get bounding boxes data
-    const auto &dets_data = output_data_cache_[0];
-    const auto &dets_shape = output_shapes_cache_[0];
+    const auto dets_data = output_item(0, batch_index);
+    const auto dets_shape = output_shapes_[0];
 
     // Get labels data
-    const auto &labels_data = output_data_cache_[1];
-    const auto &labels_shape = output_shapes_cache_[1];
+    const auto labels_data = output_item(1, batch_index);
+    const auto labels_shape = output_shapes_[1];
 
     // Get masks data
-    const auto &masks_data = output_data_cache_[2];
-    const auto &masks_shape = output_shapes_cache_[2];
+    const auto masks_data = output_item(2, batch_index);
+    const auto masks_shape = output_shapes_[2];
 
     const auto num_detections = static_cast<size_t>(dets_shape[1]);
     const auto num_classes = static_cast<size_t>(labels_shape[2]);
     const auto mask_h = static_cast<size_t>(masks_shape[2]);
     const auto mask_w = static_cast<size_t>(masks_shape[3]);
-
-    // Compute scores and apply sigmoid
-    std::vector<float> all_scores;
-    std::vector<size_t> all_indices;
-
-    for (size_t i = 0; i < num_detections; ++i) {
-        for (size_t j = 0; j < num_classes; ++j) {
-            const size_t label_offset = i * num_classes;
-            const float logit = labels_data[label_offset + j];
-            const float score = rfdetr::processing::sigmoid(logit);
-            all_scores.push_back(score);
-            all_indices.push_back(i * num_classes + j);
-        }
+    // Masks cover the whole model input; only the content box maps onto the original image.
+    const auto res_f = static_cast<float>(config_.resolution);
+    const rfdetr::media::SourceWindow mask_window{
+        static_cast<float>(static_cast<size_t>(transform.content_x) * mask_w) / res_f,
+        static_cast<float>(static_cast<size_t>(transform.content_y) * mask_h) / res_f,
+        static_cast<float>(static_cast<size_t>(transform.content_width) * mask_w) / res_f,
+        static_cast<float>(static_cast<size_t>(transform.content_height) * mask_h) / res_f};
+    const auto mask_w_i = static_cast<int>(mask_w);
+    const auto mask_h_i = static_cast<int>(mask_h);
+    if (mask_resampler_.use_count() > 1 &&
+        !mask_resampler_->matches(mask_w_i, mask_h_i, mask_window, transform.src_width, transform.src_height)) {
+        mask_resampler_ = std::make_shared<rfdetr::media::BilinearResampler>();
     }
+    mask_resampler_->configure(mask_w_i, mask_h_i, mask_window, transform.src_width, transform.src_height);
 
-    // Top-k selection
-    const size_t num_select = std::min(static_cast<size_t>(config_.max_detections), all_scores.size());
-    std::vector<size_t> topk_indices(all_scores.size());
-    std::iota(topk_indices.begin(), topk_indices.end(), 0);
-    std::partial_sort(topk_indices.begin(), topk_indices.begin() + static_cast<ptrdiff_t>(num_select),
-                      topk_indices.end(),
-                      [&all_scores](size_t i1, size_t i2) { return all_scores[i1] > all_scores[i2]; });
+    // Top-k (query, class) pairs above the threshold, selected in logit space in one pass; the flat
+    // index i * num_classes + j identifies the pair
+    const size_t num_scores = num_detections * num_classes;
+    topk_.reset(std::min(static_cast<size_t>(std::max(config_.max_detections, 0)), num_scores),
+                rfdetr::processing::logit(config_.threshold));
+    topk_.push(labels_data.first(num_scores));
 
     // Process top-k detections
-    for (size_t k = 0; k < num_select; ++k) {
-        const size_t idx = topk_indices[k];
-        const float score = all_scores[idx];
-
-        if (score <= config_.threshold) {
-            continue;
-        }
+    for (const auto &candidate : topk_.sorted()) {
+        const size_t idx = candidate.index;
+        const float score = rfdetr::processing::sigmoid(candidate.value);
 
-        const size_t detection_idx = all_indices[idx] / num_classes;
-        const size_t class_idx = all_indices[idx] % num_classes;
+        const size_t detection_idx = idx / num_classes;
+        const size_t class_idx = idx % num_classes;
         const int class_id = static_cast<int>(class_idx) - 1; // Fix the +1 offset
 
         if (class_id < 0 || static_cast<size_t>(class_id) >= coco_labels_.size()) {
@@ -242,21 +460,95 @@ void RFDETRInference::postprocess_segmentation_outputs(float scale_w, float scal
         const float h = dets_data[det_offset + 3] * res;
 
         auto xyxy = rfdetr::processing::cxcywh_to_xyxy(cx, cy, w, h);
-        auto scaled = rfdetr::processing::scale_box(xyxy, scale_w, scale_h);
-        auto clamped = rfdetr::processing::clamp_box(scaled, static_cast<float>(orig_w), static_cast<float>(orig_h));
-
-        BoundingBox box{clamped.x_min, clamped.y_min, clamped.x_max, clamped.y_max};
-
-        const size_t mask_offset = detection_idx * mask_h * mask_w;
-        auto binary_mask = rfdetr::media::resize_threshold_mask(
-            std::span<const float>(masks_data.data() + mask_offset, mask_h * mask_w), static_cast<int>(mask_w),
-            static_cast<int>(mask_h), orig_w, orig_h, config_.mask_threshold);
+        const BoundingBox box = rfdetr::processing::unmap_box(xyxy, transform);
+
+        // A compacted capture holds only the selected queries' planes, in query order
+        size_t mask_plane = detection_idx;
+        if (static_cast<size_t>(masks_shape[1]) != num_detections) {
+            const auto it = std::lower_bound(mask_queries_.begin(), mask_queries_.end(), detection_idx);
+            if (it == mask_queries_.end() || *it != detection_idx) {
+                throw std::runtime_error("Mask of query " + std::to_string(detection_idx) +
+                                         " was not captured; capture and postprocess with the same config");
+            }
+            mask_plane = static_cast<size_t>(it - mask_queries_.begin());
+        }
+        const size_t mask_offset = mask_plane * mask_h * mask_w;
+        emit_mask(masks_data.subspan(mask_offset, mask_h * mask_w), box);
 
         scores.push_back(score);
         class_ids.push_back(class_id);
-        boxes.push_back(std::move(box));
-        masks.push_back(binary_mask);
+        boxes.push_back(box);
+    }
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                                       std::vector<float> &scores, std::vector<int> &class_ids,
+                                                       std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::Mask> &masks) {
+    decode_segmentation(
+        batch_index, transform, scores, class_ids, boxes, [&](std::span<const float> logits, const BoundingBox &box) {
+            rfdetr::media::Mask binary_mask = take_pooled_mask();
+            mask_scratch_.resize(2 * static_cast<size_t>(mask_resampler_->dst_width()));
+            rfdetr::media::resize_threshold_mask(logits, *mask_resampler_, config_.mask_threshold, box, binary_mask,
+                                                 mask_scratch_);
+            masks.push_back(std::move(binary_mask));
+        });
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                                       std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::Mask> &masks,
+                                                       rfdetr::concurrency::ThreadPool &pool) {
+    postprocess_segmentation_outputs(0, transform, scores, class_ids, boxes, masks, pool);
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                                       std::vector<float> &scores, std::vector<int> &class_ids,
+                                                       std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::Mask> &masks,
+                                                       rfdetr::concurrency::ThreadPool &pool) {
+    // Decoding is cheap and sequential; collect the kept instances first, then upsample them as
+    // independent tasks. Instance i's box is boxes[first_box + i] and its mask masks[first_mask + i].
+    const size_t first_box = boxes.size();
+    pending_mask_logits_.clear();
+    decode_segmentation(batch_index, transform, scores, class_ids, boxes,
+                        [&](std::span<const float> logits, const BoundingBox &) {
+                            pending_mask_logits_.push_back(logits);
+                        });
+
+    const size_t count = pending_mask_logits_.size();
+    const size_t first_mask = masks.size();
+    for (size_t i = 0; i < count; ++i) {
+        masks.push_back(take_pooled_mask());
     }
+
+    // run() assigns task t to participant t % pool.size() and a participant runs its tasks one after
+    // another, so one row-scratch block per participant is enough
+    const size_t scratch_floats = 2 * static_cast<size_t>(mask_resampler_->dst_width());
+    mask_scratch_.resize(std::min(count, pool.size()) * scratch_floats);
+    const std::span<float> scratch(mask_scratch_);
+    const rfdetr::media::BilinearResampler &resampler = *mask_resampler_;
+    pool.run(count, [&](size_t i) {
+        rfdetr::media::resize_threshold_mask(pending_mask_logits_[i], resampler, config_.mask_threshold,
+                                             boxes[first_box + i], masks[first_mask + i],
+                                             scratch.subspan((i % pool.size()) * scratch_floats, scratch_floats));
+    });
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                                       std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::LazyMask> &masks) {
+    postprocess_segmentation_outputs(0, transform, scores, class_ids, boxes, masks);
+}
+
+void RFDETRInference::postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                                       std::vector<float> &scores, std::vector<int> &class_ids,
+                                                       std::vector<BoundingBox> &boxes,
+                                                       std::vector<rfdetr::media::LazyMask> &masks) {
+    decode_segmentation(batch_index, transform, scores, class_ids, boxes,
+                        [&](std::span<const float> logits, const BoundingBox &box) {
+                            masks.emplace_back(logits, mask_resampler_, box, config_.mask_threshold);
+                        });
 }
 
 void RFDETRInference::draw_detections(rfdetr::media::Image &image, std::span<const BoundingBox> boxes,
@@ -290,19 +582,33 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
                                                    std::vector<float> &scores, std::vector<int> &class_ids,
                                                    std::vector<BoundingBox> &boxes,
                                                    std::vector<std::vector<KeypointResult>> &keypoints) {
-    if (output_data_cache_.size() < 3) {
+    postprocess_keypoint_outputs(stretch_transform(scale_w, scale_h, orig_w, orig_h, config_.resolution), scores,
+                                 class_ids, boxes, keypoints);
+}
+
+void RFDETRInference::postprocess_keypoint_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                                   std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                                   std::vector<std::vector<KeypointResult>> &keypoints) {
+    postprocess_keypoint_outputs(0, transform, scores, class_ids, boxes, keypoints);
+}
+
+void RFDETRInference::postprocess_keypoint_outputs(size_t batch_index, const InputTransform &transform,
+                                                   std::vector<float> &scores, std::vector<int> &class_ids,
+                                                   std::vector<BoundingBox> &boxes,
+                                                   std::vector<std::vector<KeypointResult>> &keypoints) {
+    if (output_views_.size() < 3) {
         throw std::runtime_error("Expected at least 3 output tensors for keypoint, got " +
-                                 std::to_string(output_data_cache_.size()));
+                                 std::to_string(output_views_.size()));
     }
 
-    const auto &dets_data = output_data_cache_[0];
-    const auto &dets_shape = output_shapes_cache_[0];
+    const auto dets_data = output_item(0, batch_index);
+    const auto dets_shape = output_shapes_[0];
 
-    const auto &labels_data = output_data_cache_[1];
-    const auto &labels_shape = output_shapes_cache_[1];
+    const auto labels_data = output_item(1, batch_index);
+    const auto labels_shape = output_shapes_[1];
 
-    const auto &kp_data = output_data_cache_[2];
-    const auto &kp_shape = output_shapes_cache_[2];
+    const auto kp_data = output_item(2, batch_index);
+    const auto kp_shape = output_shapes_[2];
 
     const auto num_queries = static_cast<size_t>(dets_shape[1]);
     const auto num_classes = static_cast<size_t>(labels_shape[2]);
@@ -331,13 +637,11 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
     const size_t kp_stride =
         (num_kp_classes > 0) ? (num_keypoints / num_kp_classes) * kp_channels : num_keypoints * kp_channels;
     // Map: keypoint_class_index -> (num_kps, byte_offset_in_tensor)
-    std::vector<std::pair<size_t, size_t>> kp_map;
-    if (!kp_counts.empty()) {
-        kp_map.reserve(kp_counts.size());
-        for (size_t c = 0; c < kp_counts.size(); ++c) {
-            const auto count = static_cast<size_t>(kp_counts[c] >= 0 ? kp_counts[c] : 0);
-            kp_map.emplace_back(count, c * kp_stride);
-        }
+    auto &kp_map = kp_map_;
+    kp_map.clear();
+    for (size_t c = 0; c < kp_counts.size(); ++c) {
+        const auto count = static_cast<size_t>(kp_counts[c] >= 0 ? kp_counts[c] : 0);
+        kp_map.emplace_back(count, c * kp_stride);
     }
     // Validate keypoint tensor shape: total channels must be divisible by num_kp_classes
     if (num_kp_classes > 0 && num_keypoints % num_kp_classes != 0) {
@@ -357,28 +661,30 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
     }
 
     const float res = static_cast<float>(config_.resolution);
+    // Keypoints are normalized to the model input: shift out the padding, then scale the content
+    // box to original pixels (exactly orig_w/orig_h per unit when stretching).
+    const float kp_offset_x = static_cast<float>(transform.content_x) / res;
+    const float kp_offset_y = static_cast<float>(transform.content_y) / res;
+    const float kp_scale_x = static_cast<float>(config_.resolution * transform.src_width) /
+                             static_cast<float>(transform.content_width);
+    const float kp_scale_y = static_cast<float>(config_.resolution * transform.src_height) /
+                             static_cast<float>(transform.content_height);
+
+    argmax_queries(labels_data, num_queries, num_classes);
+    const float logit_threshold = rfdetr::processing::logit(config_.threshold);
 
     for (size_t q = 0; q < num_queries; ++q) {
         const size_t det_offset = q * static_cast<size_t>(dets_shape[2]);
-        const size_t label_offset = q * num_classes;
 
         // RF-DETR keypoint labels use the same offset as detection: logit 0 is background,
         // logit 1 is the first real class (COCO person for the preview model).
-        float best_score = -1.0f;
-        int best_class_idx = -1;
-        for (size_t j = 0; j < num_classes; ++j) {
-            const float logit = labels_data[label_offset + j];
-            const float score = rfdetr::processing::sigmoid(logit);
-            if (score > best_score) {
-                best_score = score;
-                best_class_idx = static_cast<int>(j);
-            }
-        }
-
+        const int best_class_idx = query_max_classes_[q];
         const int class_id = best_class_idx - 1;
-        if (best_score <= config_.threshold || class_id < 0 || static_cast<size_t>(class_id) >= coco_labels_.size()) {
+        if (query_max_logits_[q] <= logit_threshold || class_id < 0 ||
+            static_cast<size_t>(class_id) >= coco_labels_.size()) {
             continue;
         }
+        const float best_score = rfdetr::processing::sigmoid(query_max_logits_[q]);
 
         // Decode bbox
         const float cx = dets_data[det_offset + 0] * res;
@@ -387,12 +693,14 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
         const float h = dets_data[det_offset + 3] * res;
 
         auto xyxy = rfdetr::processing::cxcywh_to_xyxy(cx, cy, w, h);
-        auto scaled = rfdetr::processing::scale_box(xyxy, scale_w, scale_h);
-        auto clamped = rfdetr::processing::clamp_box(scaled, static_cast<float>(orig_w), static_cast<float>(orig_h));
-
-        BoundingBox box{clamped.x_min, clamped.y_min, clamped.x_max, clamped.y_max};
+        BoundingBox box = rfdetr::processing::unmap_box(xyxy, transform);
 
         std::vector<KeypointResult> kp_results;
+        if (!keypoint_pool_.empty()) {
+            kp_results = std::move(keypoint_pool_.back());
+            keypoint_pool_.pop_back();
+            kp_results.clear();
+        }
         size_t selected_kp_class = default_kp_class;
         if (best_class_idx >= 0 && static_cast<size_t>(best_class_idx) < kp_map.size() &&
             kp_map[static_cast<size_t>(best_class_idx)].first > 0) {
@@ -419,9 +727,9 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
 
             KeypointResult kpr{};
 
-            // RF-DETR keypoints are normalized image-relative coordinates.
-            kpr.x = kp_data[base + ch_off + 0] * static_cast<float>(orig_w);
-            kpr.y = kp_data[base + ch_off + 1] * static_cast<float>(orig_h);
+            // RF-DETR keypoints are normalized model-input coordinates.
+            kpr.x = (kp_data[base + ch_off + 0] - kp_offset_x) * kp_scale_x;
+            kpr.y = (kp_data[base + ch_off + 1] - kp_offset_y) * kp_scale_y;
 
             // Step e-f: Sigmoid findability and visibility
             kpr.findability = rfdetr::processing::sigmoid(kp_data[base + ch_off + 2]);
@@ -452,8 +760,8 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
                 float inv_p11 = p00 / det;
 
                 // Pixel-space covariance: diag(width, height) * cov * diag(width, height).
-                const float width = static_cast<float>(orig_w);
-                const float height = static_cast<float>(orig_h);
+                const float width = kp_scale_x;
+                const float height = kp_scale_y;
                 kpr.cov[0] = inv_p00 * width * width;
                 kpr.cov[1] = inv_p01 * width * height;
                 kpr.cov[2] = inv_p01 * width * height; // symmetric
@@ -485,6 +793,27 @@ void RFDETRInference::postprocess_keypoint_outputs(float scale_w, float scale_h,
     }
 }
 
+rfdetr::media::Mask RFDETRInference::take_pooled_mask() {
+    if (mask_pool_.empty()) {
+        return {};
+    }
+    rfdetr::media::Mask mask = std::move(mask_pool_.back());
+    mask_pool_.pop_back();
+    return mask;
+}
+
+void RFDETRInference::recycle_results(std::vector<rfdetr::media::Mask> &results) {
+    // Reversed so take_pooled_mask() hands instance i the buffer instance i had last frame, which
+    // already fits it when the scene changes little
+    std::move(results.rbegin(), results.rend(), std::back_inserter(mask_pool_));
+    results.clear();
+}
+
+void RFDETRInference::recycle_results(std::vector<std::vector<KeypointResult>> &results) {
+    std::move(results.begin(), results.end(), std::back_inserter(keypoint_pool_));
+    results.clear();
+}
+
 void RFDETRInference::draw_keypoints(rfdetr::media::Image &image, std::span<const BoundingBox> boxes,
                                      std::span<const int> class_ids, std::span<const float> scores,
                                      std::span<const std::vector<KeypointResult>> keypoints) {
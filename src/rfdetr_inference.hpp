@@ -1,6 +1,7 @@
 #pragma once
 #include "backends/inference_backend.hpp"
 #include "media.hpp"
+#include "postprocess_kernels.hpp"
 
 #include <filesystem>
 #include <memory>
@@ -12,6 +13,7 @@
 // Bring backend namespace into scope for convenience
 using rfdetr::backend::create_backend;
 using rfdetr::backend::InferenceBackend;
+using rfdetr::backend::InputFormat;
 
 enum class ModelType { DETECTION, SEGMENTATION, KEYPOINT };
 
@@ -20,6 +22,7 @@ struct Config {
     float threshold{0.5f};
     std::array<float, 3> means{0.485f, 0.456f, 0.406f};
     std::array<float, 3> stds{0.229f, 0.224f, 0.225f};
+    ResizeMode resize_mode{ResizeMode::STRETCH}; ///< LETTERBOX preserves the aspect ratio by padding
     ModelType model_type{ModelType::DETECTION};
     int max_detections{300};
     float mask_threshold{0.0f};
@@ -39,6 +42,17 @@ struct Config {
     rfdetr::media::Color keypoint_color{0, 255, 0}; ///< Default keypoint color (green)
 };
 
+/// Owned copy of one inference run's output tensors (see RFDETRInference::capture_outputs()), so
+/// one thread can postprocess frame N while another runs the backend on frame N+1.
+struct InferenceOutputs {
+    std::vector<std::vector<float>> tensors;
+    std::vector<std::vector<int64_t>> shapes;
+    size_t batch_size{0};
+    /// Queries (ascending) whose mask planes a segmentation capture kept, in tensor order; empty
+    /// when the mask tensor holds every query's plane
+    std::vector<size_t> mask_queries;
+};
+
 class RFDETRInference {
   public:
     RFDETRInference(const std::filesystem::path &model_path, const std::filesystem::path &label_file_path,
@@ -50,24 +64,99 @@ class RFDETRInference {
 
     ~RFDETRInference() = default;
 
+    // Postprocess-only instance with no backend or model: it postprocesses outputs handed to
+    // load_outputs() (typically captured by another instance on another thread); run_inference() throws
+    [[nodiscard]] static RFDETRInference postprocessor(const std::filesystem::path &label_file_path,
+                                                       const Config &config);
+
     // Preprocess the input image (from file path)
     std::vector<float> preprocess_image(const std::filesystem::path &image_path, int &orig_h, int &orig_w);
 
     // Preprocess the input image (from an in-memory BGR image, avoids disk I/O for video frames)
     std::vector<float> preprocess_image(const rfdetr::media::Image &bgr_image, int &orig_h, int &orig_w);
 
-    // Run inference
+    // uint8 NHWC variant for models exported with normalization in the graph (see get_input_format())
+    std::vector<uint8_t> preprocess_image_u8(const rfdetr::media::Image &bgr_image, int &orig_h, int &orig_w);
+
+    // Preprocess N images into one contiguous batch tensor (image i at offset i * 3 * res * res);
+    // map results back with make_input_transform(images[i].width, images[i].height)
+    std::vector<float> preprocess_batch(std::span<const rfdetr::media::Image> bgr_images);
+    std::vector<uint8_t> preprocess_batch_u8(std::span<const rfdetr::media::Image> bgr_images);
+
+    // Placement of an orig_w x orig_h image in the model input under config.resize_mode; pass it to
+    // the postprocess overloads below to map results back to the original image
+    [[nodiscard]] InputTransform make_input_transform(int orig_w, int orig_h) const;
+
+    // Run inference on one image or a batch of N concatenated images (the batch size is
+    // input_data.size() / (3 * res * res)); the overload must match get_input_format()
     void run_inference(std::span<const float> input_data);
+    void run_inference(std::span<const uint8_t> input_data);
 
-    // Post-process the inference outputs for detection
+    // Copy the last run's outputs into `outputs`, reusing its buffers (no allocation once sized)
+    void capture_outputs(InferenceOutputs &outputs) const;
+
+    // As above for batch item `batch_index` only, as a batch of one (scatters a batched run's
+    // results to per-image buffers). Segmentation models keep only the mask planes of queries the
+    // postprocess can select under this config (see InferenceOutputs::mask_queries), so a
+    // postprocessor reading it must share threshold and max_detections.
+    void capture_outputs(InferenceOutputs &outputs, size_t batch_index);
+
+    // Make the postprocess calls read `outputs` (in place, so keep it alive and unchanged) until
+    // the next run_inference() or load_outputs()
+    void load_outputs(const InferenceOutputs &outputs);
+
+    // Number of images in the last run_inference() batch
+    [[nodiscard]] size_t get_batch_size() const noexcept { return batch_size_; }
+
+    // Post-process the inference outputs for detection (batch item 0)
+    void postprocess_outputs(const InputTransform &transform, std::vector<float> &scores, std::vector<int> &class_ids,
+                             std::vector<BoundingBox> &boxes);
+
+    // Post-process batch item `batch_index` of the last run; `transform` is that image's placement
+    void postprocess_outputs(size_t batch_index, const InputTransform &transform, std::vector<float> &scores,
+                             std::vector<int> &class_ids, std::vector<BoundingBox> &boxes);
+
+    // Stretch-only variant: scale_w/scale_h are original pixels per model-input pixel
     void postprocess_outputs(float scale_w, float scale_h, std::vector<float> &scores, std::vector<int> &class_ids,
                              std::vector<BoundingBox> &boxes);
 
-    // Post-process the inference outputs for segmentation
+    // Post-process the inference outputs for segmentation; each mask covers its instance's box in the
+    // original image (see rfdetr::media::Mask), with letterbox padding removed
+    void postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                          std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                          std::vector<rfdetr::media::Mask> &masks);
+
+    void postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                          std::vector<float> &scores, std::vector<int> &class_ids,
+                                          std::vector<BoundingBox> &boxes, std::vector<rfdetr::media::Mask> &masks);
+
     void postprocess_segmentation_outputs(float scale_w, float scale_h, int orig_h, int orig_w,
                                           std::vector<float> &scores, std::vector<int> &class_ids,
                                           std::vector<BoundingBox> &boxes, std::vector<rfdetr::media::Mask> &masks);
 
+    // As above, upsampling the kept instances' masks in parallel on `pool`, one task per instance.
+    // Masks keep the serial overloads' order and are bit-identical to theirs.
+    void postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                          std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                          std::vector<rfdetr::media::Mask> &masks,
+                                          rfdetr::concurrency::ThreadPool &pool);
+
+    void postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                          std::vector<float> &scores, std::vector<int> &class_ids,
+                                          std::vector<BoundingBox> &boxes, std::vector<rfdetr::media::Mask> &masks,
+                                          rfdetr::concurrency::ThreadPool &pool);
+
+    // As above, deferring mask upsampling: each LazyMask upsamples on its first get(), so frames
+    // whose masks are never requested skip that work (handles read the output tensor; see LazyMask)
+    void postprocess_segmentation_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                          std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                          std::vector<rfdetr::media::LazyMask> &masks);
+
+    void postprocess_segmentation_outputs(size_t batch_index, const InputTransform &transform,
+                                          std::vector<float> &scores, std::vector<int> &class_ids,
+                                          std::vector<BoundingBox> &boxes,
+                                          std::vector<rfdetr::media::LazyMask> &masks);
+
     // Draw detections on the image
     void draw_detections(rfdetr::media::Image &image, std::span<const BoundingBox> boxes,
                          std::span<const int> class_ids, std::span<const float> scores);
@@ -78,6 +167,14 @@ class RFDETRInference {
                                  std::span<const rfdetr::media::Mask> masks);
 
     // Post-process inference outputs for keypoint detection
+    void postprocess_keypoint_outputs(const InputTransform &transform, std::vector<float> &scores,
+                                      std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                      std::vector<std::vector<KeypointResult>> &keypoints);
+
+    void postprocess_keypoint_outputs(size_t batch_index, const InputTransform &transform, std::vector<float> &scores,
+                                      std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
+                                      std::vector<std::vector<KeypointResult>> &keypoints);
+
     void postprocess_keypoint_outputs(float scale_w, float scale_h, int orig_h, int orig_w, std::vector<float> &scores,
                                       std::vector<int> &class_ids, std::vector<BoundingBox> &boxes,
                                       std::vector<std::vector<KeypointResult>> &keypoints);
@@ -86,6 +183,11 @@ class RFDETRInference {
     void draw_keypoints(rfdetr::media::Image &image, std::span<const BoundingBox> boxes, std::span<const int> class_ids,
                         std::span<const float> scores, std::span<const std::vector<KeypointResult>> keypoints);
 
+    // Hand a finished frame's masks / keypoint lists back for reuse by later postprocess calls, so
+    // their buffers are not reallocated every frame; `results` is left empty
+    void recycle_results(std::vector<rfdetr::media::Mask> &results);
+    void recycle_results(std::vector<std::vector<KeypointResult>> &results);
+
     // Save the output image
     std::optional<std::filesystem::path> save_output_image(const rfdetr::media::Image &image,
                                                            const std::filesystem::path &output_path);
@@ -93,23 +195,76 @@ class RFDETRInference {
     // Getters for testing
     [[nodiscard]] const std::vector<std::string> &get_coco_labels() const noexcept { return coco_labels_; }
     [[nodiscard]] int get_resolution() const noexcept { return config_.resolution; }
+    [[nodiscard]] InputFormat get_input_format() const noexcept { return input_format_; }
 
     // Get label name by class index (with bounds check)
     [[nodiscard]] std::string get_label_name(int class_id) const;
 
   private:
+    struct PostprocessOnly {};
+    RFDETRInference(PostprocessOnly, const std::filesystem::path &label_file_path, const Config &config);
+
     // Load COCO labels from file
     void load_coco_labels(const std::filesystem::path &label_file_path);
 
-    // Inference backend (Strategy Pattern)
+    // Throws for postprocessor() instances
+    void require_backend() const;
+
+    // Set input_shape_'s batch dimension for `elements` input values; throws unless it is a
+    // positive multiple of one image
+    void set_batch_size(size_t elements);
+
+    // Refresh output_views_/output_shapes_ from the backend after a run
+    void cache_outputs();
+
+    // Batch item `batch_index` of output `output_index` (all dimensions after the first)
+    [[nodiscard]] std::span<const float> output_item(size_t output_index, size_t batch_index) const;
+
+    // Decode batch item `batch_index`'s segmentation instances into scores/class_ids/boxes, calling
+    // emit_mask(logits, box) with each kept instance's low-resolution mask logits once
+    // mask_resampler_ maps them onto the original image
+    template <typename EmitMask>
+    void decode_segmentation(size_t batch_index, const InputTransform &transform, std::vector<float> &scores,
+                             std::vector<int> &class_ids, std::vector<BoundingBox> &boxes, EmitMask &&emit_mask);
+
+    // A mask from mask_pool_, or an empty one when the pool is dry
+    [[nodiscard]] rfdetr::media::Mask take_pooled_mask();
+
+    // Best class logit and index of each query (rows of `labels`) into query_max_logits_/_classes_
+    void argmax_queries(std::span<const float> labels, size_t num_queries, size_t num_classes);
+
+    // Inference backend (Strategy Pattern); null for postprocessor() instances
     std::unique_ptr<InferenceBackend> backend_;
 
     // Model parameters
     std::vector<std::string> coco_labels_;
     Config config_;
     std::vector<int64_t> input_shape_;
+    InputFormat input_format_{InputFormat::FLOAT32_NCHW};
+    size_t batch_size_{0};
+
+    // Views of the last run's outputs in backend-owned memory (valid until the next run), or of the
+    // InferenceOutputs passed to load_outputs(), + shapes
+    std::vector<std::span<const float>> output_views_;
+    std::vector<std::span<const int64_t>> output_shapes_;
+    // Query of each mask plane when load_outputs() got a compacted capture, else empty
+    std::span<const size_t> mask_queries_;
+
+    // Bilinear tables reused while the input frame size (and hence mask output size) stays fixed
+    rfdetr::media::BilinearResampler preprocess_resampler_;
+    // Shared with LazyMask handles; replaced rather than reconfigured while a handle still uses it
+    std::shared_ptr<rfdetr::media::BilinearResampler> mask_resampler_{
+        std::make_shared<rfdetr::media::BilinearResampler>()};
+
+    // Postprocess scratch, kept across frames so the steady state does not allocate
+    std::vector<float> query_max_logits_;
+    std::vector<int32_t> query_max_classes_;
+    rfdetr::processing::TopKSelector topk_;
+    std::vector<float> mask_scratch_;
+    std::vector<std::span<const float>> pending_mask_logits_; // kept instances awaiting parallel upsampling
+    std::vector<std::pair<size_t, size_t>> kp_map_;
 
-    // Output tensor cache
-    std::vector<std::vector<float>> output_data_cache_;
-    std::vector<std::vector<int64_t>> output_shapes_cache_;
+    // Results handed back through recycle_results(), reused by the next postprocess call
+    std::vector<rfdetr::media::Mask> mask_pool_;
+    std::vector<std::vector<KeypointResult>> keypoint_pool_;
 };
@@ -8,6 +8,28 @@ struct BoundingBox {
     float y_max;
 };
 
+/// How an input image is fitted into the square model input.
+enum class ResizeMode {
+    STRETCH,   ///< Resize each axis to the model resolution independently (distorts the aspect ratio)
+    LETTERBOX, ///< Scale uniformly to fit, center, and pad the remainder
+};
+
+/// Where a source image was placed inside the model input, for mapping model-space outputs back.
+///
+/// The resized image covers model pixels [content_x, content_x + content_width) x
+/// [content_y, content_y + content_height); anything outside is padding. Model pixel coordinate m
+/// maps to source coordinate (m - content_x) * scale_x (likewise for y).
+struct InputTransform {
+    int src_width{0};
+    int src_height{0};
+    int content_x{0};
+    int content_y{0};
+    int content_width{0};
+    int content_height{0};
+    float scale_x{1.0f}; ///< Source pixels per model-input pixel along x
+    float scale_y{1.0f}; ///< Source pixels per model-input pixel along y
+};
+
 /// A single detected keypoint with associated metadata.
 struct KeypointResult {
     float x;           ///< Pixel x-coordinate
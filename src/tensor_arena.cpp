@@ -0,0 +1,78 @@
+#include "tensor_arena.hpp"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace rfdetr::memory {
+
+namespace {
+
+#ifdef __linux__
+constexpr size_t kHugePageSize = size_t{2} << 20;
+#endif
+
+} // anonymous namespace
+
+TensorArena::TensorArena(size_t bytes, bool huge_pages) : size_(bytes) {
+    if (bytes == 0) {
+        return;
+    }
+#ifdef __linux__
+    if (huge_pages) {
+        // Anonymous mappings are page-aligned and zero-filled; rounding up to whole huge pages lets
+        // the kernel back all of it with them
+        const size_t mapped_bytes = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        void *block = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block != MAP_FAILED) {
+            data_ = block;
+            size_ = mapped_bytes;
+            mapped_ = true;
+            huge_pages_ = madvise(block, mapped_bytes, MADV_HUGEPAGE) == 0;
+            return;
+        }
+    }
+#else
+    (void)huge_pages;
+#endif
+    data_ = ::operator new(bytes, std::align_val_t{kAlignment});
+    std::memset(data_, 0, bytes);
+}
+
+TensorArena::~TensorArena() { release(); }
+
+TensorArena::TensorArena(TensorArena &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, false)), huge_pages_(std::exchange(other.huge_pages_, false)) {}
+
+TensorArena &TensorArena::operator=(TensorArena &&other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_ = std::exchange(other.mapped_, false);
+        huge_pages_ = std::exchange(other.huge_pages_, false);
+    }
+    return *this;
+}
+
+void TensorArena::release() noexcept {
+    if (data_ == nullptr) {
+        return;
+    }
+#ifdef __linux__
+    if (mapped_) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        return;
+    }
+#endif
+    ::operator delete(data_, std::align_val_t{kAlignment});
+    data_ = nullptr;
+}
+
+} // namespace rfdetr::memory
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+namespace rfdetr::memory {
+
+/// One contiguous, zero-initialized block of memory aligned to (at least) a cache line, for
+/// tensors that should sit back to back: e.g. the input tensors of every frame-ring slot, so a run
+/// of consecutive slots is already a valid batch tensor.
+///
+/// With `huge_pages`, the block is requested from the OS directly and marked for transparent huge
+/// pages (Linux), which cuts TLB misses when the arena spans many megabytes; elsewhere, or if the
+/// kernel declines, it is still a regular aligned block.
+class TensorArena {
+  public:
+    static constexpr size_t kAlignment = 64;
+
+    TensorArena() = default;
+    explicit TensorArena(size_t bytes, bool huge_pages = false);
+    ~TensorArena();
+
+    TensorArena(const TensorArena &) = delete;
+    TensorArena &operator=(const TensorArena &) = delete;
+    TensorArena(TensorArena &&other) noexcept;
+    TensorArena &operator=(TensorArena &&other) noexcept;
+
+    /// Usable bytes; at least the requested size (huge-page arenas round up to whole pages)
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool huge_pages() const noexcept { return huge_pages_; }
+
+    /// `count` elements of type T starting `offset` elements into the arena (T must be a
+    /// trivially constructible arithmetic type; the range must fit)
+    template <typename T> [[nodiscard]] std::span<T> view(size_t offset, size_t count) const noexcept {
+        return {static_cast<T *>(data_) + offset, count};
+    }
+
+  private:
+    void release() noexcept;
+
+    void *data_{nullptr};
+    size_t size_{0};
+    bool mapped_{false};     // data_ came from mmap rather than aligned operator new
+    bool huge_pages_{false}; // the kernel accepted the huge-page advice
+};
+
+} // namespace rfdetr::memory
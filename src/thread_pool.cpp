@@ -0,0 +1,96 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace rfdetr::concurrency {
+
+ThreadPool::ThreadPool(size_t participants) {
+    if (participants == 0) {
+        participants = std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(participants - 1);
+    for (size_t p = 1; p < participants; ++p) {
+        workers_.emplace_back([this, p] { worker_loop(p); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    workers_.clear(); // joins
+}
+
+void ThreadPool::run_impl(size_t num_tasks, TaskFn fn, void *ctx) {
+    if (num_tasks == 0) {
+        return;
+    }
+    std::lock_guard run_lock(run_mutex_);
+
+    if (workers_.empty() || num_tasks == 1) {
+        for (size_t t = 0; t < num_tasks; ++t) {
+            fn(ctx, t);
+        }
+        return;
+    }
+
+    first_error_ = nullptr;
+
+    {
+        std::lock_guard lock(mutex_);
+        task_fn_ = fn;
+        task_ctx_ = ctx;
+        num_tasks_ = num_tasks;
+        workers_remaining_.store(workers_.size(), std::memory_order_relaxed);
+        ++generation_;
+    }
+    work_cv_.notify_all();
+
+    execute(0);
+
+    {
+        std::unique_lock lock(mutex_);
+        done_cv_.wait(lock, [this] { return workers_remaining_.load(std::memory_order_acquire) == 0; });
+    }
+    if (first_error_) {
+        std::rethrow_exception(first_error_);
+    }
+}
+
+void ThreadPool::worker_loop(size_t participant) {
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            work_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        execute(participant);
+
+        if (workers_remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(mutex_);
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::execute(size_t participant) noexcept {
+    for (size_t t = participant; t < num_tasks_; t += size()) {
+        try {
+            task_fn_(task_ctx_, t);
+        } catch (...) {
+            std::lock_guard lock(error_mutex_);
+            if (!first_error_) {
+                first_error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+} // namespace rfdetr::concurrency
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rfdetr::concurrency {
+
+/// Fixed-size fork/join pool for data-parallel kernels (row-split preprocessing, per-instance mask
+/// upsampling, ...).
+///
+/// run() hands out tasks statically — participant p executes tasks p, p + size(), p + 2*size(), ...
+/// with the calling thread acting as participant 0 — so the task-to-thread mapping is reproducible
+/// and a call allocates nothing: the callable is passed by reference and never type-erased into a
+/// heap object. Concurrent run() calls from different threads are serialized.
+class ThreadPool {
+  public:
+    /// `participants` counts the calling thread, so ThreadPool(1) spawns no threads and runs every
+    /// task inline. 0 selects std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t participants);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    /// Number of threads that execute tasks, including the caller of run().
+    [[nodiscard]] size_t size() const noexcept { return workers_.size() + 1; }
+
+    /// Invoke `fn(task_index)` for every index in [0, num_tasks) and block until all have finished.
+    /// The first exception thrown by any task is rethrown here after the others complete.
+    template <typename Fn> void run(size_t num_tasks, Fn &&fn) {
+        using FnType = std::remove_reference_t<Fn>;
+        run_impl(
+            num_tasks, [](void *ctx, size_t task) { (*static_cast<FnType *>(ctx))(task); },
+            const_cast<void *>(static_cast<const void *>(&fn)));
+    }
+
+  private:
+    using TaskFn = void (*)(void *ctx, size_t task);
+
+    void run_impl(size_t num_tasks, TaskFn fn, void *ctx);
+    void worker_loop(size_t participant);
+    void execute(size_t participant) noexcept;
+
+    std::vector<std::jthread> workers_;
+
+    std::mutex run_mutex_; // serializes callers of run()
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_{0};
+    bool stopping_{false};
+
+    // Current job; written under mutex_ before generation_ is bumped.
+    TaskFn task_fn_{nullptr};
+    void *task_ctx_{nullptr};
+    size_t num_tasks_{0};
+    std::atomic<size_t> workers_remaining_{0};
+    std::exception_ptr first_error_;
+    std::mutex error_mutex_;
+};
+
+/// Split [0, total) into `parts` contiguous, near-equal ranges and return range `index`.
+[[nodiscard]] constexpr std::pair<size_t, size_t> split_range(size_t total, size_t parts, size_t index) noexcept {
+    return {total * index / parts, total * (index + 1) / parts};
+}
+
+} // namespace rfdetr::concurrency
@@ -0,0 +1,80 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace rfdetr::profiling {
+
+namespace {
+
+constexpr size_t kInitialEventsPerThread = 4096;
+
+// JSON string body; thread names come from code, so only quotes and backslashes need escaping
+std::string escape_json(const std::string &text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string format_us(TraceClock::duration duration) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << std::chrono::duration<double, std::micro>(duration).count();
+    return out.str();
+}
+
+} // anonymous namespace
+
+TraceBuffer::TraceBuffer(std::string thread_name, uint32_t thread_id)
+    : thread_name_(std::move(thread_name)), thread_id_(thread_id) {
+    events_.reserve(kInitialEventsPerThread);
+}
+
+Tracer::Tracer() : epoch_(TraceClock::now()) {}
+
+TraceBuffer &Tracer::thread_buffer(const std::string &name) {
+    std::lock_guard lock(mutex_);
+    const auto same_name = std::count_if(buffers_.begin(), buffers_.end(), [&](const TraceBuffer &buffer) {
+        return buffer.thread_name().starts_with(name + "-");
+    });
+    return buffers_.emplace_back(name + "-" + std::to_string(same_name), static_cast<uint32_t>(buffers_.size() + 1));
+}
+
+void Tracer::write_json(std::ostream &out) const {
+    std::lock_guard lock(mutex_);
+    out << "{\"traceEvents\": [\n";
+    bool first = true;
+    const auto separator = [&] {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+    for (const TraceBuffer &buffer : buffers_) {
+        separator();
+        out << R"({"name": "thread_name", "ph": "M", "pid": 1, "tid": )" << buffer.thread_id()
+            << R"(, "args": {"name": ")" << escape_json(buffer.thread_name()) << "\"}}";
+        for (const TraceEvent &event : buffer.events()) {
+            separator();
+            out << "{\"name\": \"" << event.name << R"(", "cat": "pipeline", "ph": "X", "pid": 1, "tid": )"
+                << buffer.thread_id() << ", \"ts\": " << format_us(event.begin - epoch_)
+                << ", \"dur\": " << format_us(event.end - event.begin);
+            if (event.frame >= 0) {
+                out << ", \"args\": {\"frame\": " << event.frame;
+                if (event.batch > 1) {
+                    out << ", \"batch\": " << event.batch;
+                }
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+} // namespace rfdetr::profiling
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rfdetr::profiling {
+
+using TraceClock = std::chrono::steady_clock;
+
+/// One complete span ("ph": "X" in the Chrome trace-event format).
+struct TraceEvent {
+    const char *name;  // string literal: stage names are fixed
+    TraceClock::time_point begin;
+    TraceClock::time_point end;
+    int64_t frame;     // -1 = not tied to a frame
+    uint32_t batch;    // frames covered by the span (micro-batched inference); `frame` is the first
+};
+
+/// Events of a single thread. Only the owning thread appends, so recording takes no lock and no
+/// atomic; the buffer is read once that thread has been joined.
+class TraceBuffer {
+  public:
+    TraceBuffer(std::string thread_name, uint32_t thread_id);
+
+    void complete(const char *name, TraceClock::time_point begin, TraceClock::time_point end, int64_t frame = -1,
+                  uint32_t batch = 1) {
+        events_.push_back({name, begin, end, frame, batch});
+    }
+
+    [[nodiscard]] const std::string &thread_name() const noexcept { return thread_name_; }
+    [[nodiscard]] uint32_t thread_id() const noexcept { return thread_id_; }
+    [[nodiscard]] const std::vector<TraceEvent> &events() const noexcept { return events_; }
+
+  private:
+    std::string thread_name_;
+    uint32_t thread_id_;
+    std::vector<TraceEvent> events_;
+};
+
+/// Opt-in span recorder that writes Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev),
+/// one track per thread, so stage overlap and pipeline bubbles can be inspected visually.
+///
+/// Each thread registers once with thread_buffer() and records into the returned buffer; write_json()
+/// must only be called after every recording thread has finished (e.g. been joined).
+class Tracer {
+  public:
+    Tracer();
+
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    /// A new buffer for the calling thread, shown as "<name>-<n>" (n counts threads of that name).
+    /// The reference stays valid for the tracer's lifetime.
+    TraceBuffer &thread_buffer(const std::string &name);
+
+    /// {"traceEvents": [...], "displayTimeUnit": "ms"}; timestamps are microseconds since the tracer
+    /// was created.
+    void write_json(std::ostream &out) const;
+
+  private:
+    TraceClock::time_point epoch_;
+    mutable std::mutex mutex_;
+    std::deque<TraceBuffer> buffers_; // deque: registering a thread never moves another's buffer
+};
+
+} // namespace rfdetr::profiling
@@ -1,12 +1,19 @@
 #include "video_pipeline.hpp"
 
 #include "display.hpp"
+#include "processing_utils.hpp"
 #include "video_reader.hpp"
 #include "video_writer.hpp"
 
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 
@@ -30,9 +37,13 @@ void load_labels(const std::filesystem::path &path, std::vector<std::string> &la
     }
 }
 
-std::string make_label(const std::vector<std::string> &labels, int class_id, float score) {
+std::string class_name(const std::vector<std::string> &labels, int class_id) {
     const auto idx = static_cast<size_t>(class_id);
-    std::string name = (idx < labels.size()) ? labels[idx] : std::string("cls") + std::to_string(class_id);
+    return (idx < labels.size()) ? labels[idx] : std::string("cls") + std::to_string(class_id);
+}
+
+std::string make_label(const std::vector<std::string> &labels, int class_id, float score) {
+    std::string name = class_name(labels, class_id);
     name += ": ";
     // Keep 4 chars of the score like the previous implementation ("0.50").
     const std::string s = std::to_string(score);
@@ -67,24 +78,162 @@ void draw_segmentation_on_frame(rfdetr::media::Image &image, std::span<const Bou
     }
 }
 
+/// Called by each worker of a stage as it exits. The last one sends end-of-stream to every worker
+/// of the next stage: all of the stage's frames were pushed before, so they drain first.
+void finish_worker(std::atomic<size_t> &running, BoundedQueue<size_t> &downstream, size_t downstream_workers) {
+    if (running.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        for (size_t i = 0; i < downstream_workers; ++i) {
+            downstream.push(kPoisonPill);
+        }
+    }
+}
+
+void launch_workers(std::vector<std::jthread> &workers, size_t count, const std::function<void()> &body) {
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back(body);
+    }
+}
+
+void join_workers(std::vector<std::jthread> &workers) {
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+// JSON string body; labels are plain names, so only quotes and backslashes need escaping
+std::string escape_json(const std::string &text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
 } // anonymous namespace
 
+void write_detections_jsonl(std::ostream &out, size_t frame_number, double timestamp,
+                            std::span<const BoundingBox> boxes, std::span<const int> class_ids,
+                            std::span<const float> scores, const std::vector<std::string> &labels) {
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3);
+    line << "{\"frame\": " << frame_number << ", \"time\": " << timestamp << ", \"detections\": [";
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        const BoundingBox &box = boxes[i];
+        line << (i > 0 ? ", " : "") << "{\"class_id\": " << class_ids[i] << ", \"label\": \""
+             << escape_json(class_name(labels, class_ids[i])) << "\", \"score\": " << scores[i] << ", \"box\": ["
+             << std::setprecision(1) << box.x_min << ", " << box.y_min << ", " << box.x_max << ", " << box.y_max
+             << "]}" << std::setprecision(3);
+    }
+    line << "]}\n";
+    out << line.str();
+}
+
+ReorderBuffer::ReorderBuffer(size_t capacity) : pending_(std::max<size_t>(capacity, 1), kEmpty) {}
+
+void ReorderBuffer::push(size_t frame_number, size_t slot) {
+    if (frame_number < next_frame_ || frame_number - next_frame_ >= pending_.size()) {
+        throw std::runtime_error("Frame " + std::to_string(frame_number) + " is outside the reorder window [" +
+                                 std::to_string(next_frame_) + ", " + std::to_string(next_frame_ + pending_.size()) +
+                                 ")");
+    }
+    size_t &held = pending_[frame_number % pending_.size()];
+    if (held != kEmpty) {
+        throw std::runtime_error("Frame " + std::to_string(frame_number) + " was pushed twice");
+    }
+    held = slot;
+}
+
+std::optional<size_t> ReorderBuffer::pop() {
+    size_t &held = pending_[next_frame_ % pending_.size()];
+    if (held == kEmpty) {
+        return std::nullopt;
+    }
+    const size_t slot = std::exchange(held, kEmpty);
+    ++next_frame_;
+    return slot;
+}
+
+StageErrors::StageErrors(std::function<void()> on_error) : on_error_(std::move(on_error)) {}
+
+void StageErrors::run(const std::function<void()> &stage) noexcept {
+    try {
+        stage();
+    } catch (...) {
+        {
+            const std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+        on_error_();
+    }
+}
+
+void StageErrors::rethrow_if_failed() const {
+    std::exception_ptr error;
+    {
+        const std::lock_guard lock(mutex_);
+        error = error_;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 VideoPipeline::VideoPipeline(const VideoPipelineConfig &config)
     : config_(config), slots_(config.ring_buffer_size), decode_to_preprocess_(config.ring_buffer_size, kPoisonPill),
-      preprocess_to_infer_(config.ring_buffer_size, kPoisonPill), infer_to_draw_(config.ring_buffer_size, kPoisonPill),
-      free_slots_(config.ring_buffer_size, kPoisonPill) {
+      preprocess_to_infer_(config.ring_buffer_size, kPoisonPill),
+      infer_to_postprocess_(config.ring_buffer_size, kPoisonPill),
+      postprocess_to_draw_(config.ring_buffer_size, kPoisonPill), draw_to_write_(config.ring_buffer_size, kPoisonPill),
+      free_slots_(config.ring_buffer_size, kPoisonPill),
+      stats_({1, config.preprocess_workers, config.infer_workers, config.postprocess_workers, config.draw_workers, 1},
+             config.ring_buffer_size) {
+
+    if (config_.preprocess_workers == 0 || config_.infer_workers == 0 || config_.postprocess_workers == 0 ||
+        config_.draw_workers == 0) {
+        throw std::runtime_error("VideoPipelineConfig worker counts must be at least 1");
+    }
+    if (config_.max_batch_size == 0) {
+        throw std::runtime_error("VideoPipelineConfig::max_batch_size must be at least 1");
+    }
+    if (config_.stats_interval <= std::chrono::milliseconds::zero()) {
+        throw std::runtime_error("VideoPipelineConfig::stats_interval must be positive");
+    }
+    if (config_.start_time && config_.end_time && *config_.end_time <= *config_.start_time) {
+        throw std::runtime_error("VideoPipelineConfig::end_time must be after start_time");
+    }
 
     load_labels(config_.label_path, labels_);
+    if (!config_.trace_path.empty()) {
+        tracer_ = std::make_unique<rfdetr::profiling::Tracer>();
+    }
 
     // Probe the input once so the writer/display can be sized before decode
     // produces the first frame.
-    rfdetr::media::VideoReader probe(config_.video_path);
+    // Only the headers are read, so the probe needs no decoder threads.
+    rfdetr::media::VideoReaderOptions probe_options;
+    probe_options.threads = 1;
+    rfdetr::media::VideoReader probe(config_.video_path, probe_options);
     width_ = probe.width();
     height_ = probe.height();
     fps_ = probe.fps();
 
+    const auto res = static_cast<size_t>(config_.inference_config.resolution);
+    const size_t image_size = 3 * res * res;
+    const bool u8 = config_.input_format == InputFormat::UINT8_NHWC;
+    tensor_arena_ = rfdetr::memory::TensorArena(slots_.size() * image_size * (u8 ? sizeof(uint8_t) : sizeof(float)),
+                                                config_.huge_pages);
     for (size_t i = 0; i < slots_.size(); ++i) {
-        slots_[i].allocate(config_.inference_config.resolution);
+        if (u8) {
+            slots_[i].tensor_u8 = tensor_arena_.view<uint8_t>(i * image_size, image_size);
+        } else {
+            slots_[i].tensor = tensor_arena_.view<float>(i * image_size, image_size);
+        }
         free_slots_.push(i);
     }
 }
@@ -95,49 +244,147 @@ void VideoPipeline::request_shutdown() noexcept {
     stop_requested_.store(true, std::memory_order_release);
     decode_to_preprocess_.close();
     preprocess_to_infer_.close();
-    infer_to_draw_.close();
+    infer_to_postprocess_.close();
+    postprocess_to_draw_.close();
+    draw_to_write_.close();
     free_slots_.close();
+    preview_.close();
 }
 
 size_t VideoPipeline::run() {
+    preprocess_running_.store(config_.preprocess_workers);
+    infer_running_.store(config_.infer_workers);
+    postprocess_running_.store(config_.postprocess_workers);
+    draw_running_.store(config_.draw_workers);
+
+    stats_.start();
+    stats_thread_ =
+        std::jthread([this](std::stop_token stop) { stage_errors_.run([&] { stats_stage(std::move(stop)); }); });
+
     // Launch consumers before producers so they are ready to pop
-    draw_thread_ = std::jthread([this] { draw_write_stage(); });
-    infer_thread_ = std::jthread([this] { infer_postprocess_stage(); });
-    preprocess_thread_ = std::jthread([this] { preprocess_stage(); });
-    decode_thread_ = std::jthread([this] { decode_stage(); });
+    if (config_.display) {
+        display_thread_ = std::jthread([this] { stage_errors_.run([this] { display_stage(); }); });
+    }
+    write_thread_ = std::jthread([this] { stage_errors_.run([this] { write_stage(); }); });
+    launch_workers(draw_workers_, config_.draw_workers, [this] { stage_errors_.run([this] { draw_stage(); }); });
+    launch_workers(postprocess_workers_, config_.postprocess_workers,
+                   [this] { stage_errors_.run([this] { postprocess_stage(); }); });
+    launch_workers(infer_workers_, config_.infer_workers, [this] { stage_errors_.run([this] { infer_stage(); }); });
+    launch_workers(preprocess_workers_, config_.preprocess_workers,
+                   [this] { stage_errors_.run([this] { preprocess_stage(); }); });
+    decode_thread_ = std::jthread([this] { stage_errors_.run([this] { decode_stage(); }); });
 
     decode_thread_.join();
-    preprocess_thread_.join();
-    infer_thread_.join();
-    draw_thread_.join();
+    join_workers(preprocess_workers_);
+    join_workers(infer_workers_);
+    join_workers(postprocess_workers_);
+    join_workers(draw_workers_);
+    write_thread_.join();
+    preview_.close();
+    if (display_thread_.joinable()) {
+        display_thread_.join();
+    }
+
+    stats_thread_.request_stop();
+    stats_thread_.join();
+    stats_.stop();
+    stage_errors_.rethrow_if_failed();
+    if (tracer_ != nullptr) {
+        std::ofstream out(config_.trace_path);
+        if (!out) {
+            throw std::runtime_error("Could not write trace to " + config_.trace_path.string());
+        }
+        tracer_->write_json(out);
+    }
+    if (!config_.prometheus_path.empty()) {
+        write_prometheus();
+    }
+    if (!config_.stats_json_path.empty()) {
+        std::ofstream out(config_.stats_json_path);
+        if (!out) {
+            throw std::runtime_error("Could not write pipeline stats to " + config_.stats_json_path.string());
+        }
+        stats_.write_json(out);
+    }
 
     return frames_processed_.load();
 }
 
+void VideoPipeline::stats_stage(std::stop_token stop) {
+    std::mutex mutex;
+    std::condition_variable_any wakeup;
+    std::unique_lock lock(mutex);
+    while (!stop.stop_requested()) {
+        stats_.sample_queues({decode_to_preprocess_.size(), preprocess_to_infer_.size(), infer_to_postprocess_.size(),
+                              postprocess_to_draw_.size(), draw_to_write_.size(), free_slots_.size()});
+        if (!config_.prometheus_path.empty()) {
+            write_prometheus();
+        }
+        wakeup.wait_for(lock, stop, config_.stats_interval, [] { return false; });
+    }
+}
+
+rfdetr::profiling::TraceBuffer *VideoPipeline::trace_buffer(const std::string &name) {
+    return tracer_ != nullptr ? &tracer_->thread_buffer(name) : nullptr;
+}
+
+void VideoPipeline::write_prometheus() const {
+    // Write-then-rename so a scraper never reads a half-written file. Metrics are best effort: a
+    // failed write is retried on the next tick rather than stopping the pipeline.
+    std::filesystem::path staging = config_.prometheus_path;
+    staging += ".tmp";
+    {
+        std::ofstream out(staging);
+        if (!out) {
+            return;
+        }
+        stats_.write_prometheus(out);
+    }
+    std::error_code ignored;
+    std::filesystem::rename(staging, config_.prometheus_path, ignored);
+}
+
 void VideoPipeline::decode_stage() {
-    rfdetr::media::VideoReader reader(config_.video_path);
+    rfdetr::media::VideoReader reader(config_.video_path, config_.decoder);
+    if (config_.start_time) {
+        reader.seek(*config_.start_time);
+    }
+    StageStats &stats = stats_.stage(PipelineStage::DECODE);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("decode");
 
     size_t frame_num = 0;
+    auto t = StatsClock::now();
     while (true) {
         const size_t slot_idx = free_slots_.pop();
         if (slot_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
             break;
         }
+        t = stats.pop_wait.record_since(t);
 
         FrameSlot &slot = slots_[slot_idx];
-        if (!reader.read(slot.raw_frame)) {
+        slot.decode_start = t;
+        if (!reader.read(slot.raw_frame) || (config_.end_time && reader.timestamp() >= *config_.end_time)) {
             free_slots_.push(slot_idx);
-            decode_to_preprocess_.push(kPoisonPill);
+            for (size_t i = 0; i < config_.preprocess_workers; ++i) {
+                decode_to_preprocess_.push(kPoisonPill);
+            }
             break;
         }
 
         slot.orig_h = slot.raw_frame.height;
         slot.orig_w = slot.raw_frame.width;
         slot.frame_number = frame_num++;
+        slot.timestamp = reader.timestamp();
+        t = stats.service.record_since(t);
+        if (trace != nullptr) {
+            trace->complete("decode", slot.decode_start, t, static_cast<int64_t>(slot.frame_number));
+        }
         if (stop_requested_.load(std::memory_order_acquire)) {
             break;
         }
         decode_to_preprocess_.push(slot_idx);
+        t = stats.push_wait.record_since(t);
+        stats.frames.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
@@ -145,95 +392,297 @@ void VideoPipeline::preprocess_stage() {
     const int res = config_.inference_config.resolution;
     const auto &means = config_.inference_config.means;
     const auto &stds = config_.inference_config.stds;
-
+    // All frames of a stream share one size, so the resize tables are built once.
+    rfdetr::media::BilinearResampler resampler;
+    // The stage thread is participant 0, so preprocess_threads == 1 spawns nothing.
+    rfdetr::concurrency::ThreadPool pool(config_.preprocess_threads);
+    StageStats &stats = stats_.stage(PipelineStage::PREPROCESS);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("preprocess");
+
+    auto t = StatsClock::now();
     while (true) {
         const size_t slot_idx = decode_to_preprocess_.pop();
         if (slot_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
-            preprocess_to_infer_.push(kPoisonPill);
             break;
         }
+        t = stats.pop_wait.record_since(t);
+        const auto started = t;
 
         FrameSlot &slot = slots_[slot_idx];
-        rfdetr::media::preprocess_bgr_image(slot.raw_frame, slot.tensor, res, means, stds);
+        slot.transform = rfdetr::processing::make_input_transform(config_.inference_config.resize_mode,
+                                                                  slot.raw_frame.width, slot.raw_frame.height, res);
+        if (config_.input_format == InputFormat::UINT8_NHWC) {
+            rfdetr::media::preprocess_bgr_image_u8(slot.raw_frame, slot.tensor_u8, res, means, slot.transform,
+                                                   resampler, pool);
+        } else {
+            rfdetr::media::preprocess_bgr_image(slot.raw_frame, slot.tensor, res, means, stds, slot.transform,
+                                                resampler, pool);
+        }
+        t = stats.service.record_since(t);
+        if (trace != nullptr) {
+            trace->complete("preprocess", started, t, static_cast<int64_t>(slot.frame_number));
+        }
         if (stop_requested_.load(std::memory_order_acquire)) {
             break;
         }
         preprocess_to_infer_.push(slot_idx);
+        t = stats.push_wait.record_since(t);
+        stats.frames.fetch_add(1, std::memory_order_relaxed);
     }
+    finish_worker(preprocess_running_, preprocess_to_infer_, config_.infer_workers);
 }
 
-void VideoPipeline::infer_postprocess_stage() {
+void VideoPipeline::infer_stage() {
     RFDETRInference inference(config_.model_path, config_.label_path, config_.inference_config);
-    const auto res = static_cast<float>(inference.get_resolution());
+    if (inference.get_input_format() != config_.input_format) {
+        throw std::runtime_error("VideoPipelineConfig::input_format does not match the model's input format");
+    }
+
+    const size_t max_batch = config_.max_batch_size;
+    const auto res = static_cast<size_t>(config_.inference_config.resolution);
+    const size_t image_size = 3 * res * res;
+    std::vector<size_t> batch;
+    batch.reserve(max_batch);
+    // Gather buffer for batches whose slot tensors are not adjacent in memory
+    std::vector<float> batch_tensor;
+    std::vector<uint8_t> batch_tensor_u8;
+    StageStats &stats = stats_.stage(PipelineStage::INFER);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("infer");
+
+    bool end_of_stream = false;
+    auto t = StatsClock::now();
+    while (!end_of_stream) {
+        const size_t first_idx = preprocess_to_infer_.pop();
+        if (first_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
+            break;
+        }
+        batch.clear();
+        batch.push_back(first_idx);
+        const auto deadline = std::chrono::steady_clock::now() + config_.max_batch_wait;
+        while (batch.size() < max_batch) {
+            const auto next_idx = preprocess_to_infer_.pop_until(deadline);
+            if (!next_idx) {
+                break;
+            }
+            if (*next_idx == kPoisonPill) {
+                end_of_stream = true; // run what was collected, then stop
+                break;
+            }
+            batch.push_back(*next_idx);
+        }
+        t = stats.pop_wait.record_since(t);
+        const auto started = t;
 
+        if (config_.input_format == InputFormat::UINT8_NHWC) {
+            inference.run_inference(gather_batch(batch, &FrameSlot::tensor_u8, image_size, batch_tensor_u8));
+        } else {
+            inference.run_inference(gather_batch(batch, &FrameSlot::tensor, image_size, batch_tensor));
+        }
+        // The backend overwrites its outputs on the next run; each slot keeps a copy of its item
+        // (of a segmentation model's masks, only the planes the postprocess can select)
+        for (size_t b = 0; b < batch.size(); ++b) {
+            inference.capture_outputs(slots_[batch[b]].outputs, b);
+        }
+        t = stats.service.record_since(t);
+        if (trace != nullptr) {
+            trace->complete("infer", started, t, static_cast<int64_t>(slots_[batch[0]].frame_number),
+                            static_cast<uint32_t>(batch.size()));
+        }
+
+        if (stop_requested_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        for (const size_t slot_idx : batch) {
+            infer_to_postprocess_.push(slot_idx);
+        }
+        t = stats.push_wait.record_since(t);
+        stats.frames.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+    finish_worker(infer_running_, infer_to_postprocess_, config_.postprocess_workers);
+}
+
+template <typename T>
+std::span<const T> VideoPipeline::gather_batch(std::span<const size_t> batch, std::span<T> FrameSlot::*tensor,
+                                               size_t image_size, std::vector<T> &scratch) const {
+    const T *first = (slots_[batch[0]].*tensor).data();
+    bool adjacent = true;
+    for (size_t b = 1; b < batch.size() && adjacent; ++b) {
+        adjacent = (slots_[batch[b]].*tensor).data() == first + b * image_size;
+    }
+    if (adjacent) {
+        return {first, batch.size() * image_size};
+    }
+    scratch.resize(batch.size() * image_size);
+    for (size_t b = 0; b < batch.size(); ++b) {
+        const auto &source = slots_[batch[b]].*tensor;
+        std::copy(source.begin(), source.end(), scratch.begin() + static_cast<std::ptrdiff_t>(b * image_size));
+    }
+    return scratch;
+}
+
+void VideoPipeline::postprocess_stage() {
+    auto postprocessor = RFDETRInference::postprocessor(config_.label_path, config_.inference_config);
+    // The stage thread is participant 0, so mask_threads == 1 spawns nothing.
+    rfdetr::concurrency::ThreadPool mask_pool(config_.mask_threads);
+    StageStats &stats = stats_.stage(PipelineStage::POSTPROCESS);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("postprocess");
+
+    auto t = StatsClock::now();
     while (true) {
-        const size_t slot_idx = preprocess_to_infer_.pop();
+        const size_t slot_idx = infer_to_postprocess_.pop();
         if (slot_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
-            infer_to_draw_.push(kPoisonPill);
             break;
         }
+        t = stats.pop_wait.record_since(t);
+        const auto started = t;
 
         FrameSlot &slot = slots_[slot_idx];
+        // The slot's previous frame has been written; its mask/keypoint buffers go back to the pool
+        postprocessor.recycle_results(slot.masks);
+        postprocessor.recycle_results(slot.keypoints);
         slot.clear_results();
 
-        inference.run_inference(slot.tensor);
-
-        const float scale_w = static_cast<float>(slot.orig_w) / res;
-        const float scale_h = static_cast<float>(slot.orig_h) / res;
-
+        postprocessor.load_outputs(slot.outputs);
         if (config_.inference_config.model_type == ModelType::SEGMENTATION) {
-            inference.postprocess_segmentation_outputs(scale_w, scale_h, slot.orig_h, slot.orig_w, slot.scores,
-                                                       slot.class_ids, slot.boxes, slot.masks);
+            postprocessor.postprocess_segmentation_outputs(slot.transform, slot.scores, slot.class_ids, slot.boxes,
+                                                           slot.masks, mask_pool);
         } else if (config_.inference_config.model_type == ModelType::KEYPOINT) {
-            inference.postprocess_keypoint_outputs(scale_w, scale_h, slot.orig_h, slot.orig_w, slot.scores,
-                                                   slot.class_ids, slot.boxes, slot.keypoints);
-            // Draw keypoints on the frame (needs the inference object for get_label_name + config)
-            inference.draw_keypoints(slot.raw_frame, slot.boxes, slot.class_ids, slot.scores, slot.keypoints);
+            postprocessor.postprocess_keypoint_outputs(slot.transform, slot.scores, slot.class_ids, slot.boxes,
+                                                       slot.keypoints);
         } else {
-            inference.postprocess_outputs(scale_w, scale_h, slot.scores, slot.class_ids, slot.boxes);
+            postprocessor.postprocess_outputs(slot.transform, slot.scores, slot.class_ids, slot.boxes);
+        }
+        t = stats.service.record_since(t);
+        if (trace != nullptr) {
+            trace->complete("postprocess", started, t, static_cast<int64_t>(slot.frame_number));
         }
 
         if (stop_requested_.load(std::memory_order_acquire)) {
             break;
         }
 
-        infer_to_draw_.push(slot_idx);
+        postprocess_to_draw_.push(slot_idx);
+        t = stats.push_wait.record_since(t);
+        stats.frames.fetch_add(1, std::memory_order_relaxed);
     }
+    finish_worker(postprocess_running_, postprocess_to_draw_, config_.draw_workers);
 }
 
-void VideoPipeline::draw_write_stage() {
-    rfdetr::media::VideoWriter writer(config_.output_path, width_, height_, fps_);
-    std::unique_ptr<rfdetr::media::Display> display;
-    if (config_.display) {
-        display = std::make_unique<rfdetr::media::Display>("RF-DETR Inference", width_, height_);
-    }
+void VideoPipeline::draw_stage() {
+    StageStats &stats = stats_.stage(PipelineStage::DRAW);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("draw");
+    // Nothing shows the frames when only detections are logged
+    const bool annotate = !config_.output_path.empty() || config_.display;
 
+    auto t = StatsClock::now();
     while (true) {
-        const size_t slot_idx = infer_to_draw_.pop();
+        const size_t slot_idx = postprocess_to_draw_.pop();
         if (slot_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
             break;
         }
+        t = stats.pop_wait.record_since(t);
+        const auto started = t;
 
         FrameSlot &slot = slots_[slot_idx];
 
-        if (config_.inference_config.model_type == ModelType::SEGMENTATION) {
+        const Config &inference_config = config_.inference_config;
+        if (annotate && inference_config.model_type == ModelType::SEGMENTATION) {
             draw_segmentation_on_frame(slot.raw_frame, slot.boxes, slot.class_ids, slot.scores, slot.masks, labels_);
-        } else if (config_.inference_config.model_type != ModelType::KEYPOINT) {
-            // Keypoint frames were already annotated in infer_postprocess_stage.
+        } else if (annotate && inference_config.model_type == ModelType::KEYPOINT) {
+            rfdetr::media::draw_keypoints(slot.raw_frame, slot.boxes, slot.class_ids, slot.keypoints,
+                                          inference_config.skeleton, inference_config.keypoint_color);
+        } else if (annotate) {
             draw_on_frame(slot.raw_frame, slot.boxes, slot.class_ids, slot.scores, labels_);
         }
+        t = stats.service.record_since(t);
+        if (trace != nullptr) {
+            trace->complete("draw", started, t, static_cast<int64_t>(slot.frame_number));
+        }
 
-        writer.write(slot.raw_frame);
+        if (stop_requested_.load(std::memory_order_acquire)) {
+            break;
+        }
 
-        if (display != nullptr) {
-            if (!display->show(slot.raw_frame)) {
-                request_shutdown();
-                break;
+        draw_to_write_.push(slot_idx);
+        t = stats.push_wait.record_since(t);
+        stats.frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    finish_worker(draw_running_, draw_to_write_, 1);
+}
+
+void VideoPipeline::write_stage() {
+    std::unique_ptr<rfdetr::media::VideoWriter> writer;
+    if (!config_.output_path.empty()) {
+        writer = std::make_unique<rfdetr::media::VideoWriter>(config_.output_path, width_, height_, fps_);
+    }
+    std::ofstream detections;
+    if (!config_.detections_path.empty()) {
+        detections.open(config_.detections_path);
+        if (!detections) {
+            throw std::runtime_error("Could not write detections to " + config_.detections_path.string());
+        }
+    }
+    ReorderBuffer reorder(slots_.size());
+    StageStats &stats = stats_.stage(PipelineStage::WRITE);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("write");
+
+    auto t = StatsClock::now();
+    while (true) {
+        const size_t slot_idx = draw_to_write_.pop();
+        if (slot_idx == kPoisonPill || stop_requested_.load(std::memory_order_acquire)) {
+            break;
+        }
+        t = stats.pop_wait.record_since(t);
+        reorder.push(slots_[slot_idx].frame_number, slot_idx);
+
+        for (auto next = reorder.pop(); next.has_value(); next = reorder.pop()) {
+            const size_t ready = *next;
+            FrameSlot &slot = slots_[ready];
+            const auto frame = static_cast<int64_t>(slot.frame_number);
+            const auto started = t;
+            if (writer != nullptr) {
+                writer->write(slot.raw_frame, slot.timestamp);
+                if (trace != nullptr) {
+                    t = StatsClock::now();
+                    trace->complete("encode", started, t, frame);
+                }
+            }
+            if (detections.is_open()) {
+                write_detections_jsonl(detections, slot.frame_number, slot.timestamp, slot.boxes, slot.class_ids,
+                                       slot.scores, labels_);
             }
+
+            if (config_.display) {
+                preview_.post(slot.raw_frame, frame);
+            }
+
+            t = stats.service.record_since(started);
+            stats_.end_to_end().record(t - slot.decode_start);
+
+            frames_processed_.fetch_add(1, std::memory_order_relaxed);
+            free_slots_.push(ready);
+            t = stats.push_wait.record_since(t);
+            stats.frames.fetch_add(1, std::memory_order_relaxed);
         }
+    }
+}
 
-        frames_processed_.fetch_add(1, std::memory_order_relaxed);
-        free_slots_.push(slot_idx);
+void VideoPipeline::display_stage() {
+    // Created on this thread: SDL wants its window, renderer and events on one thread
+    rfdetr::media::Display display("RF-DETR Inference", width_, height_);
+    rfdetr::profiling::TraceBuffer *trace = trace_buffer("display");
+    rfdetr::media::Image frame;
+
+    while (const auto frame_number = preview_.take(frame)) {
+        const auto started = StatsClock::now();
+        if (!display.show(frame)) {
+            request_shutdown();
+            return;
+        }
+        if (trace != nullptr) {
+            trace->complete("display", started, StatsClock::now(), *frame_number);
+        }
     }
 }
 
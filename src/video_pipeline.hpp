@@ -1,12 +1,25 @@
 #pragma once
 
+#include "bounded_queue.hpp"
+#include "display.hpp"
+#include "pipeline_stats.hpp"
 #include "rfdetr_inference.hpp"
+#include "tensor_arena.hpp"
+#include "tracer.hpp"
+#include "video_reader.hpp"
 
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stop_token>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -22,18 +35,18 @@ struct FrameSlot {
     rfdetr::media::Image raw_frame;
     int orig_h{0};
     int orig_w{0};
-    std::vector<float> tensor; // pre-allocated to 3 * res * res
+    InputTransform transform;  // set by preprocess, consumed by postprocess
+    std::span<float> tensor;      // 3 * res * res in the pipeline's arena (FLOAT32_NCHW models)
+    std::span<uint8_t> tensor_u8; // 3 * res * res in the pipeline's arena (UINT8_NHWC models)
+    InferenceOutputs outputs;     // set by infer, consumed by postprocess
     std::vector<float> scores;
     std::vector<int> class_ids;
     std::vector<BoundingBox> boxes;
     std::vector<rfdetr::media::Mask> masks;             // segmentation only
     std::vector<std::vector<KeypointResult>> keypoints; // keypoint only
     size_t frame_number{0};
-
-    void allocate(int resolution) {
-        const auto res = static_cast<size_t>(resolution);
-        tensor.resize(3 * res * res);
-    }
+    double timestamp{0.0}; // presentation time in seconds (VideoReader::timestamp())
+    StatsClock::time_point decode_start; // for the end-to-end latency
 
     void clear_results() {
         scores.clear();
@@ -44,88 +57,133 @@ struct FrameSlot {
     }
 };
 
-/// Thread-safe bounded queue. push() blocks when full; pop() blocks when empty.
-template <typename T> class BoundedQueue {
-  public:
-    explicit BoundedQueue(size_t capacity, T closed_value = T{})
-        : capacity_(capacity), closed_value_(std::move(closed_value)) {}
-
-    BoundedQueue(const BoundedQueue &) = delete;
-    BoundedQueue &operator=(const BoundedQueue &) = delete;
-
-    void push(T value) {
-        std::unique_lock lock(mutex_);
-        not_full_.wait(lock, [this] { return closed_ || queue_.size() < capacity_; });
-        if (closed_) {
-            return;
-        }
-        queue_.push(std::move(value));
-        lock.unlock();
-        not_empty_.notify_one();
-    }
-
-    /// Non-blocking push: drops `value` and returns false if the queue is full.
-    /// Used for shutdown poison-pills where blocking would deadlock once all
-    /// consumer threads have exited.
-    bool try_push(T value) {
-        std::unique_lock lock(mutex_);
-        if (closed_ || queue_.size() >= capacity_) {
-            return false;
-        }
-        queue_.push(std::move(value));
-        lock.unlock();
-        not_empty_.notify_one();
-        return true;
-    }
-
-    T pop() {
-        std::unique_lock lock(mutex_);
-        not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
-        if (queue_.empty()) {
-            return closed_value_;
-        }
-        T value = std::move(queue_.front());
-        queue_.pop();
-        lock.unlock();
-        not_full_.notify_one();
-        return value;
-    }
-
-    void close() {
-        {
-            std::lock_guard lock(mutex_);
-            closed_ = true;
-        }
-        not_full_.notify_all();
-        not_empty_.notify_all();
-    }
-
-  private:
-    std::queue<T> queue_;
-    size_t capacity_;
-    T closed_value_;
-    bool closed_{false};
-    std::mutex mutex_;
-    std::condition_variable not_full_;
-    std::condition_variable not_empty_;
-};
-
 /// Configuration for the video processing pipeline.
 struct VideoPipelineConfig {
     std::filesystem::path video_path;
     std::filesystem::path model_path;
     std::filesystem::path label_path;
+    /// Annotated video (empty = no video is encoded; frames are then not annotated either unless
+    /// `display` is set)
     std::filesystem::path output_path{"output_video.mp4"};
+    /// Every frame's detections with its timestamp as JSON Lines, in frame order (see
+    /// write_detections_jsonl; empty = not written). With `decoder.scan` and no `output_path`, this
+    /// turns the pipeline into a fast search over long recordings.
+    std::filesystem::path detections_path;
     Config inference_config;
     size_t ring_buffer_size{8};
+    /// Decoder threading (default: frame + slice threads, one per core) and which frames to decode
+    rfdetr::media::VideoReaderOptions decoder;
+    /// Process only frames with timestamps in [start_time, end_time) (seconds on the
+    /// VideoReader::timestamp() clock, i.e. the `time` of the detections log; for most files that
+    /// is seconds from the start). The reader seeks to the keyframe before start_time instead of
+    /// decoding everything before it. The written video keeps the source timestamps.
+    std::optional<double> start_time;
+    std::optional<double> end_time;
+    /// Threads that split each frame's preprocessing by output rows (1 = preprocess stage thread
+    /// only, 0 = one per hardware thread). Raise it when large sources make preprocessing the
+    /// slowest stage.
+    size_t preprocess_threads{1};
+    /// Threads that upsample a frame's segmentation masks, one instance per task (1 = postprocess
+    /// stage thread only, 0 = one per hardware thread). Raise it when scenes with many instances
+    /// make postprocessing the slowest stage.
+    size_t mask_threads{1};
+    /// Worker threads per stage (decoding always uses one). Workers of a stage share its input
+    /// queue, so frames finish out of order; the writer puts them back in decode order. Each
+    /// inference worker loads its own RFDETRInference, i.e. its own copy of the model, which is how
+    /// single-threaded sessions fill a many-core machine.
+    size_t preprocess_workers{1};
+    size_t infer_workers{1};
+    size_t postprocess_workers{1};
+    size_t draw_workers{1};
+    /// Dynamic micro-batching: an inference worker runs up to `max_batch_size` queued frames as
+    /// one batch, waiting at most `max_batch_wait` after the first for the rest (0 = only frames
+    /// already queued). Needs a model with a dynamic batch axis (or one exported for exactly
+    /// this batch size); larger batches trade latency for throughput.
+    size_t max_batch_size{1};
+    std::chrono::microseconds max_batch_wait{0};
+    /// Input tensor layout the model expects (RFDETRInference::get_input_format() of a probe).
+    InputFormat input_format{InputFormat::FLOAT32_NCHW};
+    /// Back the slot tensor arena with transparent huge pages (Linux; a plain aligned block
+    /// elsewhere). Worth it for large rings at high resolutions.
+    bool huge_pages{false};
     bool display{false};
+    /// Where to write VideoPipeline::stats() as JSON when run() finishes (empty = not written)
+    std::filesystem::path stats_json_path;
+    /// Prometheus text file rewritten every `stats_interval` while running, e.g. for the
+    /// node_exporter textfile collector (empty = not written)
+    std::filesystem::path prometheus_path;
+    /// Queue depth sampling period (and Prometheus refresh period)
+    std::chrono::milliseconds stats_interval{250};
+    /// Record a span per frame and stage (decode, preprocess, infer, postprocess, draw, encode,
+    /// display) and write them as Chrome trace-event JSON here when run() finishes (empty = off)
+    std::filesystem::path trace_path;
+};
+
+/// Append one frame's detections to a JSON Lines stream:
+/// {"frame": 7, "time": 28.000, "detections": [{"class_id": 0, "label": "person", "score": 0.912,
+/// "box": [x_min, y_min, x_max, y_max]}]}
+/// `time` is the frame's timestamp in seconds, boxes are in source pixels. Frames without detections
+/// are written as well, so the log shows which parts of the video were searched.
+void write_detections_jsonl(std::ostream &out, size_t frame_number, double timestamp,
+                            std::span<const BoundingBox> boxes, std::span<const int> class_ids,
+                            std::span<const float> scores, const std::vector<std::string> &labels);
+
+/// Puts slots that finish out of order (several draw workers) back into frame order for the writer.
+///
+/// Every frame before next_frame() has been released and every frame in flight holds one of
+/// `capacity` ring slots, so in-flight frame numbers span fewer than `capacity` values and frame n
+/// can wait in position n % capacity without a map or heap.
+class ReorderBuffer {
+  public:
+    explicit ReorderBuffer(size_t capacity);
+
+    /// Hold `slot`, which carries frame `frame_number`; throws if that frame is already released,
+    /// already held, or `capacity` or more frames ahead of next_frame()
+    void push(size_t frame_number, size_t slot);
+
+    /// Release the slot of next_frame() if it has arrived; call until std::nullopt after each push()
+    [[nodiscard]] std::optional<size_t> pop();
+
+    /// The frame pop() releases next
+    [[nodiscard]] size_t next_frame() const noexcept { return next_frame_; }
+
+  private:
+    static constexpr size_t kEmpty = SIZE_MAX;
+    std::vector<size_t> pending_;
+    size_t next_frame_{0};
+};
+
+/// Keeps the first exception thrown by any of a pipeline's stage threads. An exception escaping a
+/// std::jthread calls std::terminate, so each thread runs its stage through run() instead, which
+/// catches it and calls `on_error` (which must not throw) to stop the other stages; the owner
+/// joins its threads and then rethrows it with rethrow_if_failed().
+class StageErrors {
+  public:
+    explicit StageErrors(std::function<void()> on_error);
+
+    /// Run `stage`; if it throws, keep the exception unless an earlier one is kept, then call on_error
+    void run(const std::function<void()> &stage) noexcept;
+
+    /// Rethrow the kept exception, if any
+    void rethrow_if_failed() const;
+
+  private:
+    std::function<void()> on_error_;
+    mutable std::mutex mutex_;
+    std::exception_ptr error_;
 };
 
-/// Four-stage ring buffer pipeline for video inference.
+/// Five-stage ring buffer pipeline for video inference.
 ///
-/// Stages: Decode → Preprocess → Infer+Postprocess → Draw+Write
-/// Each stage runs on its own std::jthread. Stages communicate by passing
-/// slot indices through bounded queues — zero frame copies between stages.
+/// Stages: Decode → Preprocess → Infer → Postprocess → Draw+Write
+/// Each stage runs on its own std::jthread(s) (see the *_workers config).
+/// Stages communicate by passing slot indices through bounded queues — zero
+/// frame copies between stages. The infer stage copies the model outputs into
+/// the slot, so the model starts on the next frame while this one is
+/// postprocessed. Draw workers annotate; a single writer thread reorders
+/// frames by FrameSlot::frame_number and encodes them. With a preview, the
+/// writer posts a copy of each frame to a display thread that shows the
+/// latest one, so the window's refresh rate never throttles encoding.
 class VideoPipeline {
   public:
     explicit VideoPipeline(const VideoPipelineConfig &config);
@@ -134,16 +192,34 @@ class VideoPipeline {
     VideoPipeline(const VideoPipeline &) = delete;
     VideoPipeline &operator=(const VideoPipeline &) = delete;
 
-    /// Run the pipeline to completion (blocking). Returns total frames processed.
+    /// Run the pipeline to completion (blocking). Returns total frames processed. If a stage
+    /// throws (model load, input_format mismatch, write error, ...), the pipeline stops and run()
+    /// rethrows that exception once every thread has exited.
     size_t run();
 
+    /// Stage timings, end-to-end latency and queue depths of the run; complete once run() returns.
+    [[nodiscard]] const PipelineStats &stats() const noexcept { return stats_; }
+
   private:
     void decode_stage();
     void preprocess_stage();
-    void infer_postprocess_stage();
-    void draw_write_stage();
+    void infer_stage();
+    void postprocess_stage();
+    void draw_stage();
+    void write_stage();
+    void display_stage();
+    void stats_stage(std::stop_token stop);
+    void write_prometheus() const;
+    // The calling thread's trace buffer, or nullptr when tracing is off
+    rfdetr::profiling::TraceBuffer *trace_buffer(const std::string &name);
     void request_shutdown() noexcept;
 
+    // The input tensor of the slots in `batch`, in order: a view of the slots' own memory when
+    // their tensors are adjacent, otherwise gathered into `scratch`
+    template <typename T>
+    std::span<const T> gather_batch(std::span<const size_t> batch, std::span<T> FrameSlot::*tensor,
+                                    size_t image_size, std::vector<T> &scratch) const;
+
     VideoPipelineConfig config_;
     std::vector<std::string> labels_;
 
@@ -152,23 +228,45 @@ class VideoPipeline {
     int height_{0};
     double fps_{25.0};
 
-    // Ring buffer
+    // Ring buffer. Slot i's input tensor is element range [i, i + 1) * 3 * res * res of the arena,
+    // so consecutive slots form a batch tensor as they stand.
     std::vector<FrameSlot> slots_;
+    rfdetr::memory::TensorArena tensor_arena_;
 
     // Inter-stage queues (carry slot indices)
     BoundedQueue<size_t> decode_to_preprocess_;
     BoundedQueue<size_t> preprocess_to_infer_;
-    BoundedQueue<size_t> infer_to_draw_;
+    BoundedQueue<size_t> infer_to_postprocess_;
+    BoundedQueue<size_t> postprocess_to_draw_;
+    BoundedQueue<size_t> draw_to_write_;
     BoundedQueue<size_t> free_slots_;
 
+    // Declared before the threads so they outlive them
+    PipelineStats stats_;
+    std::unique_ptr<rfdetr::profiling::Tracer> tracer_;
+    rfdetr::media::FrameMailbox preview_; // writer -> display thread (config_.display)
+
     // Threads
     std::jthread decode_thread_;
-    std::jthread preprocess_thread_;
-    std::jthread infer_thread_;
-    std::jthread draw_thread_;
+    std::vector<std::jthread> preprocess_workers_;
+    std::vector<std::jthread> infer_workers_;
+    std::vector<std::jthread> postprocess_workers_;
+    std::vector<std::jthread> draw_workers_;
+    std::jthread write_thread_;
+    std::jthread display_thread_;
+    std::jthread stats_thread_;
+
+    // Workers still running per stage; the last one out forwards end-of-stream downstream
+    std::atomic<size_t> preprocess_running_{0};
+    std::atomic<size_t> infer_running_{0};
+    std::atomic<size_t> postprocess_running_{0};
+    std::atomic<size_t> draw_running_{0};
 
     std::atomic<size_t> frames_processed_{0};
     std::atomic<bool> stop_requested_{false};
+
+    // Every stage thread runs through this; a failure shuts the pipeline down for run() to rethrow
+    StageErrors stage_errors_{[this] { request_shutdown(); }};
 };
 
 } // namespace rfdetr::video
@@ -1,7 +1,11 @@
 #include "video_reader.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #ifdef USE_OPENCV
 #include <opencv2/imgcodecs.hpp>
@@ -27,12 +31,33 @@ struct VideoReader::Impl {
     int width{0};
     int height{0};
     double fps{25.0};
-
-    explicit Impl(const std::filesystem::path &path) {
+    int keep_every{1};
+    int64_t frames_read{0};
+    double timestamp{0.0};
+    double start_timestamp{0.0};
+    double duration{0.0};
+
+    Impl(const std::filesystem::path &path, const VideoReaderOptions &options) : keep_every(options.keep_every) {
+        if (options.scan != DecodeScan::ALL_FRAMES) {
+            // VideoCapture exposes no decoder discard settings
+            throw std::runtime_error("VideoReader: DecodeScan modes need the FFmpeg backend");
+        }
         if (!std::filesystem::exists(path)) {
             throw std::runtime_error("Video file does not exist: " + path.string());
         }
-        if (!cap.open(path.string())) {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+        // Open-time only, and honoured by the FFmpeg capture backend; 0 keeps OpenCV's default of
+        // one thread per core
+        std::vector<int> params;
+        if (options.threads > 0) {
+            params = {cv::CAP_PROP_N_THREADS, options.threads};
+        }
+        const bool opened = cap.open(path.string(), cv::CAP_ANY, params);
+#else
+        (void)options;
+        const bool opened = cap.open(path.string());
+#endif
+        if (!opened) {
             throw std::runtime_error("VideoReader: could not open " + path.string());
         }
         width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
@@ -45,13 +70,22 @@ struct VideoReader::Impl {
         if (f > 0.0) {
             fps = f;
         }
+        duration = std::max(cap.get(cv::CAP_PROP_FRAME_COUNT), 0.0) / fps;
     }
 
     bool read(Image &out) {
+        // grab() decodes without retrieve()'s copy and colour conversion
+        for (int skipped = 1; frames_read > 0 && skipped < keep_every; ++skipped) {
+            if (!cap.grab()) {
+                return false;
+            }
+        }
         cv::Mat mat;
         if (!cap.read(mat) || mat.empty()) {
             return false;
         }
+        ++frames_read;
+        timestamp = cap.get(cv::CAP_PROP_POS_MSEC) / 1000.0;
         // Normalise to 3-channel BGR (handles grayscale or BGRA sources).
         if (mat.channels() == 4) {
             cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR);
@@ -69,12 +103,30 @@ struct VideoReader::Impl {
         }
         return true;
     }
+
+    void seek(double target) {
+        // OpenCV's FFmpeg capture seeks to the preceding keyframe and grabs forward to the target
+        if (!cap.set(cv::CAP_PROP_POS_MSEC, target * 1000.0)) {
+            throw std::runtime_error("VideoReader: seek failed");
+        }
+        frames_read = 0;
+    }
+
+    double seek_keyframe(double target) {
+        // VideoCapture hides keyframe positions; its seek is frame-accurate, so the target is the
+        // position
+        seek(target);
+        return target;
+    }
 };
 
 #else // FFmpeg backend
 
 namespace {
 
+// AV_NOPTS_VALUE, whose C-style cast trips -Wold-style-cast
+constexpr int64_t kNoTimestamp = INT64_MIN;
+
 void check(int err, const std::string &what) {
     if (err < 0) {
         char buf[AV_ERROR_MAX_STRING_SIZE] = {};
@@ -96,15 +148,24 @@ struct VideoReader::Impl {
     int height{0};
     double fps{25.0};
     int stream_index{-1};
+    int keep_every{1};
+    int64_t decoded{0}; // frames out of the decoder since the start or the last seek, skipped ones included
+    int64_t seek_pts{kNoTimestamp}; // frames before this (stream time base) are dropped after a seek
+    double origin{0.0};             // timestamp of `decoded` 0, for streams without timestamps
+    double timestamp{0.0};
+    double start_timestamp{0.0};
+    double duration{0.0};
+    bool held{false};     // `frame` was decoded by seek_keyframe() and is still to be returned
+    bool draining{false}; // end of input reached, the decoder has been sent the flush packet
     bool eof{false};
 
-    explicit Impl(const std::filesystem::path &path) {
+    Impl(const std::filesystem::path &path, const VideoReaderOptions &options) : keep_every(options.keep_every) {
         frame = av_frame_alloc();
         packet = av_packet_alloc();
         if (frame == nullptr || packet == nullptr) {
             throw std::runtime_error("VideoReader: av_frame/av_packet alloc failed");
         }
-        open_input(path);
+        open_input(path, options);
     }
 
     ~Impl() {
@@ -125,7 +186,7 @@ struct VideoReader::Impl {
         }
     }
 
-    void open_input(const std::filesystem::path &path) {
+    void open_input(const std::filesystem::path &path, const VideoReaderOptions &options) {
         if (!std::filesystem::exists(path)) {
             throw std::runtime_error("Video file does not exist: " + path.string());
         }
@@ -157,6 +218,22 @@ struct VideoReader::Impl {
         err = avcodec_parameters_to_context(dec_ctx, video_stream->codecpar);
         check(err, "VideoReader: avcodec_parameters_to_context failed");
 
+        // libavcodec defaults to one thread; 0 asks it for one per core
+        dec_ctx->thread_count = options.threads;
+        dec_ctx->thread_type =
+            (options.frame_threads ? FF_THREAD_FRAME : 0) | (options.slice_threads ? FF_THREAD_SLICE : 0);
+
+        // Discarded frames are dropped by the decoder right after their headers are parsed, so
+        // they cost no reconstruction at all
+        if (options.scan == DecodeScan::KEYFRAMES) {
+            dec_ctx->skip_frame = AVDISCARD_NONKEY;
+        } else if (options.scan == DecodeScan::REFERENCE_FRAMES) {
+            dec_ctx->skip_frame = AVDISCARD_NONREF;
+        }
+        if (options.scan != DecodeScan::ALL_FRAMES) {
+            dec_ctx->skip_loop_filter = AVDISCARD_ALL;
+        }
+
         err = avcodec_open2(dec_ctx, codec, nullptr);
         check(err, "VideoReader: avcodec_open2 failed");
 
@@ -175,6 +252,16 @@ struct VideoReader::Impl {
                   static_cast<double>(video_stream->r_frame_rate.den);
         }
 
+        const double time_base = av_q2d(video_stream->time_base);
+        if (video_stream->start_time != kNoTimestamp) {
+            start_timestamp = static_cast<double>(video_stream->start_time) * time_base;
+        }
+        if (video_stream->duration != kNoTimestamp) {
+            duration = static_cast<double>(video_stream->duration) * time_base;
+        } else if (fmt_ctx->duration != kNoTimestamp) {
+            duration = static_cast<double>(fmt_ctx->duration) / AV_TIME_BASE;
+        }
+
         sws = sws_getContext(width, height, dec_ctx->pix_fmt, width, height, AV_PIX_FMT_BGR24, SWS_BILINEAR, nullptr,
                              nullptr, nullptr);
         if (sws == nullptr) {
@@ -183,63 +270,105 @@ struct VideoReader::Impl {
     }
 
     bool read(Image &out) {
-        if (eof) {
+        if (!held && !decode_next()) {
             return false;
         }
+        held = false;
+        out.resize(width, height);
+        uint8_t *dst_data[1] = {out.data()};
+        int dst_linesize[1] = {width * 3};
+        sws_scale(sws, frame->data, frame->linesize, 0, height, dst_data, dst_linesize);
+        return true;
+    }
 
-        while (true) {
-            bool draining = false;
-            int err = av_read_frame(fmt_ctx, packet);
+    /// Decode into `frame` the next frame that passes the seek target and keep_every, and set
+    /// `timestamp`. False at end of stream.
+    bool decode_next() {
+        while (!eof) {
+            // Frames the decoder already holds come first: with frame threading (or B-frames) one
+            // packet can complete several frames, and sending more input before they are received
+            // would be refused with EAGAIN
+            int err = avcodec_receive_frame(dec_ctx, frame);
+            if (err == 0) {
+                const int64_t pts = frame->best_effort_timestamp;
+                if (seek_pts != kNoTimestamp) {
+                    if (pts != kNoTimestamp && pts < seek_pts) {
+                        continue; // between the keyframe and the seek target
+                    }
+                    seek_pts = kNoTimestamp;
+                }
+                const int64_t index = decoded++;
+                if (index % keep_every != 0) {
+                    continue;
+                }
+                timestamp = pts != kNoTimestamp ? static_cast<double>(pts) * av_q2d(video_stream->time_base)
+                                                : origin + static_cast<double>(index) / fps;
+                return true;
+            }
+            if (err == AVERROR_EOF || (err == AVERROR(EAGAIN) && draining)) {
+                // Flush fully consumed: no more frames will come.
+                eof = true;
+                break;
+            }
+            if (err != AVERROR(EAGAIN)) {
+                check(err, "VideoReader: avcodec_receive_frame failed");
+            }
+
+            err = av_read_frame(fmt_ctx, packet);
             if (err < 0) {
                 // End of file or read error: flush the decoder by sending a null packet.
                 draining = true;
                 err = avcodec_send_packet(dec_ctx, nullptr);
-                if (err < 0 && err != AVERROR(EAGAIN) && err != AVERROR_EOF) {
+                if (err < 0 && err != AVERROR_EOF) {
                     check(err, "VideoReader: flush avcodec_send_packet failed");
                 }
-            } else if (packet->stream_index != stream_index) {
-                av_packet_unref(packet);
                 continue;
-            } else {
+            }
+            if (packet->stream_index == stream_index) {
                 err = avcodec_send_packet(dec_ctx, packet);
-                if (err < 0 && err != AVERROR(EAGAIN) && err != AVERROR_EOF) {
-                    av_packet_unref(packet);
-                    check(err, "VideoReader: avcodec_send_packet failed");
-                }
             }
-
-            // Drain all available decoded frames for this packet (or the flush).
-            while (true) {
-                err = avcodec_receive_frame(dec_ctx, frame);
-                if (err == AVERROR(EAGAIN) || err == AVERROR_EOF) {
-                    break;
-                }
-                if (err < 0) {
-                    check(err, "VideoReader: avcodec_receive_frame failed");
-                }
-
-                out.resize(width, height);
-                uint8_t *dst_data[1] = {out.data()};
-                int dst_linesize[1] = {width * 3};
-                sws_scale(sws, frame->data, frame->linesize, 0, height, dst_data, dst_linesize);
-                av_packet_unref(packet);
-                return true;
+            av_packet_unref(packet);
+            if (err < 0) {
+                check(err, "VideoReader: avcodec_send_packet failed");
             }
+        }
+        return false;
+    }
 
-            av_packet_unref(packet);
+    void seek(double target) {
+        const int64_t target_pts = std::llround(target / av_q2d(video_stream->time_base));
+        check(av_seek_frame(fmt_ctx, stream_index, target_pts, AVSEEK_FLAG_BACKWARD), "VideoReader: seek failed");
+        avcodec_flush_buffers(dec_ctx);
+        seek_pts = target_pts;
+        origin = target;
+        decoded = 0;
+        held = false;
+        draining = false;
+        eof = false;
+    }
 
-            if (draining) {
-                // Flush fully consumed: no more frames will come.
-                eof = true;
-                return false;
-            }
+    double seek_keyframe(double target) {
+        seek(target);
+        seek_pts = kNoTimestamp; // stop at the keyframe itself
+        if (!decode_next()) {
+            return target;
         }
+        held = true; // the next read() returns it
+        return timestamp;
     }
 };
 
 #endif // USE_OPENCV
 
-VideoReader::VideoReader(const std::filesystem::path &path) : impl_(std::make_unique<Impl>(path)) {}
+VideoReader::VideoReader(const std::filesystem::path &path, const VideoReaderOptions &options) {
+    if (options.threads < 0) {
+        throw std::runtime_error("VideoReaderOptions::threads must not be negative");
+    }
+    if (options.keep_every < 1) {
+        throw std::runtime_error("VideoReaderOptions::keep_every must be at least 1");
+    }
+    impl_ = std::make_unique<Impl>(path, options);
+}
 
 VideoReader::~VideoReader() = default;
 
@@ -248,5 +377,10 @@ bool VideoReader::read(Image &out) { return impl_->read(out); }
 int VideoReader::width() const noexcept { return impl_->width; }
 int VideoReader::height() const noexcept { return impl_->height; }
 double VideoReader::fps() const noexcept { return impl_->fps; }
+void VideoReader::seek(double timestamp) { impl_->seek(timestamp); }
+double VideoReader::seek_keyframe(double timestamp) { return impl_->seek_keyframe(timestamp); }
+double VideoReader::timestamp() const noexcept { return impl_->timestamp; }
+double VideoReader::start_timestamp() const noexcept { return impl_->start_timestamp; }
+double VideoReader::duration() const noexcept { return impl_->duration; }
 
 } // namespace rfdetr::media
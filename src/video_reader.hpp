@@ -7,12 +7,40 @@
 
 namespace rfdetr::media {
 
+/// Which frames VideoReader decodes. The scan modes are for searching long recordings: a frame the
+/// decoder is told to discard costs next to nothing, whereas decoding a frame and dropping it costs
+/// as much as keeping it.
+enum class DecodeScan {
+    ALL_FRAMES,       ///< Every frame
+    REFERENCE_FRAMES, ///< Skip frames no other frame predicts from (typically B-frames)
+    KEYFRAMES,        ///< Keyframes only: one per GOP, i.e. every 1-10 s of typical camera footage
+};
+
+/// Decoder settings for VideoReader. High-bitrate H.264/HEVC (4K archives) is too much for one
+/// core, and a single-threaded decoder starves the rest of the pipeline.
+struct VideoReaderOptions {
+    /// Decoder threads: 0 = one per core, 1 = decode on the calling thread only
+    int threads{0};
+    /// Frame threading decodes several frames concurrently (scales with cores, at the cost of
+    /// about `threads` frames of extra latency); slice threading splits a frame across threads
+    /// when the stream was encoded with several slices. The FFmpeg backend uses whichever are
+    /// enabled and supported by the codec; OpenCV only takes the thread count.
+    bool frame_threads{true};
+    bool slice_threads{true};
+    /// Scan modes also skip the in-loop deblocking filter, which leaves blocking artifacts in the
+    /// image but does not matter for finding objects. FFmpeg backend only.
+    DecodeScan scan{DecodeScan::ALL_FRAMES};
+    /// Return only every Nth decoded frame (1 = all). The others are still decoded, since later
+    /// frames may predict from them, but never converted to BGR.
+    int keep_every{1};
+};
+
 /// Video reader: decodes a container into BGR24 Image frames, one at a time
 /// (pull model). The backend (FFmpeg or OpenCV VideoCapture) is selected at
 /// compile time via the CMake `USE_OPENCV` option.
 class VideoReader {
   public:
-    explicit VideoReader(const std::filesystem::path &path);
+    explicit VideoReader(const std::filesystem::path &path, const VideoReaderOptions &options = {});
     ~VideoReader();
 
     VideoReader(const VideoReader &) = delete;
@@ -23,6 +51,27 @@ class VideoReader {
     /// Decode the next frame into `out` (BGR24). Returns false at end of stream.
     bool read(Image &out);
 
+    /// Continue reading at the first frame whose timestamp() is at or after `timestamp` (seconds, same
+    /// clock). The FFmpeg backend jumps to the keyframe before it and decodes forward, dropping the
+    /// frames in between, so only that one GOP is decoded in vain. Throws std::runtime_error if the
+    /// stream cannot seek.
+    void seek(double timestamp);
+
+    /// Seek to the last keyframe at or before `timestamp` and return its timestamp; the next read()
+    /// returns that keyframe. Cheap (one frame is decoded), so it is how a file is cut into chunks
+    /// that each start on a keyframe. The OpenCV backend cannot see keyframes: it seeks to
+    /// `timestamp` and returns it.
+    double seek_keyframe(double timestamp);
+
+    /// Presentation time (seconds) of the frame the last read() returned, from the stream's
+    /// timestamps: the same clock whichever frames are skipped. Estimated from the frame count
+    /// and fps for streams without timestamps.
+    [[nodiscard]] double timestamp() const noexcept;
+    /// Timestamp of the first frame (0 unless the container starts later, e.g. MPEG-TS)
+    [[nodiscard]] double start_timestamp() const noexcept;
+    /// Stream duration in seconds from the container; 0 if unknown.
+    [[nodiscard]] double duration() const noexcept;
+
     [[nodiscard]] int width() const noexcept;
     [[nodiscard]] int height() const noexcept;
     /// Stream frame rate as a double; falls back to 25.0 if unknown.
@@ -1,9 +1,16 @@
 #include "video_writer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
 #ifdef USE_OPENCV
+#include "video_reader.hpp"
+
 #include <opencv2/videoio.hpp>
 #else
 extern "C" {
@@ -44,7 +51,7 @@ struct VideoWriter::Impl {
         }
     }
 
-    void write(const Image &frame) {
+    void write(const Image &frame, std::optional<double> /*timestamp*/) {
         if (frame.width != width || frame.height != height) {
             throw std::runtime_error("VideoWriter: frame size " + std::to_string(frame.width) + "x" +
                                      std::to_string(frame.height) + " does not match writer " + std::to_string(width) +
@@ -56,6 +63,27 @@ struct VideoWriter::Impl {
     }
 };
 
+void concat_videos(std::span<const std::filesystem::path> parts, const std::filesystem::path &output) {
+    if (parts.empty()) {
+        throw std::runtime_error("concat_videos: no input files");
+    }
+    // cv::VideoWriter cannot take encoded packets, so the parts are decoded and encoded again
+    std::unique_ptr<VideoWriter> writer;
+    Image frame;
+    for (const auto &part : parts) {
+        VideoReader reader(part);
+        if (writer == nullptr) {
+            writer = std::make_unique<VideoWriter>(output, reader.width(), reader.height(), reader.fps());
+        } else if (reader.width() != writer->width() || reader.height() != writer->height()) {
+            throw std::runtime_error("concat_videos: " + part.string() + " has a different frame size than " +
+                                     parts.front().string());
+        }
+        while (reader.read(frame)) {
+            writer->write(frame);
+        }
+    }
+}
+
 #else // FFmpeg backend
 
 namespace {
@@ -235,7 +263,7 @@ struct VideoWriter::Impl {
         }
     }
 
-    void write(const Image &frame) {
+    void write(const Image &frame, std::optional<double> timestamp) {
         if (frame.width != width || frame.height != height) {
             throw std::runtime_error("VideoWriter: frame size " + std::to_string(frame.width) + "x" +
                                      std::to_string(frame.height) + " does not match writer " + std::to_string(width) +
@@ -251,6 +279,11 @@ struct VideoWriter::Impl {
         const uint8_t *src_data[1] = {frame.data()};
         const int src_linesize[1] = {width * kChannels};
         sws_scale(sws, src_data, src_linesize, 0, height, yuv_frame->data, yuv_frame->linesize);
+        if (timestamp) {
+            // The encoder needs strictly increasing pts; two timestamps within one frame period
+            // would round to the same tick
+            pts = std::max(pts, static_cast<int64_t>(std::llround(*timestamp / av_q2d(enc_ctx->time_base))));
+        }
         yuv_frame->pts = pts++;
         encode_and_write(yuv_frame);
     }
@@ -263,6 +296,129 @@ struct VideoWriter::Impl {
     }
 };
 
+namespace {
+
+// AV_NOPTS_VALUE, whose C-style cast trips -Wold-style-cast
+constexpr int64_t kNoTimestamp = INT64_MIN;
+
+struct InputFile {
+    AVFormatContext *ctx{nullptr};
+
+    explicit InputFile(const std::filesystem::path &path) {
+        check(avformat_open_input(&ctx, path.string().c_str(), nullptr, nullptr),
+              "concat_videos: avformat_open_input failed for " + path.string());
+        check(avformat_find_stream_info(ctx, nullptr), "concat_videos: avformat_find_stream_info failed");
+    }
+    ~InputFile() { avformat_close_input(&ctx); }
+
+    InputFile(const InputFile &) = delete;
+    InputFile &operator=(const InputFile &) = delete;
+};
+
+struct OutputFile {
+    AVFormatContext *ctx{nullptr};
+    AVPacket *packet{nullptr};
+    bool header_written{false};
+
+    OutputFile() = default;
+    ~OutputFile() {
+        if (header_written) {
+            av_write_trailer(ctx);
+        }
+        if (ctx != nullptr && ctx->pb != nullptr) {
+            avio_closep(&ctx->pb);
+        }
+        if (ctx != nullptr) {
+            avformat_free_context(ctx);
+        }
+        av_packet_free(&packet);
+    }
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+};
+
+// Whether packets encoded with `a` can continue a stream encoded with `b`: same codec, frame size
+// and parameter sets (the SPS/PPS extradata)
+bool same_encoding(const AVCodecParameters &a, const AVCodecParameters &b) {
+    return a.codec_id == b.codec_id && a.width == b.width && a.height == b.height &&
+           a.extradata_size == b.extradata_size &&
+           (a.extradata_size <= 0 ||
+            std::memcmp(a.extradata, b.extradata, static_cast<size_t>(a.extradata_size)) == 0);
+}
+
+} // namespace
+
+void concat_videos(std::span<const std::filesystem::path> parts, const std::filesystem::path &output) {
+    if (parts.empty()) {
+        throw std::runtime_error("concat_videos: no input files");
+    }
+    OutputFile out;
+    check(avformat_alloc_output_context2(&out.ctx, nullptr, nullptr, output.string().c_str()),
+          "concat_videos: avformat_alloc_output_context2 failed");
+    out.packet = av_packet_alloc();
+    if (out.packet == nullptr) {
+        throw std::runtime_error("concat_videos: av_packet_alloc failed");
+    }
+
+    AVStream *out_stream = nullptr;
+    int64_t last_dts = kNoTimestamp;
+    for (const auto &part : parts) {
+        const InputFile in(part);
+        const int stream_index = av_find_best_stream(in.ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (stream_index < 0) {
+            throw std::runtime_error("concat_videos: no video stream in " + part.string());
+        }
+        const AVStream *in_stream = in.ctx->streams[stream_index];
+
+        if (out_stream != nullptr && !same_encoding(*in_stream->codecpar, *out_stream->codecpar)) {
+            // Its packets would be muxed fine but decode as garbage under the first part's parameters
+            throw std::runtime_error("concat_videos: " + part.string() + " is not encoded like " +
+                                     parts.front().string() + " (codec, frame size or parameter sets differ)");
+        }
+        if (out_stream == nullptr) {
+            // The output stream takes the first part's parameters (and SPS/PPS extradata); the
+            // check above holds every later part to them
+            out_stream = avformat_new_stream(out.ctx, nullptr);
+            if (out_stream == nullptr) {
+                throw std::runtime_error("concat_videos: avformat_new_stream failed");
+            }
+            check(avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar),
+                  "concat_videos: avcodec_parameters_copy failed");
+            out_stream->codecpar->codec_tag = 0;
+            out_stream->time_base = in_stream->time_base;
+            check(avio_open(&out.ctx->pb, output.string().c_str(), AVIO_FLAG_WRITE),
+                  "concat_videos: avio_open failed for " + output.string());
+            check(avformat_write_header(out.ctx, nullptr), "concat_videos: avformat_write_header failed");
+            out.header_written = true;
+        }
+
+        while (av_read_frame(in.ctx, out.packet) >= 0) {
+            if (out.packet->stream_index != stream_index) {
+                av_packet_unref(out.packet);
+                continue;
+            }
+            // The parts carry the source timestamps, so they line up without offsetting. Only
+            // B-frame reordering makes a part's first decode timestamps reach back before the
+            // previous part's last one; nudge those forward by a tick of the (fine) mp4 time base.
+            av_packet_rescale_ts(out.packet, in_stream->time_base, out_stream->time_base);
+            if (out.packet->dts != kNoTimestamp && last_dts != kNoTimestamp && out.packet->dts <= last_dts) {
+                out.packet->dts = last_dts + 1;
+                if (out.packet->pts != kNoTimestamp) {
+                    out.packet->pts = std::max(out.packet->pts, out.packet->dts);
+                }
+            }
+            if (out.packet->dts != kNoTimestamp) {
+                last_dts = out.packet->dts;
+            }
+            out.packet->stream_index = out_stream->index;
+            out.packet->pos = -1;
+            // Takes ownership of the packet's data and leaves it blank
+            check(av_interleaved_write_frame(out.ctx, out.packet), "concat_videos: av_interleaved_write_frame failed");
+        }
+    }
+}
+
 #endif // USE_OPENCV
 
 VideoWriter::VideoWriter(const std::filesystem::path &path, int width, int height, double fps)
@@ -270,7 +426,8 @@ VideoWriter::VideoWriter(const std::filesystem::path &path, int width, int heigh
 
 VideoWriter::~VideoWriter() = default;
 
-void VideoWriter::write(const Image &frame) { impl_->write(frame); }
+void VideoWriter::write(const Image &frame) { impl_->write(frame, std::nullopt); }
+void VideoWriter::write(const Image &frame, double timestamp) { impl_->write(frame, timestamp); }
 
 int VideoWriter::width() const noexcept { return impl_->width; }
 int VideoWriter::height() const noexcept { return impl_->height; }
@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <span>
 
 namespace rfdetr::media {
 
@@ -24,6 +25,12 @@ class VideoWriter {
     /// Throws std::runtime_error on failure.
     void write(const Image &frame);
 
+    /// Encode one frame at `timestamp` (seconds), so the output keeps the source's timing: a
+    /// segment cut from 10:00 starts at 10:00, and gaps (skipped frames) stay gaps. Rounded to the
+    /// writer's frame period and kept strictly increasing. The OpenCV backend cannot set
+    /// timestamps and writes frames at the constant frame rate.
+    void write(const Image &frame, double timestamp);
+
     [[nodiscard]] int width() const noexcept;
     [[nodiscard]] int height() const noexcept;
 
@@ -32,4 +39,11 @@ class VideoWriter {
     std::unique_ptr<Impl> impl_;
 };
 
+/// Join video files written by VideoWriter with identical settings (e.g. the chunks of one source)
+/// into `output`, in order. The FFmpeg backend copies the encoded packets without re-encoding,
+/// which is lossless and about as fast as copying the files; OpenCV decodes and re-encodes.
+/// Throws std::runtime_error on failure, including a part whose codec, frame size or (FFmpeg)
+/// codec parameter sets differ from the first part's.
+void concat_videos(std::span<const std::filesystem::path> parts, const std::filesystem::path &output);
+
 } // namespace rfdetr::media
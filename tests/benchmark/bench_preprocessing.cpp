@@ -1,7 +1,13 @@
+#include "media.hpp"
+#include "postprocess_kernels.hpp"
+#include "preprocess_kernels.hpp"
 #include "processing_utils.hpp"
+#include "thread_pool.hpp"
+#include "video_pipeline.hpp"
 
 #include <benchmark/benchmark.h>
 #include <random>
+#include <thread>
 #include <vector>
 
 static void BM_Sigmoid(benchmark::State &state) {
@@ -12,6 +18,50 @@ static void BM_Sigmoid(benchmark::State &state) {
 }
 BENCHMARK(BM_Sigmoid);
 
+// Per-query class argmax over 300 x 91 logits (one RF-DETR frame), per SIMD level.
+static void BM_ArgmaxRows(benchmark::State &state) {
+    const auto level = static_cast<rfdetr::cpu::SimdLevel>(state.range(0));
+    if (!rfdetr::cpu::simd_level_supported(level)) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    constexpr size_t queries = 300;
+    constexpr size_t classes = 91;
+    std::vector<float> logits(queries * classes);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(-5.0f, 2.0f);
+    for (auto &v : logits) {
+        v = dist(rng);
+    }
+    std::vector<float> max_values(queries);
+    std::vector<int32_t> max_indices(queries);
+
+    for (auto _ : state) {
+        rfdetr::processing::argmax_rows(logits, classes, max_values, max_indices, level);
+        benchmark::ClobberMemory();
+    }
+    state.SetLabel(std::string(rfdetr::cpu::to_string(level)));
+}
+BENCHMARK(BM_ArgmaxRows)->Arg(0)->Arg(1)->Arg(2)->Arg(3);
+
+// Top-300 (query, class) logits above logit(0.5) out of 300 x 91 (segmentation postprocess).
+static void BM_TopKSelector(benchmark::State &state) {
+    std::vector<float> logits(300 * 91);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(-5.0f, 2.0f);
+    for (auto &v : logits) {
+        v = dist(rng);
+    }
+    rfdetr::processing::TopKSelector topk;
+
+    for (auto _ : state) {
+        topk.reset(300, 0.0f);
+        topk.push(logits);
+        benchmark::DoNotOptimize(topk.sorted().data());
+    }
+}
+BENCHMARK(BM_TopKSelector);
+
 static void BM_CxCyWhToXyxy(benchmark::State &state) {
     for (auto _ : state) {
         benchmark::DoNotOptimize(rfdetr::processing::cxcywh_to_xyxy(50.0f, 50.0f, 20.0f, 10.0f));
@@ -41,4 +91,105 @@ static void BM_NormalizeImage(benchmark::State &state) {
 }
 BENCHMARK(BM_NormalizeImage)->Arg(224)->Arg(560);
 
+// 1080p BGR frame -> 3 x res x res normalized tensor, per SIMD level (0=scalar, 1=neon, 2=avx2, 3=avx512).
+static void BM_PreprocessBgrImage(benchmark::State &state) {
+    const auto level = static_cast<rfdetr::cpu::SimdLevel>(state.range(0));
+    if (!rfdetr::cpu::simd_level_supported(level)) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    const int res = static_cast<int>(state.range(1));
+
+    rfdetr::media::Image image;
+    image.resize(1920, 1080);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto &v : image.bgr) {
+        v = static_cast<uint8_t>(dist(rng));
+    }
+
+    std::vector<float> tensor(3 * static_cast<size_t>(res) * static_cast<size_t>(res));
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    const auto coeffs = rfdetr::media::make_normalize_coefficients(means, stds);
+
+    for (auto _ : state) {
+        rfdetr::media::resize_normalize_bgr_to_chw(image, tensor, res, coeffs, level);
+        benchmark::ClobberMemory();
+    }
+    state.SetLabel(std::string(rfdetr::cpu::to_string(level)));
+}
+BENCHMARK(BM_PreprocessBgrImage)->ArgsProduct({{0, 1, 2, 3}, {560}});
+
+// 4K BGR frame -> 3 x 560 x 560 tensor, rows split across N pool threads.
+static void BM_PreprocessBgrImageThreads(benchmark::State &state) {
+    constexpr int res = 560;
+    rfdetr::media::Image image;
+    image.resize(3840, 2160);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto &v : image.bgr) {
+        v = static_cast<uint8_t>(dist(rng));
+    }
+
+    std::vector<float> tensor(3 * static_cast<size_t>(res) * static_cast<size_t>(res));
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    rfdetr::media::BilinearResampler resampler;
+    rfdetr::concurrency::ThreadPool pool(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        rfdetr::media::preprocess_bgr_image(image, tensor, res, means, stds, resampler, pool);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PreprocessBgrImageThreads)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// Same 1080p frame -> res x res x 3 uint8 tensor for models that normalize in-graph; compare
+// against BM_PreprocessBgrImage (float CHW) at the same level.
+static void BM_PreprocessBgrImageU8(benchmark::State &state) {
+    constexpr int res = 560;
+    rfdetr::media::Image image;
+    image.resize(1920, 1080);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto &v : image.bgr) {
+        v = static_cast<uint8_t>(dist(rng));
+    }
+
+    std::vector<uint8_t> tensor(3 * static_cast<size_t>(res) * static_cast<size_t>(res));
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::STRETCH, 1920, 1080, res);
+    rfdetr::media::BilinearResampler resampler;
+
+    for (auto _ : state) {
+        rfdetr::media::preprocess_bgr_image_u8(image, tensor, res, means, transform, resampler);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PreprocessBgrImageU8);
+
+// Slot-index handoff between two pipeline stages: one producer thread, the benchmark thread
+// consumes. Arg = queue capacity (the pipeline's ring size).
+static void BM_BoundedQueueHandoff(benchmark::State &state) {
+    constexpr size_t kItems = 1 << 16;
+    rfdetr::video::BoundedQueue<size_t> queue(static_cast<size_t>(state.range(0)), rfdetr::video::kPoisonPill);
+
+    for (auto _ : state) {
+        std::thread producer([&] {
+            for (size_t i = 0; i < kItems; ++i) {
+                queue.push(i);
+            }
+        });
+        size_t sum = 0;
+        for (size_t i = 0; i < kItems; ++i) {
+            sum += queue.pop();
+        }
+        producer.join();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kItems));
+}
+BENCHMARK(BM_BoundedQueueHandoff)->Arg(8)->Arg(64)->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -16,16 +16,28 @@ class MockBackend : public rfdetr::backend::InferenceBackend {
         output_shapes_ = std::move(shapes);
     }
 
+    /// Pretend the model was exported with a uint8 NHWC input.
+    void set_input_format(rfdetr::backend::InputFormat format) { input_format_ = format; }
+
     std::vector<int64_t> initialize(const std::filesystem::path & /*model_path*/,
                                     const std::vector<int64_t> &input_shape) override {
         return input_shape;
     }
 
-    std::vector<void *> run_inference(std::span<const float> /*input_data*/,
-                                      const std::vector<int64_t> & /*input_shape*/) override {
-        return {};
+    void run_inference(std::span<const float> /*input_data*/, const std::vector<int64_t> &input_shape) override {
+        last_input_shape_ = input_shape;
+    }
+
+    void run_inference(std::span<const uint8_t> input_data, const std::vector<int64_t> &input_shape) override {
+        last_uint8_input_.assign(input_data.begin(), input_data.end());
+        last_input_shape_ = input_shape;
     }
 
+    [[nodiscard]] rfdetr::backend::InputFormat get_input_format() const override { return input_format_; }
+
+    [[nodiscard]] const std::vector<uint8_t> &last_uint8_input() const noexcept { return last_uint8_input_; }
+    [[nodiscard]] const std::vector<int64_t> &last_input_shape() const noexcept { return last_input_shape_; }
+
     [[nodiscard]] size_t get_output_count() const override { return output_data_.size(); }
 
     void get_output_data(size_t output_index, float *data, size_t size) override {
@@ -36,6 +48,13 @@ class MockBackend : public rfdetr::backend::InferenceBackend {
         std::memcpy(data, output_data_[output_index].data(), copy_size * sizeof(float));
     }
 
+    [[nodiscard]] std::span<const float> get_output_view(size_t output_index) const override {
+        if (output_index >= output_data_.size()) {
+            throw std::out_of_range("Output index out of range");
+        }
+        return output_data_[output_index];
+    }
+
     [[nodiscard]] std::vector<int64_t> get_output_shape(size_t output_index) const override {
         if (output_index >= output_shapes_.size()) {
             throw std::out_of_range("Shape index out of range");
@@ -43,9 +62,19 @@ class MockBackend : public rfdetr::backend::InferenceBackend {
         return output_shapes_[output_index];
     }
 
+    [[nodiscard]] std::span<const int64_t> get_output_shape_view(size_t output_index) const override {
+        if (output_index >= output_shapes_.size()) {
+            throw std::out_of_range("Shape index out of range");
+        }
+        return output_shapes_[output_index];
+    }
+
     [[nodiscard]] std::string get_backend_name() const override { return "MockBackend"; }
 
   private:
+    rfdetr::backend::InputFormat input_format_{rfdetr::backend::InputFormat::FLOAT32_NCHW};
+    std::vector<uint8_t> last_uint8_input_;
+    std::vector<int64_t> last_input_shape_;
     std::vector<std::vector<float>> output_data_;
     std::vector<std::vector<int64_t>> output_shapes_;
 };
@@ -1,16 +1,69 @@
+#include "chunked_pipeline.hpp"
+#include "display.hpp"
 #include "mock_backend.hpp"
+#include "pipeline_stats.hpp"
+#include "postprocess_kernels.hpp"
+#include "preprocess_kernels.hpp"
 #include "processing_utils.hpp"
 #include "rfdetr_inference.hpp"
+#include "tensor_arena.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
 #include "video_pipeline.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <limits>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
 #include <thread>
 
+// ============================================================================
+// Heap allocation counting (global operator new replacement)
+// ============================================================================
+
+namespace {
+std::atomic<size_t> g_heap_allocations{0};
+} // anonymous namespace
+
+void *operator new(std::size_t size) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+// GCC pairs operator new with operator delete, not with the malloc behind the replacement above
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t /*size*/) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t /*size*/) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Heap allocations made by `fn()` (on any thread while it runs)
+template <typename Fn> size_t count_heap_allocations(Fn &&fn) {
+    const size_t before = g_heap_allocations.load(std::memory_order_relaxed);
+    fn();
+    return g_heap_allocations.load(std::memory_order_relaxed) - before;
+}
+
 // ============================================================================
 // Sigmoid tests
 // ============================================================================
@@ -27,6 +80,96 @@ TEST(Sigmoid, Symmetry) {
     }
 }
 
+TEST(Sigmoid, LogitIsInverse) {
+    for (float p : {0.01f, 0.3f, 0.5f, 0.7f, 0.99f}) {
+        EXPECT_NEAR(rfdetr::processing::sigmoid(rfdetr::processing::logit(p)), p, 1e-6f);
+    }
+    EXPECT_FLOAT_EQ(rfdetr::processing::logit(0.5f), 0.0f);
+    EXPECT_EQ(rfdetr::processing::logit(0.0f), -std::numeric_limits<float>::infinity());
+    EXPECT_EQ(rfdetr::processing::logit(1.0f), std::numeric_limits<float>::infinity());
+}
+
+// ============================================================================
+// argmax_rows tests
+// ============================================================================
+
+// Every SIMD variant must pick the same class as a plain loop, including the first of tied maxima
+// and row lengths that leave vector tails (91 = COCO classes + background).
+TEST(ArgmaxRows, KernelsMatchScalarLoop) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> dist(-8.0f, 8.0f);
+    for (const size_t cols : {size_t{1}, size_t{3}, size_t{8}, size_t{17}, size_t{33}, size_t{91}}) {
+        const size_t rows = 37;
+        std::vector<float> logits(rows * cols);
+        for (auto &v : logits) {
+            v = dist(rng);
+        }
+        // Row 0: the maximum appears twice, at the last column and earlier
+        logits[cols - 1] = 20.0f;
+        logits[(cols - 1) / 2] = 20.0f;
+
+        for (const auto level : {rfdetr::cpu::SimdLevel::SCALAR, rfdetr::cpu::SimdLevel::NEON,
+                                 rfdetr::cpu::SimdLevel::AVX2, rfdetr::cpu::SimdLevel::AVX512}) {
+            if (!rfdetr::cpu::simd_level_supported(level)) {
+                continue;
+            }
+            std::vector<float> max_values(rows);
+            std::vector<int32_t> max_indices(rows);
+            rfdetr::processing::argmax_rows(logits, cols, max_values, max_indices, level);
+            for (size_t r = 0; r < rows; ++r) {
+                const auto row = logits.begin() + static_cast<ptrdiff_t>(r * cols);
+                const auto best = std::max_element(row, row + static_cast<ptrdiff_t>(cols));
+                ASSERT_EQ(max_indices[r], best - row)
+                    << rfdetr::cpu::to_string(level) << " cols " << cols << " row " << r;
+                ASSERT_EQ(max_values[r], *best);
+            }
+        }
+    }
+
+    std::vector<float> max_values(2);
+    std::vector<int32_t> max_indices(2);
+    EXPECT_THROW(rfdetr::processing::argmax_rows(std::vector<float>(5), 3, max_values, max_indices),
+                 std::runtime_error);
+}
+
+// The streaming selector keeps exactly what a full sort would: the k largest values above the
+// floor, best first, with ties broken toward the smaller index.
+TEST(TopKSelector, MatchesFullSort) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(-40, 40); // coarse values, so ties are common
+    std::vector<float> values(2000);
+    for (auto &v : values) {
+        v = static_cast<float>(dist(rng)) / 4.0f;
+    }
+
+    std::vector<uint32_t> order(values.size());
+    std::iota(order.begin(), order.end(), 0U);
+    std::sort(order.begin(), order.end(), [&values](uint32_t a, uint32_t b) {
+        return values[a] > values[b] || (values[a] == values[b] && a < b);
+    });
+
+    rfdetr::processing::TopKSelector topk;
+    for (const size_t k : {size_t{0}, size_t{1}, size_t{7}, size_t{300}, size_t{5000}}) {
+        for (const float floor : {-std::numeric_limits<float>::infinity(), 0.0f, 8.0f}) {
+            topk.reset(k, floor);
+            topk.push(values);
+            const auto selected = topk.sorted();
+
+            std::vector<uint32_t> expected;
+            for (const uint32_t i : order) {
+                if (expected.size() < k && values[i] > floor) {
+                    expected.push_back(i);
+                }
+            }
+            ASSERT_EQ(selected.size(), expected.size()) << "k " << k << " floor " << floor;
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQ(selected[i].index, expected[i]) << "k " << k << " floor " << floor << " rank " << i;
+                ASSERT_EQ(selected[i].value, values[expected[i]]);
+            }
+        }
+    }
+}
+
 // ============================================================================
 // NormalizeImage tests
 // ============================================================================
@@ -138,6 +281,50 @@ TEST(ClampBox, ClampsWidthAndHeightIndependently) {
     EXPECT_FLOAT_EQ(clamped.y_max, 80.0f);
 }
 
+// ============================================================================
+// InputTransform tests
+// ============================================================================
+
+TEST(InputTransform, StretchCoversWholeInput) {
+    const auto t = rfdetr::processing::make_input_transform(ResizeMode::STRETCH, 1920, 1080, 560);
+    EXPECT_EQ(t.content_x, 0);
+    EXPECT_EQ(t.content_y, 0);
+    EXPECT_EQ(t.content_width, 560);
+    EXPECT_EQ(t.content_height, 560);
+    EXPECT_FLOAT_EQ(t.scale_x, 1920.0f / 560.0f);
+    EXPECT_FLOAT_EQ(t.scale_y, 1080.0f / 560.0f);
+}
+
+TEST(InputTransform, LetterboxCentersWidePanorama) {
+    // 32:9 panorama: full width, 157.5 -> 158 rows tall, centered vertically.
+    const auto t = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 3200, 900, 560);
+    EXPECT_EQ(t.content_x, 0);
+    EXPECT_EQ(t.content_width, 560);
+    EXPECT_EQ(t.content_height, 158);
+    EXPECT_EQ(t.content_y, 201);
+    EXPECT_FLOAT_EQ(t.scale_x, 3200.0f / 560.0f);
+    EXPECT_FLOAT_EQ(t.scale_y, 900.0f / 158.0f);
+    EXPECT_THROW((void)rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 0, 900, 560),
+                 std::runtime_error);
+}
+
+TEST(InputTransform, UnmapBoxRemovesPaddingAndClamps) {
+    const auto t = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 400, 100, 100);
+    ASSERT_EQ(t.content_y, 37);
+    ASSERT_EQ(t.content_height, 25);
+    // Content edges map exactly onto the source edges.
+    const auto full = rfdetr::processing::unmap_box({0.0f, 37.0f, 100.0f, 62.0f}, t);
+    EXPECT_FLOAT_EQ(full.x_min, 0.0f);
+    EXPECT_FLOAT_EQ(full.y_min, 0.0f);
+    EXPECT_FLOAT_EQ(full.x_max, 400.0f);
+    EXPECT_FLOAT_EQ(full.y_max, 100.0f);
+    // Boxes reaching into the padding are clamped to the image.
+    const auto padded = rfdetr::processing::unmap_box({10.0f, 20.0f, 20.0f, 42.0f}, t);
+    EXPECT_FLOAT_EQ(padded.y_min, 0.0f);
+    EXPECT_FLOAT_EQ(padded.y_max, 20.0f);
+    EXPECT_FLOAT_EQ(padded.x_min, 40.0f);
+}
+
 // ============================================================================
 // GetColorForClass tests
 // ============================================================================
@@ -252,6 +439,17 @@ TEST(Preprocess, InvalidImage) {
     EXPECT_THROW(inference.preprocess_image("/nonexistent/image.jpg", orig_h, orig_w), std::runtime_error);
 }
 
+rfdetr::media::Image make_noise_image(int width, int height, uint32_t seed) {
+    rfdetr::media::Image image;
+    image.resize(width, height);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto &v : image.bgr) {
+        v = static_cast<uint8_t>(dist(rng));
+    }
+    return image;
+}
+
 // ============================================================================
 // Postprocess tests (using MockBackend)
 // ============================================================================
@@ -426,6 +624,502 @@ TEST_F(PostprocessTest, BoxesClampedToImageBounds) {
     EXPECT_NEAR(boxes[1].y_max, 100.0f, 0.01f);
 }
 
+TEST_F(PostprocessTest, LetterboxBoxesMapToOriginalImage) {
+    // 400x100 image letterboxed into 100x100: content rows [37, 62), 4 source px per model px.
+    const int num_classes = 6;
+    const int resolution = 100;
+    // Model box x 25..75, y 44.5..54.5 -> source x 100..300, y 30..70
+    std::vector<float> dets_data = {0.5f, 0.495f, 0.5f, 0.1f};
+    std::vector<float> labels_data(static_cast<size_t>(num_classes), -10.0f);
+    labels_data[1] = 10.0f;
+
+    auto inference = make_inference({dets_data, labels_data}, {{1, 1, 4}, {1, 1, num_classes}}, 0.5f, resolution);
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 400, 100, resolution);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    inference->postprocess_outputs(transform, scores, class_ids, boxes);
+
+    ASSERT_EQ(boxes.size(), 1u);
+    EXPECT_NEAR(boxes[0].x_min, 100.0f, 0.01f);
+    EXPECT_NEAR(boxes[0].x_max, 300.0f, 0.01f);
+    EXPECT_NEAR(boxes[0].y_min, 30.0f, 0.01f);
+    EXPECT_NEAR(boxes[0].y_max, 70.0f, 0.01f);
+}
+
+TEST_F(PostprocessTest, LetterboxMasksCroppedToContent) {
+    // 4x4 mask over the 100x100 model input; only mask row 1 is foreground. With a 400x100 image
+    // letterboxed into rows [37, 62), the image covers mask rows ~1.5..2.5, so the top of the
+    // original image is foreground and the bottom is not (a stretched mask would be the opposite).
+    const int num_classes = 6;
+    const int resolution = 100;
+    std::vector<float> dets_data = {0.5f, 0.5f, 0.5f, 0.2f};
+    std::vector<float> labels_data(static_cast<size_t>(num_classes), -10.0f);
+    labels_data[1] = 10.0f;
+    std::vector<float> mask_data(16, -10.0f);
+    std::fill(mask_data.begin() + 4, mask_data.begin() + 8, 10.0f);
+
+    auto inference = make_inference({dets_data, labels_data, mask_data},
+                                    {{1, 1, 4}, {1, 1, num_classes}, {1, 1, 4, 4}}, 0.5f, resolution);
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 400, 100, resolution);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> masks;
+    inference->postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks);
+
+    // The mask only covers the instance's box (x 100..300, y ~10..90 in the original image)
+    ASSERT_EQ(masks.size(), 1u);
+    const auto &mask = masks[0];
+    EXPECT_EQ(mask.x, static_cast<int>(std::floor(boxes[0].x_min)));
+    EXPECT_EQ(mask.y, static_cast<int>(std::floor(boxes[0].y_min)));
+    EXPECT_EQ(mask.x + mask.width, static_cast<int>(std::ceil(boxes[0].x_max)));
+    EXPECT_EQ(mask.y + mask.height, static_cast<int>(std::ceil(boxes[0].y_max)));
+    EXPECT_EQ(mask.data.size(), static_cast<size_t>(mask.width * mask.height));
+    EXPECT_EQ(mask.at(200, 20), 255);
+    EXPECT_EQ(mask.at(200, 80), 0);
+    EXPECT_EQ(mask.at(0, 0), 0); // foreground in the upsampled logits, but outside the box
+}
+
+// Lazy masks do no upsampling until asked, then match the eager masks; a retained handle keeps
+// working after the next inference run replaces the output tensors.
+TEST_F(PostprocessTest, LazyMasksMaterializeOnDemand) {
+    const int num_classes = 6;
+    const int resolution = 100;
+    std::vector<float> dets_data = {0.5f, 0.5f, 0.5f, 0.2f, 0.3f, 0.3f, 0.2f, 0.2f};
+    std::vector<float> labels_data(2 * static_cast<size_t>(num_classes), -10.0f);
+    labels_data[1] = 10.0f;
+    labels_data[num_classes + 2] = 9.0f;
+    std::vector<float> mask_data(32, -10.0f);
+    std::fill(mask_data.begin() + 4, mask_data.begin() + 8, 10.0f);
+    std::fill(mask_data.begin() + 16, mask_data.begin() + 22, 10.0f);
+
+    Config config;
+    config.resolution = resolution;
+    auto backend = std::make_unique<MockBackend>();
+    const std::vector<std::vector<int64_t>> shapes{{1, 2, 4}, {1, 2, num_classes}, {1, 2, 4, 4}};
+    backend->set_outputs({dets_data, labels_data, mask_data}, shapes);
+    MockBackend &mock = *backend;
+    auto inference = std::make_unique<RFDETRInference>(std::move(backend), labels_file_->path(), config);
+    const std::vector<float> input(3UL * resolution * resolution);
+    inference->run_inference(input);
+    const auto transform = inference->make_input_transform(400, 100);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> eager;
+    inference->postprocess_segmentation_outputs(transform, scores, class_ids, boxes, eager);
+
+    std::vector<float> lazy_scores;
+    std::vector<int> lazy_class_ids;
+    std::vector<BoundingBox> lazy_boxes;
+    std::vector<rfdetr::media::LazyMask> lazy;
+    inference->postprocess_segmentation_outputs(transform, lazy_scores, lazy_class_ids, lazy_boxes, lazy);
+    ASSERT_EQ(lazy.size(), 2U);
+    EXPECT_EQ(lazy_class_ids, class_ids);
+    EXPECT_FALSE(lazy[0].materialized());
+    EXPECT_FALSE(lazy[1].materialized());
+
+    EXPECT_EQ(lazy[0].get().data, eager[0].data);
+    EXPECT_TRUE(lazy[0].materialized());
+    EXPECT_FALSE(lazy[1].materialized());
+
+    // The next run frees the old output buffers; only the retained handle may still be used
+    lazy[1].retain();
+    mock.set_outputs({dets_data, labels_data, std::vector<float>(32, 10.0f)}, shapes);
+    inference->run_inference(input);
+    const auto &mask = lazy[1].get();
+    EXPECT_EQ(mask.x, eager[1].x);
+    EXPECT_EQ(mask.y, eager[1].y);
+    EXPECT_EQ(mask.width, eager[1].width);
+    EXPECT_EQ(mask.height, eager[1].height);
+    EXPECT_EQ(mask.data, eager[1].data);
+}
+
+// Box-cropped masks draw onto the image at their offset and encode to column-major COCO RLE.
+TEST_F(PostprocessTest, PostprocessorReadsCapturedOutputs) {
+    const int num_classes = 6;
+    const int resolution = 100;
+    const std::vector<float> dets_data = {0.5f, 0.5f, 0.5f, 0.2f, 0.3f, 0.3f, 0.2f, 0.2f};
+    std::vector<float> labels_data(2 * static_cast<size_t>(num_classes), -10.0f);
+    labels_data[1] = 10.0f;
+    labels_data[num_classes + 2] = 9.0f;
+    std::vector<float> mask_data(32, -10.0f);
+    std::fill(mask_data.begin() + 4, mask_data.begin() + 8, 10.0f);
+    std::fill(mask_data.begin() + 16, mask_data.begin() + 22, 10.0f);
+
+    Config config;
+    config.resolution = resolution;
+    config.model_type = ModelType::SEGMENTATION;
+    auto backend = std::make_unique<MockBackend>();
+    const std::vector<std::vector<int64_t>> shapes{{1, 2, 4}, {1, 2, num_classes}, {1, 2, 4, 4}};
+    backend->set_outputs({dets_data, labels_data, mask_data}, shapes);
+    MockBackend &mock = *backend;
+    RFDETRInference inference(std::move(backend), labels_file_->path(), config);
+    const std::vector<float> input(3UL * resolution * resolution);
+    inference.run_inference(input);
+    const auto transform = inference.make_input_transform(400, 100);
+
+    std::vector<float> expected_scores;
+    std::vector<int> expected_class_ids;
+    std::vector<BoundingBox> expected_boxes;
+    std::vector<rfdetr::media::Mask> expected_masks;
+    inference.postprocess_segmentation_outputs(transform, expected_scores, expected_class_ids, expected_boxes,
+                                               expected_masks);
+    ASSERT_EQ(expected_masks.size(), 2U);
+
+    InferenceOutputs outputs;
+    inference.capture_outputs(outputs);
+    EXPECT_EQ(outputs.batch_size, 1U);
+    EXPECT_EQ(count_heap_allocations([&] { inference.capture_outputs(outputs); }), 0U);
+
+    // The next run replaces the backend's buffers; the captured copy is unaffected
+    mock.set_outputs({std::vector<float>(8, 0.1f), std::vector<float>(12, -10.0f), std::vector<float>(32, 10.0f)},
+                     shapes);
+    inference.run_inference(input);
+
+    auto postprocessor = RFDETRInference::postprocessor(labels_file_->path(), config);
+    EXPECT_THROW(postprocessor.run_inference(input), std::runtime_error);
+    postprocessor.load_outputs(outputs);
+    EXPECT_EQ(postprocessor.get_batch_size(), 1U);
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> masks;
+    postprocessor.postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks);
+    EXPECT_EQ(scores, expected_scores);
+    EXPECT_EQ(class_ids, expected_class_ids);
+    ASSERT_EQ(masks.size(), expected_masks.size());
+    for (size_t i = 0; i < masks.size(); ++i) {
+        EXPECT_FLOAT_EQ(boxes[i].x_min, expected_boxes[i].x_min);
+        EXPECT_FLOAT_EQ(boxes[i].y_max, expected_boxes[i].y_max);
+        EXPECT_EQ(masks[i].x, expected_masks[i].x);
+        EXPECT_EQ(masks[i].data, expected_masks[i].data);
+    }
+}
+
+// A per-item segmentation capture keeps only the mask planes of the queries the postprocess can
+// select, and decodes exactly like the full batched run.
+TEST_F(PostprocessTest, SegmentationCaptureKeepsOnlySelectedMaskPlanes) {
+    const int num_classes = 6;
+    const size_t num_queries = 3;
+    const size_t plane = 16;
+    std::vector<float> dets_data(2 * num_queries * 4, 0.5f);
+    dets_data[4 * num_queries + 8] = 0.3f; // item 1, query 2
+    std::vector<float> labels_data(2 * num_queries * num_classes, -10.0f);
+    labels_data[1] = 10.0f;                                    // item 0, query 0
+    labels_data[(num_queries + 2) * num_classes + 3] = 10.0f;  // item 1, query 2
+    labels_data[(num_queries + 2) * num_classes + 4] = 9.0f;   // item 1, query 2 again
+    std::vector<float> mask_data(2 * num_queries * plane, -10.0f);
+    std::fill_n(mask_data.begin() + static_cast<std::ptrdiff_t>((num_queries + 2) * plane + 5), 6, 10.0f);
+
+    Config config;
+    config.resolution = 100;
+    config.model_type = ModelType::SEGMENTATION;
+    auto backend = std::make_unique<MockBackend>();
+    backend->set_outputs({dets_data, labels_data, mask_data},
+                         {{2, 3, 4}, {2, 3, num_classes}, {2, 3, 4, 4}});
+    RFDETRInference inference(std::move(backend), labels_file_->path(), config);
+    inference.run_inference(std::vector<float>(2UL * 3 * 100 * 100));
+    const auto transform = inference.make_input_transform(100, 100);
+
+    std::vector<float> expected_scores;
+    std::vector<int> expected_class_ids;
+    std::vector<BoundingBox> expected_boxes;
+    std::vector<rfdetr::media::Mask> expected_masks;
+    inference.postprocess_segmentation_outputs(1, transform, expected_scores, expected_class_ids, expected_boxes,
+                                               expected_masks);
+    ASSERT_EQ(expected_class_ids, (std::vector<int>{2, 3}));
+
+    InferenceOutputs outputs;
+    inference.capture_outputs(outputs, 1);
+    EXPECT_EQ(outputs.mask_queries, std::vector<size_t>{2});
+    EXPECT_EQ(outputs.shapes[2], (std::vector<int64_t>{1, 1, 4, 4}));
+    ASSERT_EQ(outputs.tensors[2].size(), plane);
+    EXPECT_EQ(outputs.tensors[2][5], 10.0f);
+
+    auto postprocessor = RFDETRInference::postprocessor(labels_file_->path(), config);
+    postprocessor.load_outputs(outputs);
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> masks;
+    postprocessor.postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks);
+    EXPECT_EQ(scores, expected_scores);
+    EXPECT_EQ(class_ids, expected_class_ids);
+    ASSERT_EQ(masks.size(), expected_masks.size());
+    for (size_t i = 0; i < masks.size(); ++i) {
+        EXPECT_FLOAT_EQ(boxes[i].x_min, expected_boxes[i].x_min);
+        EXPECT_EQ(masks[i].data, expected_masks[i].data);
+    }
+
+    // A postprocessor that would select a query the capture dropped refuses rather than misreading
+    config.threshold = 0.0f;
+    auto looser = RFDETRInference::postprocessor(labels_file_->path(), config);
+    looser.load_outputs(outputs);
+    masks.clear();
+    EXPECT_THROW(looser.postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks),
+                 std::runtime_error);
+}
+
+TEST(Mask, CroppedMaskDrawsAndEncodesInPlace) {
+    // 2x2 region at (1, 1) of a 3x3 image with foreground pixels (1, 1) and (2, 2)
+    rfdetr::media::Mask mask;
+    mask.x = 1;
+    mask.y = 1;
+    mask.width = 2;
+    mask.height = 2;
+    mask.data = {255, 0, 0, 255};
+    EXPECT_EQ(rfdetr::media::count_nonzero(mask), 2U);
+
+    // Column-major pixels: 0 0 0 | 0 1 0 | 0 0 1  ->  runs 4 bg, 1 fg, 3 bg, 1 fg
+    const auto rle = rfdetr::media::encode_rle(mask, 3, 3);
+    EXPECT_EQ(rle.counts, (std::vector<uint32_t>{4, 1, 3, 1}));
+    EXPECT_EQ(rfdetr::media::count_nonzero(rle), 2U);
+
+    // A region starting in the first column emits a leading zero-length background run
+    mask.x = 0;
+    mask.y = 0;
+    EXPECT_EQ(rfdetr::media::encode_rle(mask, 3, 3).counts, (std::vector<uint32_t>{0, 1, 3, 1, 4}));
+
+    rfdetr::media::Image image;
+    image.resize(3, 3);
+    mask.x = 1;
+    mask.y = 1;
+    const BoundingBox box{10.0f, 10.0f, 20.0f, 20.0f}; // outline falls outside the image
+    const int class_id = 0;                             // red
+    rfdetr::media::draw_segmentation_masks(image, std::span(&box, 1), std::span(&class_id, 1), std::span(&mask, 1));
+    const auto pixel = [&image](int x, int y) { return image.bgr[static_cast<size_t>((y * 3 + x) * 3 + 2)]; };
+    EXPECT_NE(pixel(1, 1), 0);
+    EXPECT_NE(pixel(2, 2), 0);
+    EXPECT_EQ(pixel(2, 1), 0);
+    EXPECT_EQ(pixel(1, 2), 0);
+}
+
+TEST_F(PostprocessTest, BatchItemsDecodeIndependently) {
+    // Batch of 2, one query each: image 0 sees a "person" on the left, image 1 a "car" on the right.
+    const int num_classes = 6;
+    const std::vector<float> dets_data = {0.25f, 0.5f, 0.2f, 0.2f, 0.75f, 0.5f, 0.2f, 0.2f};
+    std::vector<float> labels_data(2 * num_classes, -10.0f);
+    labels_data[1] = 10.0f;                // image 0 -> class 0 ("person")
+    labels_data[num_classes + 3] = 10.0f;  // image 1 -> class 2 ("car")
+
+    Config config;
+    config.resolution = 100;
+    auto backend = std::make_unique<MockBackend>();
+    backend->set_outputs({dets_data, labels_data}, {{2, 1, 4}, {2, 1, num_classes}});
+    const MockBackend &mock = *backend;
+    RFDETRInference inference(std::move(backend), labels_file_->path(), config);
+
+    const rfdetr::media::Image small = make_noise_image(100, 100, 1);
+    const rfdetr::media::Image wide = make_noise_image(200, 100, 2);
+    const std::array<rfdetr::media::Image, 2> images{small, wide};
+    const auto batch = inference.preprocess_batch(images);
+    ASSERT_EQ(batch.size(), 2UL * 3 * 100 * 100);
+    inference.run_inference(batch);
+    EXPECT_EQ(inference.get_batch_size(), 2U);
+    EXPECT_EQ(mock.last_input_shape(), (std::vector<int64_t>{2, 3, 100, 100}));
+
+    // Each slice of the batch tensor is exactly the single-image preprocessing.
+    int orig_h = 0;
+    int orig_w = 0;
+    const auto second = inference.preprocess_image(wide, orig_h, orig_w);
+    EXPECT_TRUE(std::equal(second.begin(), second.end(), batch.begin() + static_cast<ptrdiff_t>(second.size())));
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    inference.postprocess_outputs(0, inference.make_input_transform(100, 100), scores, class_ids, boxes);
+    ASSERT_EQ(class_ids, std::vector<int>{0});
+    EXPECT_NEAR(boxes[0].x_min, 15.0f, 0.01f);
+
+    scores.clear();
+    class_ids.clear();
+    boxes.clear();
+    inference.postprocess_outputs(1, inference.make_input_transform(200, 100), scores, class_ids, boxes);
+    ASSERT_EQ(class_ids, std::vector<int>{2});
+    EXPECT_NEAR(boxes[0].x_min, 130.0f, 0.01f); // (75 - 10) * 2
+    EXPECT_NEAR(boxes[0].x_max, 170.0f, 0.01f);
+
+    EXPECT_THROW(inference.postprocess_outputs(2, inference.make_input_transform(100, 100), scores, class_ids, boxes),
+                 std::out_of_range);
+}
+
+// A batched run scattered into per-image captures decodes like batch item 0 of a run of one.
+TEST_F(PostprocessTest, CapturedBatchItemsDecodeAsSingleImages) {
+    const int num_classes = 6;
+    const std::vector<float> dets_data = {0.25f, 0.5f, 0.2f, 0.2f, 0.75f, 0.5f, 0.2f, 0.2f};
+    std::vector<float> labels_data(2 * num_classes, -10.0f);
+    labels_data[1] = 10.0f;
+    labels_data[num_classes + 3] = 10.0f;
+
+    Config config;
+    config.resolution = 100;
+    auto backend = std::make_unique<MockBackend>();
+    backend->set_outputs({dets_data, labels_data}, {{2, 1, 4}, {2, 1, num_classes}});
+    RFDETRInference inference(std::move(backend), labels_file_->path(), config);
+    inference.run_inference(std::vector<float>(2UL * 3 * 100 * 100));
+
+    InferenceOutputs second;
+    inference.capture_outputs(second, 1);
+    EXPECT_EQ(second.batch_size, 1U);
+    EXPECT_EQ(second.shapes[1], (std::vector<int64_t>{1, 1, num_classes}));
+    EXPECT_EQ(second.tensors[0], (std::vector<float>{0.75f, 0.5f, 0.2f, 0.2f}));
+    EXPECT_THROW(inference.capture_outputs(second, 2), std::out_of_range);
+
+    auto postprocessor = RFDETRInference::postprocessor(labels_file_->path(), config);
+    postprocessor.load_outputs(second);
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    postprocessor.postprocess_outputs(inference.make_input_transform(200, 100), scores, class_ids, boxes);
+    ASSERT_EQ(class_ids, std::vector<int>{2});
+    EXPECT_NEAR(boxes[0].x_min, 130.0f, 0.01f);
+}
+
+// Postprocessing reads the backend's output buffers in place, so it sees exactly what the last
+// run produced, and a view that disagrees with its shape is caught before anything decodes it.
+TEST_F(PostprocessTest, ReadsBackendOutputsInPlace) {
+    Config config;
+    config.resolution = 32;
+    auto backend = std::make_unique<MockBackend>();
+    backend->set_outputs({{0.5f, 0.5f, 0.5f, 0.5f}, {-10.0f, 10.0f}}, {{1, 1, 4}, {1, 1, 2}});
+    MockBackend &mock = *backend;
+    RFDETRInference inference(std::move(backend), labels_file_->path(), config);
+    const std::vector<float> input(3UL * 32 * 32);
+    inference.run_inference(input);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    inference.postprocess_outputs(inference.make_input_transform(32, 32), scores, class_ids, boxes);
+    ASSERT_EQ(boxes.size(), 1U);
+    EXPECT_NEAR(boxes[0].x_min, 8.0f, 1e-4f);
+
+    mock.set_outputs({{0.5f, 0.5f, 0.5f}, {-10.0f, 10.0f}}, {{1, 1, 4}, {1, 1, 2}});
+    EXPECT_THROW(inference.run_inference(input), std::runtime_error);
+}
+
+TEST_F(PostprocessTest, RejectsPartialBatchInput) {
+    auto inference = make_inference({{0.5f, 0.5f, 0.1f, 0.1f}, std::vector<float>(6, -10.0f)}, {{1, 1, 4}, {1, 1, 6}},
+                                    0.5f, 32);
+    EXPECT_EQ(inference->get_batch_size(), 1U);
+    const std::vector<float> partial(3UL * 32 * 32 + 5);
+    EXPECT_THROW(inference->run_inference(partial), std::runtime_error);
+    EXPECT_THROW(inference->run_inference(std::span<const float>()), std::runtime_error);
+}
+
+// Once buffers are warm, a frame of preprocess -> inference -> segmentation postprocess (with the
+// previous frame's masks recycled, as the video pipeline does) makes no heap allocations.
+TEST_F(PostprocessTest, SegmentationSteadyStateDoesNotAllocate) {
+    const int resolution = 64;
+    const int num_queries = 4;
+    const int num_classes = 6;
+    std::vector<float> dets_data;
+    std::vector<float> labels_data(static_cast<size_t>(num_queries * num_classes), -10.0f);
+    std::vector<float> mask_data(static_cast<size_t>(num_queries) * 16 * 16, -10.0f);
+    for (int q = 0; q < num_queries; ++q) {
+        dets_data.insert(dets_data.end(), {0.2f * static_cast<float>(q + 1), 0.5f, 0.1f, 0.1f});
+        labels_data[static_cast<size_t>(q * num_classes + 1 + q % 3)] = 10.0f;
+        std::fill_n(mask_data.begin() + q * 256 + 64, 64, 10.0f);
+    }
+    auto inference = make_inference({dets_data, labels_data, mask_data},
+                                    {{1, num_queries, 4}, {1, num_queries, num_classes}, {1, num_queries, 16, 16}},
+                                    0.5f, resolution);
+
+    const rfdetr::media::Image frame = make_noise_image(160, 90, 3);
+    const auto transform = inference->make_input_transform(frame.width, frame.height);
+    const std::array<float, 3> means{0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds{0.229f, 0.224f, 0.225f};
+    rfdetr::media::BilinearResampler resampler;
+    std::vector<float> tensor(3UL * resolution * resolution);
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> masks;
+
+    const auto run_frame = [&] {
+        rfdetr::media::preprocess_bgr_image(frame, tensor, resolution, means, stds, transform, resampler);
+        inference->run_inference(tensor);
+        inference->recycle_results(masks);
+        scores.clear();
+        class_ids.clear();
+        boxes.clear();
+        inference->postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks);
+    };
+
+    run_frame();
+    run_frame();
+    ASSERT_EQ(masks.size(), static_cast<size_t>(num_queries));
+    const size_t allocations = count_heap_allocations([&] {
+        for (int i = 0; i < 5; ++i) {
+            run_frame();
+        }
+    });
+    EXPECT_EQ(allocations, 0U);
+    EXPECT_EQ(masks.size(), static_cast<size_t>(num_queries));
+    EXPECT_EQ(masks[0].width, 16); // cropped to the 6.4-pixel box, x2.5 to the 160-wide frame
+}
+
+TEST_F(PostprocessTest, ParallelMaskUpsamplingMatchesSerial) {
+    const int resolution = 64;
+    const int num_queries = 5;
+    const int num_classes = 6;
+    std::vector<float> dets_data;
+    std::vector<float> labels_data(static_cast<size_t>(num_queries * num_classes), -10.0f);
+    std::vector<float> mask_data(static_cast<size_t>(num_queries) * 16 * 16);
+    for (int q = 0; q < num_queries; ++q) {
+        const auto qf = static_cast<float>(q);
+        dets_data.insert(dets_data.end(), {0.15f * (qf + 1.0f), 0.5f, 0.1f + 0.05f * qf, 0.3f});
+        labels_data[static_cast<size_t>(q * num_classes + 1 + q % 3)] = 1.0f + qf;
+    }
+    for (size_t i = 0; i < mask_data.size(); ++i) {
+        mask_data[i] = std::sin(0.37f * static_cast<float>(i));
+    }
+    auto inference = make_inference({dets_data, labels_data, mask_data},
+                                    {{1, num_queries, 4}, {1, num_queries, num_classes}, {1, num_queries, 16, 16}},
+                                    0.5f, resolution);
+    const auto transform = inference->make_input_transform(300, 200);
+
+    std::vector<float> serial_scores;
+    std::vector<int> serial_class_ids;
+    std::vector<BoundingBox> serial_boxes;
+    std::vector<rfdetr::media::Mask> serial_masks;
+    inference->postprocess_segmentation_outputs(transform, serial_scores, serial_class_ids, serial_boxes,
+                                                serial_masks);
+    ASSERT_EQ(serial_masks.size(), static_cast<size_t>(num_queries));
+
+    rfdetr::concurrency::ThreadPool pool(3); // fewer participants than instances
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<rfdetr::media::Mask> masks;
+    const auto run_frame = [&] {
+        inference->recycle_results(masks);
+        scores.clear();
+        class_ids.clear();
+        boxes.clear();
+        inference->postprocess_segmentation_outputs(transform, scores, class_ids, boxes, masks, pool);
+    };
+    run_frame();
+    run_frame(); // the first recycle sizes the mask pool
+    EXPECT_EQ(count_heap_allocations(run_frame), 0U);
+
+    EXPECT_EQ(scores, serial_scores);
+    EXPECT_EQ(class_ids, serial_class_ids);
+    ASSERT_EQ(masks.size(), serial_masks.size());
+    for (size_t i = 0; i < masks.size(); ++i) {
+        EXPECT_EQ(masks[i].x, serial_masks[i].x) << i;
+        EXPECT_EQ(masks[i].y, serial_masks[i].y) << i;
+        EXPECT_EQ(masks[i].width, serial_masks[i].width) << i;
+        EXPECT_EQ(masks[i].height, serial_masks[i].height) << i;
+        EXPECT_EQ(masks[i].data, serial_masks[i].data) << i;
+    }
+}
+
 // ============================================================================
 // preprocess_bgr_image free function tests
 // ============================================================================
@@ -502,6 +1196,326 @@ TEST(PreprocessFrame, ResizeIsAntialiasFree) {
     }
 }
 
+// Straightforward per-pixel bilinear + two-pass normalize: the preprocessing the fused kernels replace.
+std::vector<float> reference_preprocess(const rfdetr::media::Image &image, int resolution,
+                                        const std::array<float, 3> &means, const std::array<float, 3> &stds) {
+    const auto res = static_cast<size_t>(resolution);
+    std::vector<float> out(3 * res * res);
+    const float scale_x = static_cast<float>(image.width) / static_cast<float>(resolution);
+    const float scale_y = static_cast<float>(image.height) / static_cast<float>(resolution);
+    for (int y = 0; y < resolution; ++y) {
+        const float src_y = (static_cast<float>(y) + 0.5f) * scale_y - 0.5f;
+        const int y0 = std::clamp(static_cast<int>(std::floor(src_y)), 0, image.height - 1);
+        const int y1 = std::min(y0 + 1, image.height - 1);
+        const float wy = src_y - static_cast<float>(y0);
+        for (int x = 0; x < resolution; ++x) {
+            const float src_x = (static_cast<float>(x) + 0.5f) * scale_x - 0.5f;
+            const int x0 = std::clamp(static_cast<int>(std::floor(src_x)), 0, image.width - 1);
+            const int x1 = std::min(x0 + 1, image.width - 1);
+            const float wx = src_x - static_cast<float>(x0);
+            for (int c = 0; c < 3; ++c) {
+                // Output plane c is RGB, so it reads BGR byte 2 - c.
+                const auto at = [&](int yy, int xx) {
+                    const size_t pixel = static_cast<size_t>(yy) * static_cast<size_t>(image.width) +
+                                         static_cast<size_t>(xx);
+                    return static_cast<float>(image.bgr[pixel * 3U + static_cast<size_t>(2 - c)]);
+                };
+                const float v = (at(y0, x0) * (1.0f - wx) + at(y0, x1) * wx) * (1.0f - wy) +
+                                (at(y1, x0) * (1.0f - wx) + at(y1, x1) * wx) * wy;
+                const auto cc = static_cast<size_t>(c);
+                out[cc * res * res + static_cast<size_t>(y) * res + static_cast<size_t>(x)] =
+                    (v / 255.0f - means[cc]) / stds[cc];
+            }
+        }
+    }
+    return out;
+}
+
+// Every SIMD variant the CPU supports must agree with the reference loop, including odd widths
+// that exercise the vector tails and the right-edge columns that fall back to scalar loads.
+TEST(PreprocessFrame, FusedKernelsMatchReference) {
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    const auto coeffs = rfdetr::media::make_normalize_coefficients(means, stds);
+    struct Case {
+        int width;
+        int height;
+        int resolution;
+    };
+    for (const Case tc : {Case{317, 211, 96}, Case{50, 37, 67}, Case{1, 1, 17}, Case{640, 360, 224}}) {
+        const auto image = make_noise_image(tc.width, tc.height, 7);
+        const auto expected = reference_preprocess(image, tc.resolution, means, stds);
+        for (const auto level : {rfdetr::cpu::SimdLevel::SCALAR, rfdetr::cpu::SimdLevel::NEON,
+                                 rfdetr::cpu::SimdLevel::AVX2, rfdetr::cpu::SimdLevel::AVX512}) {
+            if (!rfdetr::cpu::simd_level_supported(level)) {
+                continue;
+            }
+            std::vector<float> actual(expected.size());
+            rfdetr::media::resize_normalize_bgr_to_chw(image, actual, tc.resolution, coeffs, level);
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_NEAR(actual[i], expected[i], 1e-4f)
+                    << rfdetr::cpu::to_string(level) << " " << tc.width << "x" << tc.height << "->" << tc.resolution
+                    << " at " << i;
+            }
+        }
+    }
+}
+
+TEST(PreprocessFrame, CachedResamplerMatchesOneShot) {
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    rfdetr::media::BilinearResampler resampler;
+    for (const uint32_t seed : {1U, 2U}) {
+        const auto image = make_noise_image(160, 90, seed);
+        std::vector<float> one_shot(3UL * 64 * 64);
+        std::vector<float> cached(one_shot.size());
+        rfdetr::media::preprocess_bgr_image(image, one_shot, 64, means, stds);
+        rfdetr::media::preprocess_bgr_image(image, cached, 64, means, stds, resampler);
+        EXPECT_EQ(one_shot, cached);
+    }
+}
+
+TEST(PreprocessFrame, RowParallelMatchesSingleThreaded) {
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    const auto image = make_noise_image(640, 360, 7);
+    rfdetr::media::BilinearResampler serial_resampler;
+    std::vector<float> serial(3UL * 200 * 200);
+    rfdetr::media::preprocess_bgr_image(image, serial, 200, means, stds, serial_resampler);
+
+    for (const size_t threads : {1UL, 3UL, 8UL}) {
+        rfdetr::concurrency::ThreadPool pool(threads);
+        rfdetr::media::BilinearResampler resampler;
+        std::vector<float> parallel(serial.size());
+        rfdetr::media::preprocess_bgr_image(image, parallel, 200, means, stds, resampler, pool);
+        EXPECT_EQ(serial, parallel) << threads << " threads";
+    }
+}
+
+TEST(PreprocessFrame, LetterboxPadsAroundResizedContent) {
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const std::array<float, 3> stds = {0.229f, 0.224f, 0.225f};
+    const auto image = make_noise_image(200, 50, 11);
+    constexpr int res = 64;
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 200, 50, res);
+    ASSERT_EQ(transform.content_height, 16);
+    ASSERT_EQ(transform.content_y, 24);
+
+    std::vector<float> letterboxed(3UL * res * res, 42.0f);
+    rfdetr::media::BilinearResampler resampler;
+    rfdetr::media::preprocess_bgr_image(image, letterboxed, res, means, stds, transform, resampler);
+
+    // The content box holds the plain 64x16 resize; everything else is the normalized mean (0).
+    const rfdetr::media::BilinearResampler content(200, 50, 64, 16, 3);
+    std::vector<float> expected(3UL * 64 * 16);
+    std::vector<float> scratch(6UL * 64);
+    rfdetr::media::resize_normalize_bgr_to_chw(image, expected, {64, 16}, content,
+                                               rfdetr::media::make_normalize_coefficients(means, stds), scratch,
+                                               rfdetr::cpu::SimdLevel::SCALAR, 0, 16);
+    for (size_t c = 0; c < 3; ++c) {
+        for (size_t y = 0; y < res; ++y) {
+            for (size_t x = 0; x < res; ++x) {
+                const float got = letterboxed[(c * res + y) * res + x];
+                if (y >= 24 && y < 40) {
+                    ASSERT_NEAR(got, expected[(c * 16 + (y - 24)) * 64 + x], 1e-4f) << c << "," << y << "," << x;
+                } else {
+                    ASSERT_EQ(got, 0.0f) << c << "," << y << "," << x;
+                }
+            }
+        }
+    }
+
+    rfdetr::concurrency::ThreadPool pool(4);
+    std::vector<float> parallel(letterboxed.size(), 42.0f);
+    rfdetr::media::preprocess_bgr_image(image, parallel, res, means, stds, transform, resampler, pool);
+    EXPECT_EQ(parallel, letterboxed);
+}
+
+// The uint8 path is the same resize without normalization: with mean 0 / std 1 the reference
+// yields pixel/255, which the NHWC kernel must reproduce to within rounding (and saturation:
+// upscaling extrapolates slightly past the edge pixels).
+TEST(PreprocessFrame, Uint8HwcMatchesReference) {
+    const std::array<float, 3> zeros = {0.0f, 0.0f, 0.0f};
+    const std::array<float, 3> ones = {1.0f, 1.0f, 1.0f};
+    for (const auto [width, height, res] : {std::array{317, 211, 96}, std::array{50, 37, 67}}) {
+        const auto image = make_noise_image(width, height, 5);
+        const auto expected = reference_preprocess(image, res, zeros, ones);
+        const auto r = static_cast<size_t>(res);
+        const rfdetr::media::BilinearResampler resampler(width, height, res, res, 3);
+        std::vector<float> scratch(6 * r);
+        for (const auto level : {rfdetr::cpu::SimdLevel::SCALAR, rfdetr::cpu::SimdLevel::NEON,
+                                 rfdetr::cpu::SimdLevel::AVX2, rfdetr::cpu::SimdLevel::AVX512}) {
+            if (!rfdetr::cpu::simd_level_supported(level)) {
+                continue;
+            }
+            std::vector<uint8_t> actual(3 * r * r);
+            rfdetr::media::resize_bgr_to_rgb_hwc(image, actual, {res, res}, resampler, scratch, level, 0, res);
+            for (size_t c = 0; c < 3; ++c) {
+                for (size_t i = 0; i < r * r; ++i) {
+                    const float want = std::clamp(expected[c * r * r + i] * 255.0f, 0.0f, 255.0f);
+                    ASSERT_NEAR(static_cast<float>(actual[i * 3 + c]), want, 0.51f)
+                        << rfdetr::cpu::to_string(level) << " " << width << "x" << height << " at " << i << "/" << c;
+                }
+            }
+        }
+    }
+}
+
+TEST(PreprocessFrame, Uint8LetterboxPadsWithMeanColor) {
+    const std::array<float, 3> means = {0.485f, 0.456f, 0.406f};
+    const auto image = make_noise_image(200, 50, 11);
+    constexpr size_t res = 64;
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 200, 50, res);
+
+    std::vector<uint8_t> letterboxed(3 * res * res, 7);
+    rfdetr::media::BilinearResampler resampler;
+    rfdetr::media::preprocess_bgr_image_u8(image, letterboxed, res, means, transform, resampler);
+
+    // Padding is round(mean * 255) so the in-graph normalization maps it to 0, like the float path.
+    const std::array<uint8_t, 3> pad = {124, 116, 104};
+    for (size_t y = 0; y < res; ++y) {
+        if (y >= 24 && y < 40) {
+            continue;
+        }
+        for (size_t x = 0; x < res; ++x) {
+            for (size_t c = 0; c < 3; ++c) {
+                ASSERT_EQ(letterboxed[(y * res + x) * 3 + c], pad[c]) << y << "," << x << "," << c;
+            }
+        }
+    }
+
+    rfdetr::concurrency::ThreadPool pool(4);
+    std::vector<uint8_t> parallel(letterboxed.size());
+    rfdetr::media::preprocess_bgr_image_u8(image, parallel, res, means, transform, resampler, pool);
+    EXPECT_EQ(parallel, letterboxed);
+}
+
+// ============================================================================
+// ThreadPool tests
+// ============================================================================
+
+TEST(ThreadPool, RunsEveryTaskExactlyOnce) {
+    rfdetr::concurrency::ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4U);
+    for (int round = 0; round < 50; ++round) {
+        std::vector<int> hits(37, 0);
+        pool.run(hits.size(), [&](size_t task) { ++hits[task]; });
+        EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 37);
+    }
+}
+
+TEST(ThreadPool, RethrowsTaskException) {
+    rfdetr::concurrency::ThreadPool pool(3);
+    EXPECT_THROW(pool.run(6,
+                          [](size_t task) {
+                              if (task == 4) {
+                                  throw std::runtime_error("task failed");
+                              }
+                          }),
+                 std::runtime_error);
+    // The pool stays usable after a failed run.
+    std::atomic<size_t> sum{0};
+    pool.run(6, [&](size_t task) { sum += task; });
+    EXPECT_EQ(sum.load(), 15U);
+}
+
+TEST(ThreadPool, SplitRangeCoversTotal) {
+    size_t covered = 0;
+    for (size_t i = 0; i < 7; ++i) {
+        const auto [begin, end] = rfdetr::concurrency::split_range(100, 7, i);
+        EXPECT_EQ(begin, covered);
+        EXPECT_GE(end - begin, 14U);
+        covered = end;
+    }
+    EXPECT_EQ(covered, 100U);
+}
+
+// ============================================================================
+// TensorArena tests
+// ============================================================================
+
+TEST(TensorArena, AlignedZeroedAndMovable) {
+    for (const bool huge_pages : {false, true}) {
+        rfdetr::memory::TensorArena arena(3 * 1000 * sizeof(float), huge_pages);
+        ASSERT_GE(arena.size(), 3 * 1000 * sizeof(float));
+        const auto all = arena.view<float>(0, 3000);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(all.data()) % rfdetr::memory::TensorArena::kAlignment, 0U);
+        EXPECT_TRUE(std::all_of(all.begin(), all.end(), [](float v) { return v == 0.0f; }));
+
+        // Views at consecutive offsets are adjacent, i.e. one batch tensor
+        const auto second = arena.view<float>(1000, 1000);
+        EXPECT_EQ(second.data(), all.data() + 1000);
+        second[999] = 1.0f;
+
+        rfdetr::memory::TensorArena moved(std::move(arena));
+        EXPECT_EQ(arena.size(), 0U); // NOLINT(bugprone-use-after-move)
+        EXPECT_EQ(moved.view<float>(0, 3000)[1999], 1.0f);
+    }
+}
+
+// ============================================================================
+// BilinearResampler / resize_threshold_mask tests
+// ============================================================================
+
+TEST(BilinearResampler, RebuildsOnlyWhenGeometryChanges) {
+    rfdetr::media::BilinearResampler resampler;
+    EXPECT_TRUE(resampler.configure(1920, 1080, 560, 560, 3));
+    EXPECT_FALSE(resampler.configure(1920, 1080, 560, 560, 3));
+    EXPECT_TRUE(resampler.configure(1280, 720, 560, 560, 3));
+    EXPECT_TRUE(resampler.matches(1280, 720, 560, 560, 3));
+    EXPECT_FALSE(resampler.matches(1280, 720, 560, 560, 1));
+    EXPECT_THROW(resampler.configure(0, 720, 560, 560, 3), std::runtime_error);
+}
+
+TEST(BilinearResampler, TablesClampToSourceEdges) {
+    // 2x upscale of a 4-wide row: the first sample sits half a pixel left of source pixel 0.
+    const rfdetr::media::BilinearResampler resampler(4, 1, 8, 1, 3);
+    const auto &x = resampler.x_axis();
+    EXPECT_EQ(x.i0.front(), 0);
+    EXPECT_EQ(x.i1.front(), 3); // pixel 1, in bytes
+    EXPECT_EQ(x.i0.back(), 9);  // pixel 3
+    EXPECT_EQ(x.i1.back(), 9);  // clamped to the last pixel
+    // Columns whose right sample is the last pixel cannot use a 4-byte load.
+    EXPECT_EQ(resampler.dword_safe_columns(), 5);
+}
+
+TEST(ResizeThresholdMask, MatchesPerPixelBilinear) {
+    constexpr int kMaskW = 27;
+    constexpr int kMaskH = 19;
+    constexpr int kOutW = 101;
+    constexpr int kOutH = 64;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+    std::vector<float> logits(static_cast<size_t>(kMaskW * kMaskH));
+    for (auto &v : logits) {
+        v = dist(rng);
+    }
+
+    const rfdetr::media::BilinearResampler resampler(kMaskW, kMaskH, kOutW, kOutH);
+    const auto mask = rfdetr::media::resize_threshold_mask(logits, resampler, 0.0f);
+    ASSERT_EQ(mask.width, kOutW);
+    ASSERT_EQ(mask.height, kOutH);
+
+    const float scale_x = static_cast<float>(kMaskW) / static_cast<float>(kOutW);
+    const float scale_y = static_cast<float>(kMaskH) / static_cast<float>(kOutH);
+    for (int y = 0; y < kOutH; ++y) {
+        const float src_y = (static_cast<float>(y) + 0.5f) * scale_y - 0.5f;
+        const int y0 = std::clamp(static_cast<int>(std::floor(src_y)), 0, kMaskH - 1);
+        const int y1 = std::min(y0 + 1, kMaskH - 1);
+        const float wy = src_y - static_cast<float>(y0);
+        for (int x = 0; x < kOutW; ++x) {
+            const float src_x = (static_cast<float>(x) + 0.5f) * scale_x - 0.5f;
+            const int x0 = std::clamp(static_cast<int>(std::floor(src_x)), 0, kMaskW - 1);
+            const int x1 = std::min(x0 + 1, kMaskW - 1);
+            const float wx = src_x - static_cast<float>(x0);
+            const auto at = [&](int yy, int xx) { return logits[static_cast<size_t>(yy * kMaskW + xx)]; };
+            const float v = (at(y0, x0) * (1.0f - wx) + at(y0, x1) * wx) * (1.0f - wy) +
+                            (at(y1, x0) * (1.0f - wx) + at(y1, x1) * wx) * wy;
+            ASSERT_EQ(mask.data[static_cast<size_t>(y * kOutW + x)], v > 0.0f ? 255 : 0) << x << "," << y;
+        }
+    }
+}
+
 // ============================================================================
 // Image preprocess overload tests
 // ============================================================================
@@ -542,6 +1556,33 @@ TEST(Preprocess, ImageOverloadEmptyImage) {
     EXPECT_THROW(inference.preprocess_image(empty, orig_h, orig_w), std::runtime_error);
 }
 
+TEST(Preprocess, Uint8ModelTakesNhwcInput) {
+    TempLabelFile labels("person\ncar\n");
+    Config config;
+    config.resolution = 32;
+
+    auto backend = std::make_unique<MockBackend>();
+    backend->set_input_format(rfdetr::backend::InputFormat::UINT8_NHWC);
+    backend->set_outputs({std::vector<float>(4), std::vector<float>(3)}, {{1, 1, 4}, {1, 1, 3}});
+    const MockBackend &mock = *backend;
+    RFDETRInference inference(std::move(backend), labels.path(), config);
+    ASSERT_EQ(inference.get_input_format(), rfdetr::backend::InputFormat::UINT8_NHWC);
+
+    int orig_h = 0;
+    int orig_w = 0;
+    const auto data = inference.preprocess_image_u8(make_noise_image(80, 60, 3), orig_h, orig_w);
+    EXPECT_EQ(orig_w, 80);
+    EXPECT_EQ(orig_h, 60);
+    ASSERT_EQ(data.size(), 3UL * 32 * 32);
+
+    inference.run_inference(data);
+    EXPECT_EQ(mock.last_input_shape(), (std::vector<int64_t>{1, 32, 32, 3}));
+    EXPECT_EQ(mock.last_uint8_input(), data);
+
+    const std::vector<float> float_input(3UL * 32 * 32);
+    EXPECT_THROW(inference.run_inference(float_input), std::runtime_error);
+}
+
 // ============================================================================
 // BoundedQueue tests
 // ============================================================================
@@ -608,6 +1649,437 @@ TEST(BoundedQueue, CloseWakesBlockedPush) {
     EXPECT_EQ(q.pop(), rfdetr::video::kPoisonPill);
 }
 
+TEST(BoundedQueue, PopUntilTimesOut) {
+    rfdetr::video::BoundedQueue<size_t> q(4, rfdetr::video::kPoisonPill);
+    const auto soon = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    EXPECT_EQ(q.pop_until(soon), std::nullopt);
+    q.push(7);
+    EXPECT_EQ(q.pop_until(std::chrono::steady_clock::now()), std::optional<size_t>{7});
+    q.close();
+    EXPECT_EQ(q.pop_until(std::chrono::steady_clock::now() + std::chrono::seconds(10)),
+              std::optional<size_t>{rfdetr::video::kPoisonPill});
+}
+
+TEST(BoundedQueue, ClosedQueueDrainsBeforeClosedValue) {
+    rfdetr::video::BoundedQueue<size_t> q(4, rfdetr::video::kPoisonPill);
+    q.push(1);
+    q.push(2);
+    q.close();
+    EXPECT_FALSE(q.try_push(3));
+    EXPECT_EQ(q.pop(), 1u);
+    EXPECT_EQ(q.pop(), 2u);
+    EXPECT_EQ(q.pop(), rfdetr::video::kPoisonPill);
+}
+
+TEST(BoundedQueue, ManyProducersAndConsumersDeliverEachItemOnce) {
+    // A small ring forces wrap-around, full/empty waits and parking on both sides
+    constexpr size_t kProducers = 3;
+    constexpr size_t kConsumers = 3;
+    constexpr size_t kPerProducer = 20000;
+    rfdetr::video::BoundedQueue<size_t> q(4, rfdetr::video::kPoisonPill);
+    std::vector<std::atomic<int>> seen(kProducers * kPerProducer);
+
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < kConsumers; ++c) {
+        consumers.emplace_back([&] {
+            for (size_t item = q.pop(); item != rfdetr::video::kPoisonPill; item = q.pop()) {
+                seen[item].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < kPerProducer; ++i) {
+                q.push(p * kPerProducer + i);
+            }
+        });
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    for (size_t c = 0; c < kConsumers; ++c) {
+        q.push(rfdetr::video::kPoisonPill);
+    }
+    for (auto &t : consumers) {
+        t.join();
+    }
+    EXPECT_TRUE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int> &n) { return n.load() == 1; }));
+}
+
+TEST(FrameMailbox, LatestFrameWins) {
+    rfdetr::media::FrameMailbox mailbox;
+    rfdetr::media::Image frame;
+    frame.resize(4, 2);
+    for (uint8_t n = 0; n < 3; ++n) {
+        std::fill(frame.bgr.begin(), frame.bgr.end(), n);
+        mailbox.post(frame, n);
+    }
+    // The poster's buffer is its own again right away
+    std::fill(frame.bgr.begin(), frame.bgr.end(), uint8_t{99});
+
+    rfdetr::media::Image shown;
+    EXPECT_EQ(mailbox.take(shown), std::optional<int64_t>{2});
+    EXPECT_EQ(shown.width, 4);
+    EXPECT_TRUE(std::all_of(shown.bgr.begin(), shown.bgr.end(), [](uint8_t v) { return v == 2; }));
+    EXPECT_EQ(mailbox.dropped(), 2U);
+
+    mailbox.post(frame, 3);
+    mailbox.close();
+    mailbox.post(frame, 4); // ignored once closed
+    EXPECT_EQ(mailbox.take(shown), std::optional<int64_t>{3});
+    EXPECT_EQ(mailbox.take(shown), std::nullopt);
+}
+
+TEST(VideoPipeline, DetectionsJsonlCarriesTimestamps) {
+    const std::vector<BoundingBox> boxes = {{10.0F, 20.0F, 110.5F, 220.25F}, {0.0F, 0.0F, 4.0F, 4.0F}};
+    const std::vector<int> class_ids = {1, 7};
+    const std::vector<float> scores = {0.91F, 0.5F};
+    const std::vector<std::string> labels = {"person", "say \"hi\""};
+
+    std::ostringstream out;
+    rfdetr::video::write_detections_jsonl(out, 3, 12.0, boxes, class_ids, scores, labels);
+    rfdetr::video::write_detections_jsonl(out, 4, 14.04, {}, {}, {}, labels);
+    EXPECT_EQ(out.str(), "{\"frame\": 3, \"time\": 12.000, \"detections\": ["
+                         "{\"class_id\": 1, \"label\": \"say \\\"hi\\\"\", \"score\": 0.910, "
+                         "\"box\": [10.0, 20.0, 110.5, 220.2]}, "
+                         "{\"class_id\": 7, \"label\": \"cls7\", \"score\": 0.500, \"box\": [0.0, 0.0, 4.0, 4.0]}]}\n"
+                         "{\"frame\": 4, \"time\": 14.040, \"detections\": []}\n");
+}
+
+TEST(VideoPipeline, RejectsEmptyTimeRange) {
+    rfdetr::video::VideoPipelineConfig config;
+    config.start_time = 600.0;
+    config.end_time = 600.0;
+    EXPECT_THROW(rfdetr::video::VideoPipeline pipeline(config), std::runtime_error);
+}
+
+// Each stage needs a thread; a zero count is rejected before any file is opened.
+TEST(VideoPipeline, RejectsZeroWorkerCounts) {
+    for (size_t rfdetr::video::VideoPipelineConfig::*workers :
+         {&rfdetr::video::VideoPipelineConfig::preprocess_workers, &rfdetr::video::VideoPipelineConfig::infer_workers,
+          &rfdetr::video::VideoPipelineConfig::postprocess_workers,
+          &rfdetr::video::VideoPipelineConfig::draw_workers}) {
+        rfdetr::video::VideoPipelineConfig config;
+        config.*workers = 0;
+        try {
+            rfdetr::video::VideoPipeline pipeline(config);
+            ADD_FAILURE() << "a zero worker count was accepted";
+        } catch (const std::runtime_error &e) {
+            EXPECT_NE(std::string(e.what()).find("worker counts"), std::string::npos) << e.what();
+        }
+    }
+}
+
+TEST(ReorderBuffer, ReleasesFramesInOrder) {
+    rfdetr::video::ReorderBuffer reorder(4);
+    reorder.push(3, 30);
+    reorder.push(1, 10);
+    reorder.push(2, 20);
+    EXPECT_EQ(reorder.pop(), std::nullopt); // frame 0 still in flight
+    reorder.push(0, 0);
+    for (const size_t slot : {0U, 10U, 20U, 30U}) {
+        EXPECT_EQ(reorder.pop(), std::optional<size_t>{slot});
+    }
+    EXPECT_EQ(reorder.pop(), std::nullopt);
+    EXPECT_EQ(reorder.next_frame(), 4U);
+
+    // The window is next_frame() plus fewer than `capacity` frames, each held once
+    EXPECT_THROW(reorder.push(3, 1), std::runtime_error);
+    EXPECT_THROW(reorder.push(8, 1), std::runtime_error);
+    reorder.push(7, 1);
+    EXPECT_THROW(reorder.push(7, 2), std::runtime_error);
+}
+
+// The writer's view of a pipeline with several draw workers: slots come back in whatever order the
+// workers finish, up to a ring apart, and the writer releases them in frame order and recycles them.
+TEST(ReorderBuffer, RestoresFrameOrderAcrossDrawWorkers) {
+    constexpr size_t ring = 4;
+    constexpr size_t num_workers = 3;
+    constexpr size_t num_frames = 200;
+    using rfdetr::video::kPoisonPill;
+    rfdetr::video::BoundedQueue<size_t> free_slots(ring, kPoisonPill);
+    rfdetr::video::BoundedQueue<size_t> to_draw(ring, kPoisonPill);
+    rfdetr::video::BoundedQueue<size_t> to_write(ring, kPoisonPill);
+    std::vector<size_t> frame_of(ring);
+    for (size_t i = 0; i < ring; ++i) {
+        free_slots.push(i);
+    }
+
+    std::vector<std::jthread> workers;
+    for (size_t w = 0; w < num_workers; ++w) {
+        workers.emplace_back([&, w] {
+            for (size_t slot = to_draw.pop(); slot != kPoisonPill; slot = to_draw.pop()) {
+                // Uneven per-frame work so later frames regularly overtake earlier ones
+                std::this_thread::sleep_for(std::chrono::microseconds((frame_of[slot] * 7 + w * 13) % 5 * 200));
+                to_write.push(slot);
+            }
+        });
+    }
+    std::jthread decoder([&] {
+        for (size_t n = 0; n < num_frames; ++n) {
+            const size_t slot = free_slots.pop();
+            frame_of[slot] = n;
+            to_draw.push(slot);
+        }
+        for (size_t w = 0; w < num_workers; ++w) {
+            to_draw.push(kPoisonPill);
+        }
+    });
+
+    rfdetr::video::ReorderBuffer reorder(ring);
+    std::vector<size_t> written;
+    size_t max_gap = 0;
+    while (written.size() < num_frames) {
+        const size_t slot = to_write.pop();
+        max_gap = std::max(max_gap, frame_of[slot] - reorder.next_frame());
+        reorder.push(frame_of[slot], slot);
+        for (auto ready = reorder.pop(); ready.has_value(); ready = reorder.pop()) {
+            written.push_back(frame_of[*ready]);
+            free_slots.push(*ready);
+        }
+    }
+    decoder.join();
+    workers.clear();
+
+    std::vector<size_t> expected(num_frames);
+    std::iota(expected.begin(), expected.end(), size_t{0});
+    EXPECT_EQ(written, expected);
+    EXPECT_GT(max_gap, 0U); // frames did arrive out of order
+    EXPECT_LT(max_gap, ring);
+    std::vector<size_t> returned;
+    for (size_t i = 0; i < ring; ++i) {
+        returned.push_back(free_slots.pop());
+    }
+    std::sort(returned.begin(), returned.end());
+    EXPECT_EQ(returned, (std::vector<size_t>{0, 1, 2, 3}));
+}
+
+// A stage that throws shuts the others down through their queues instead of terminating the
+// process, and the owner rethrows that exception rather than one thrown later during the shutdown.
+TEST(StageErrors, FailedStageShutsDownOtherStagesAndRethrows) {
+    struct StageFailure : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+    using rfdetr::video::kPoisonPill;
+    rfdetr::video::BoundedQueue<size_t> to_middle(2, kPoisonPill);
+    rfdetr::video::BoundedQueue<size_t> to_sink(2, kPoisonPill);
+    std::atomic<bool> stop_requested{false};
+    rfdetr::video::StageErrors errors([&] {
+        stop_requested.store(true);
+        to_middle.close();
+        to_sink.close();
+    });
+
+    std::atomic<size_t> sunk{0};
+    {
+        // The source never ends on its own; only the shutdown releases it from its full queue
+        std::jthread source([&] {
+            errors.run([&] {
+                for (size_t n = 0; !stop_requested.load(); ++n) {
+                    to_middle.push(n);
+                }
+            });
+        });
+        std::jthread middle([&] {
+            errors.run([&] {
+                for (size_t n = to_middle.pop(); n != kPoisonPill; n = to_middle.pop()) {
+                    if (n == 3) {
+                        throw StageFailure("frame 3");
+                    }
+                    to_sink.push(n);
+                }
+            });
+        });
+        std::jthread sink([&] {
+            errors.run([&] {
+                while (to_sink.pop() != kPoisonPill) {
+                    sunk.fetch_add(1);
+                }
+                throw std::logic_error("sink saw the shutdown");
+            });
+        });
+    } // joins; a stage left blocked would hang here
+
+    try {
+        errors.rethrow_if_failed();
+        ADD_FAILURE() << "no exception was kept";
+    } catch (const StageFailure &e) {
+        EXPECT_STREQ(e.what(), "frame 3");
+    }
+    EXPECT_LE(sunk.load(), 3U);
+    EXPECT_FALSE(to_middle.try_push(0));
+    EXPECT_FALSE(to_sink.try_push(0));
+}
+
+TEST(StageErrors, CleanRunRethrowsNothing) {
+    size_t shutdowns = 0;
+    rfdetr::video::StageErrors errors([&] { ++shutdowns; });
+    errors.run([] {});
+    EXPECT_NO_THROW(errors.rethrow_if_failed());
+    EXPECT_EQ(shutdowns, 0U);
+}
+
+TEST(ChunkedVideoPipeline, PartPathNumbersBeforeExtension) {
+    EXPECT_EQ(rfdetr::video::part_path("out/video.mp4", 3), std::filesystem::path("out/video.part003.mp4"));
+    EXPECT_EQ(rfdetr::video::part_path("detections.jsonl", 12), std::filesystem::path("detections.part012.jsonl"));
+}
+
+TEST(ChunkedVideoPipeline, MergedDetectionLogsCountFramesAcrossParts) {
+    // Parts written by write_detections_jsonl(), each numbering its frames from 0
+    const TempLabelFile first("{\"frame\": 0, \"time\": 0.000, \"detections\": []}\n"
+                              "{\"frame\": 1, \"time\": 0.040, \"detections\": []}\n",
+                              "test_detections.part000.jsonl");
+    const TempLabelFile second("{\"frame\": 0, \"time\": 0.080, \"detections\": [{\"class_id\": 2}]}\n",
+                               "test_detections.part001.jsonl");
+    const TempLabelFile merged("", "test_detections.jsonl");
+    const std::vector<std::filesystem::path> parts = {first.path(), second.path()};
+    rfdetr::video::merge_detection_logs(parts, merged.path());
+
+    std::ifstream in(merged.path());
+    std::ostringstream text;
+    text << in.rdbuf();
+    EXPECT_EQ(text.str(), "{\"frame\": 0, \"time\": 0.000, \"detections\": []}\n"
+                          "{\"frame\": 1, \"time\": 0.040, \"detections\": []}\n"
+                          "{\"frame\": 2, \"time\": 0.080, \"detections\": [{\"class_id\": 2}]}\n");
+}
+
+// Chunks run through a stand-in for VideoPipeline that writes each part's files, so the merge and
+// cleanup run without decoding anything.
+TEST(ChunkedVideoPipeline, MergesChunkLogsAndRemovesParts) {
+    rfdetr::video::ChunkedPipelineConfig config;
+    config.pipeline.detections_path = std::filesystem::temp_directory_path() / "test_chunked.jsonl";
+    config.parallel = 2;
+    rfdetr::video::ChunkedVideoPipeline pipeline(config, std::vector<rfdetr::video::ChunkRange>(3));
+
+    const size_t total = pipeline.run([](const rfdetr::video::VideoPipelineConfig &chunk) {
+        std::ofstream(chunk.detections_path) << "{\"frame\": 0, \"time\": 0.000, \"detections\": []}\n";
+        return size_t{1};
+    });
+    EXPECT_EQ(total, 3U);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_FALSE(std::filesystem::exists(rfdetr::video::part_path(config.pipeline.detections_path, i)));
+    }
+    std::ifstream in(config.pipeline.detections_path);
+    std::ostringstream text;
+    text << in.rdbuf();
+    in.close();
+    EXPECT_NE(text.str().find("{\"frame\": 2,"), std::string::npos);
+    std::filesystem::remove(config.pipeline.detections_path);
+}
+
+TEST(ChunkedVideoPipeline, FailedChunkLeavesNoParts) {
+    rfdetr::video::ChunkedPipelineConfig config;
+    config.pipeline.output_path = std::filesystem::temp_directory_path() / "test_chunked_failure.mp4";
+    config.pipeline.detections_path = std::filesystem::temp_directory_path() / "test_chunked_failure.jsonl";
+    config.parallel = 1;
+    rfdetr::video::ChunkedVideoPipeline pipeline(config, std::vector<rfdetr::video::ChunkRange>(3));
+
+    // Every chunk writes its parts; the second fails partway through
+    size_t started = 0;
+    const auto fail_second = [&](const rfdetr::video::VideoPipelineConfig &chunk) -> size_t {
+        std::ofstream(chunk.output_path) << "video";
+        std::ofstream(chunk.detections_path) << "{\"frame\": 0, \"time\": 0.000, \"detections\": []}\n";
+        if (++started == 2) {
+            throw std::runtime_error("decode failed");
+        }
+        return 1;
+    };
+    EXPECT_THROW(pipeline.run(fail_second), std::runtime_error);
+    EXPECT_EQ(started, 2U); // no chunk starts after a failure
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_FALSE(std::filesystem::exists(rfdetr::video::part_path(config.pipeline.output_path, i)));
+        EXPECT_FALSE(std::filesystem::exists(rfdetr::video::part_path(config.pipeline.detections_path, i)));
+    }
+    EXPECT_FALSE(std::filesystem::exists(config.pipeline.detections_path));
+}
+
+// ============================================================================
+// PipelineStats tests
+// ============================================================================
+
+TEST(PipelineStats, HistogramPercentilesWithinBucketPrecision) {
+    rfdetr::video::LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile_ns(0.5), 0U);
+    for (int us = 1; us <= 1000; ++us) {
+        histogram.record(std::chrono::microseconds(us));
+    }
+    EXPECT_EQ(histogram.count(), 1000U);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile_ns(0.50)), 500e3, 500e3 * 0.125);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile_ns(0.99)), 990e3, 990e3 * 0.125);
+    EXPECT_EQ(histogram.percentile_ns(1.0), 1'000'000U); // clamped to the largest value
+
+    const auto summary = histogram.summary();
+    EXPECT_DOUBLE_EQ(summary.max_ms, 1.0);
+    EXPECT_DOUBLE_EQ(summary.mean_ms, 0.5005);
+}
+
+TEST(PipelineStats, ExportsJsonAndPrometheus) {
+    using rfdetr::video::PipelineStage;
+    rfdetr::video::PipelineStats stats({1, 1, 2, 1, 1, 1}, 8);
+    stats.start();
+    auto &infer = stats.stage(PipelineStage::INFER);
+    for (int i = 0; i < 3; ++i) {
+        infer.service.record(std::chrono::milliseconds(10));
+    }
+    infer.frames.fetch_add(6);
+    stats.stage(PipelineStage::WRITE).frames.fetch_add(6);
+    stats.end_to_end().record(std::chrono::milliseconds(40));
+    stats.sample_queues({1, 2, 3, 4, 5, 6});
+    stats.sample_queues({3, 2, 1, 0, 0, 2});
+    stats.stop();
+
+    std::ostringstream json;
+    stats.write_json(json);
+    EXPECT_NE(json.str().find("\"frames\": 6"), std::string::npos);
+    EXPECT_NE(json.str().find("\"infer\": {\"workers\": 2, \"frames\": 6"), std::string::npos);
+    EXPECT_NE(json.str().find("\"service_ms\": {\"count\": 3, \"total\": 30.000"), std::string::npos);
+    EXPECT_NE(json.str().find("\"decode_to_preprocess\": {\"mean_depth\": 2.000, \"max_depth\": 3, \"depth\": [1, 3]}"),
+              std::string::npos);
+
+    std::ostringstream prometheus;
+    stats.write_prometheus(prometheus);
+    EXPECT_NE(prometheus.str().find("rfdetr_pipeline_frames_total 6\n"), std::string::npos);
+    EXPECT_NE(prometheus.str().find("rfdetr_pipeline_stage_service_seconds_count{stage=\"infer\"} 3\n"),
+              std::string::npos);
+    EXPECT_NE(prometheus.str().find("rfdetr_pipeline_end_to_end_seconds_count 1\n"), std::string::npos);
+    EXPECT_NE(prometheus.str().find("rfdetr_pipeline_queue_depth{queue=\"free_slots\"} 2\n"), std::string::npos);
+}
+
+// ============================================================================
+// Tracer tests
+// ============================================================================
+
+TEST(Tracer, WritesOneTrackPerThread) {
+    rfdetr::profiling::Tracer tracer;
+    const auto record = [&tracer](int first_frame) {
+        auto &buffer = tracer.thread_buffer("infer");
+        const auto begin = rfdetr::profiling::TraceClock::now();
+        buffer.complete("infer", begin, begin + std::chrono::microseconds(1500), first_frame, 2);
+        buffer.complete("idle", begin, begin);
+    };
+    std::thread a(record, 0);
+    std::thread b(record, 2);
+    a.join();
+    b.join();
+
+    std::ostringstream out;
+    tracer.write_json(out);
+    const std::string json = out.str();
+    EXPECT_EQ(json.rfind("{\"traceEvents\": [", 0), 0U);
+    EXPECT_NE(json.find("\"args\": {\"name\": \"infer-0\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"args\": {\"name\": \"infer-1\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"dur\": 1500.000, \"args\": {\"frame\": 2, \"batch\": 2}}"), std::string::npos);
+    // Spans without a frame carry no args
+    EXPECT_NE(json.find("\"name\": \"idle\""), std::string::npos);
+    EXPECT_NE(json.find("\"dur\": 0.000}"), std::string::npos);
+    size_t spans = 0;
+    for (size_t pos = json.find("\"ph\": \"X\""); pos != std::string::npos; pos = json.find("\"ph\": \"X\"", pos + 1)) {
+        ++spans;
+    }
+    EXPECT_EQ(spans, 4U);
+}
+
 // ============================================================================
 // Keypoint postprocessing tests
 // ============================================================================
@@ -790,6 +2262,36 @@ TEST_F(KeypointPostprocessTest, ScaleApplied) {
     EXPECT_NEAR(keypoints[0][0].y, 150.0f, 0.01f); // 0.5 * 300
 }
 
+TEST_F(KeypointPostprocessTest, LetterboxRemovesPadding) {
+    const int num_dets = 1;
+    const int num_classes = 92;
+    std::vector<float> dets_data = {0.5f, 0.5f, 0.2f, 0.1f};
+    std::vector<float> labels_data(static_cast<size_t>(num_dets * num_classes), -10.0f);
+    labels_data[1] = 10.0f;
+
+    // Keypoint at the center of the model input; 400x100 letterboxed into rows [37, 62) of 100.
+    std::vector<float> kp_data(static_cast<size_t>(num_dets * 272), 0.0f);
+    kp_data[136] = 0.5f;
+    kp_data[137] = 0.5f;
+    kp_data[138] = 5.0f;
+    kp_data[139] = 5.0f;
+
+    auto inference = make_inference({dets_data, labels_data, kp_data},
+                                    {{1, num_dets, 4}, {1, num_dets, num_classes}, {1, num_dets, 34, 8}}, 0.5f, 100);
+    const auto transform = rfdetr::processing::make_input_transform(ResizeMode::LETTERBOX, 400, 100, 100);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<std::vector<KeypointResult>> keypoints;
+    inference->postprocess_keypoint_outputs(transform, scores, class_ids, boxes, keypoints);
+
+    ASSERT_GE(keypoints.size(), 1u);
+    ASSERT_GE(keypoints[0].size(), 1u);
+    EXPECT_NEAR(keypoints[0][0].x, 200.0f, 0.01f); // 50 * 4
+    EXPECT_NEAR(keypoints[0][0].y, 52.0f, 0.01f);  // (50 - 37) * 4
+}
+
 TEST_F(KeypointPostprocessTest, NoDetectionsBelowThreshold) {
     const int num_dets = 1;
     const int num_classes = 92;
@@ -897,6 +2399,43 @@ TEST_F(KeypointPostprocessTest, BackgroundColumnIgnored) {
     EXPECT_TRUE(scores.empty());
 }
 
+TEST_F(KeypointPostprocessTest, SteadyStateDoesNotAllocate) {
+    std::vector<float> dets_data = {0.3f, 0.5f, 0.2f, 0.1f, 0.7f, 0.5f, 0.2f, 0.1f};
+    std::vector<float> labels_data(2 * 4, -10.0f);
+    labels_data[1] = 10.0f;
+    labels_data[4 + 1] = 10.0f;
+    std::vector<float> kp_data(2 * 272, 0.0f);
+
+    auto inference =
+        make_inference({dets_data, labels_data, kp_data}, {{1, 2, 4}, {1, 2, 4}, {1, 2, 34, 8}}, 0.5f, 100);
+    const auto transform = inference->make_input_transform(200, 100);
+    const std::vector<float> input(3UL * 100 * 100);
+
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<BoundingBox> boxes;
+    std::vector<std::vector<KeypointResult>> keypoints;
+    const auto run_frame = [&] {
+        inference->run_inference(input);
+        inference->recycle_results(keypoints);
+        scores.clear();
+        class_ids.clear();
+        boxes.clear();
+        inference->postprocess_keypoint_outputs(transform, scores, class_ids, boxes, keypoints);
+    };
+
+    run_frame();
+    run_frame();
+    const size_t allocations = count_heap_allocations([&] {
+        for (int i = 0; i < 5; ++i) {
+            run_frame();
+        }
+    });
+    EXPECT_EQ(allocations, 0U);
+    ASSERT_EQ(keypoints.size(), 2U);
+    EXPECT_EQ(keypoints[1].size(), 17U);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();